@@ -4,167 +4,643 @@
 #include <thread>
 #include <chrono>
 #include <iomanip>
-#include <conio.h> 
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <csignal>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+#include "custom_vector.h"
+#include "network.h"
+#include "snapshot.h"
 
 // REMOVED: #include <vector> 
 
 using namespace std;
 
 // =========================================================
-// CUSTOM VECTOR IMPLEMENTATION 
+// UI HELPERS
 // =========================================================
-template <typename T>
-class Vector {
-    T* arr;
-    int capacity;
-    int currentSize;
+namespace Color {
+    const string RESET  = "\033[0m";
+    const string RED    = "\033[31m";
+    const string GREEN  = "\033[32m";
+    const string YELLOW = "\033[33m";
+    const string BLUE   = "\033[34m";
+    const string MAGENTA= "\033[35m";
+    const string CYAN   = "\033[36m";
+    const string BOLD   = "\033[1m";
+    const string WHITE  = "\033[37m";
+}
+
+// Hub names come from the engine's road network, loaded with the engine's
+// own parser and network.bin image (network.h)
+Network network;
+Vector<string> CITIES;
+const int FULL_LIST_LIMIT = 16;   // Above this many hubs only active lanes are listed
+
+bool loadHubNames(string& error) {
+    if(!network.load(NETWORK_FILE, NETWORK_CACHE_FILE, error)) return false;
+    CITIES = network.hubNames;
+    return true;
+}
+
+// ANSI clear and home, for the login and menu screens
+void clearScreen() {
+    cout << "\033[2J\033[H" << flush;
+}
+
+void drawProgressBar(ostream& out, int current, int total) {
+    if (total == 0) total = 1;
+    if (current >= total) {
+        out << Color::GREEN << Color::BOLD << "[   ARRIVED  ]" << Color::RESET; 
+        return;
+    }
+
+    int percent = (current * 100) / total;
+    int bars = percent / 10; 
+    
+    out << Color::YELLOW << "[";
+    for(int i=0; i<10; i++) {
+        if(i < bars) out << "=";
+        else if (i == bars) out << ">";
+        else out << " ";
+    }
+    out << "] " << setw(3) << percent << "%" << Color::RESET;
+}
+
+// =========================================================
+// TERMINAL RENDERER
+// =========================================================
+// The dashboard is drawn into a Frame, an off-screen grid of character
+// cells with a style each, through an ostream (setw, Color:: codes and
+// "\n" work as they do on cout). Screen::present compares the new frame
+// with the one on the terminal and sends only the cells that changed, as
+// cursor moves, style changes and text, in one write. No shell is spawned
+// and the screen is never cleared, so a refresh neither flickers nor costs
+// more than the few cells that changed (a ticking clock: ~20 bytes).
+enum CellStyle : unsigned char {
+    STYLE_COLOR = 0x0f,             // 0 = default, else 1 + (SGR 30-37 - 30)
+    STYLE_BOLD = 0x10
+};
+
+void writeTerminal(const char* data, size_t n) {
+#ifdef _WIN32
+    DWORD done;
+    WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), data, (DWORD)n, &done, nullptr);
+#else
+    while (n > 0) {
+        ssize_t done = write(STDOUT_FILENO, data, n);
+        if (done <= 0) return;
+        data += done;
+        n -= done;
+    }
+#endif
+}
+
+// Columns and rows of the terminal, 80x24 if it cannot be asked
+void terminalSize(int& cols, int& rows) {
+    cols = 80;
+    rows = 24;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        cols = info.srWindow.Right - info.srWindow.Left + 1;
+        rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        cols = ws.ws_col;
+        rows = ws.ws_row;
+    }
+#endif
+}
+
+// Single keystrokes, without Enter and without echo: conio on Windows, the
+// terminal switched out of line mode by a KeyMode elsewhere. keyPressed and
+// readKey are called with a KeyMode alive; cin needs line mode back.
+#ifdef _WIN32
+class KeyMode {
+public:
+    void acquire() {}
+    void release() {}
+};
+
+bool keyPressed() { return _kbhit() != 0; }
+int readKey() { return _getch(); }
+
+void saveLineMode() {}
+void restoreLineMode() {}
+#else
+termios lineMode;                   // As the terminal was at startup
+bool lineModeKnown = false;
+
+void saveLineMode() { lineModeKnown = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &lineMode) == 0; }
+
+// Async-signal-safe (onInterrupt)
+void restoreLineMode() {
+    if (lineModeKnown) tcsetattr(STDIN_FILENO, TCSANOW, &lineMode);
+}
+
+class KeyMode {
+    bool active;
 
 public:
-    // Constructor
-    Vector() {
-        capacity = 10;
-        currentSize = 0;
-        arr = new T[capacity];
+    KeyMode() : active(false) { acquire(); }
+    ~KeyMode() { release(); }
+
+    KeyMode(const KeyMode&) = delete;
+    KeyMode& operator=(const KeyMode&) = delete;
+
+    void acquire() {
+        if (active || !lineModeKnown) return;
+        termios keys = lineMode;
+        keys.c_lflag &= ~(ICANON | ECHO);
+        keys.c_cc[VMIN] = 1;
+        keys.c_cc[VTIME] = 0;
+        active = tcsetattr(STDIN_FILENO, TCSANOW, &keys) == 0;
     }
 
-    // Destructor
-    ~Vector() {
-        if (arr) delete[] arr;
+    void release() {
+        if (active) restoreLineMode();
+        active = false;
     }
+};
 
-    // Copy Constructor (Deep Copy) - Critical for passing structs by value
-    Vector(const Vector& other) {
-        capacity = other.capacity;
-        currentSize = other.currentSize;
-        arr = new T[capacity];
-        for (int i = 0; i < currentSize; i++) {
-            arr[i] = other.arr[i];
-        }
+bool keyPressed() {
+    pollfd in = {STDIN_FILENO, POLLIN, 0};
+    return poll(&in, 1, 0) > 0;
+}
+
+// -1 at end of input
+int readKey() {
+    unsigned char c;
+    return read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+#endif
+
+// Blocks for one key (any key to go on, menu choices)
+int waitKey() {
+    KeyMode keys;
+    return readKey();
+}
+
+class Frame : public streambuf {
+    int cols, rows;
+    char* chars;
+    unsigned char* styles;
+    int row, col;
+    unsigned char style;            // Applied to the next character
+    int escape;                     // 0 = text, 1 = after ESC, 2 = inside "ESC [ ... m"
+    int param;                      // SGR parameter being read
+
+    void applySgr(int p) {
+        if (p == 0) style = 0;
+        else if (p == 1) style |= STYLE_BOLD;
+        else if (p >= 30 && p <= 37) style = (style & ~STYLE_COLOR) | (p - 30 + 1);
+        else if (p == 39) style &= ~STYLE_COLOR;
     }
 
-    // Assignment Operator (Deep Copy)
-    Vector& operator=(const Vector& other) {
-        if (this != &other) {
-            if (arr) delete[] arr;
-            capacity = other.capacity;
-            currentSize = other.currentSize;
-            arr = new T[capacity];
-            for (int i = 0; i < currentSize; i++) {
-                arr[i] = other.arr[i];
-            }
+    void put(char c) {
+        if (escape == 1) {
+            escape = c == '[' ? 2 : 0;
+            param = 0;
+            return;
+        }
+        if (escape == 2) {
+            if (c >= '0' && c <= '9') { param = param * 10 + (c - '0'); return; }
+            applySgr(param);
+            param = 0;
+            if (c != ';') escape = 0;       // 'm' ends it; other sequences are dropped
+            return;
         }
-        return *this;
+        if (c == '\033') { escape = 1; return; }
+        if (c == '\n') { row++; col = 0; return; }
+        // Past the right edge or the bottom, text is cut off
+        if (row < rows && col < cols) {
+            chars[row * cols + col] = c;
+            styles[row * cols + col] = style;
+        }
+        col++;
     }
 
-    void push_back(T val) {
-        if (currentSize == capacity) {
-            resize();
-        }
-        arr[currentSize++] = val;
+protected:
+    int overflow(int c) override {
+        if (c != EOF) put((char)c);
+        return c;
     }
 
-    void resize() {
-        capacity *= 2;
-        T* newArr = new T[capacity];
-        for (int i = 0; i < currentSize; i++) {
-            newArr[i] = arr[i];
+    streamsize xsputn(const char* s, streamsize n) override {
+        for (streamsize i = 0; i < n; i++) put(s[i]);
+        return n;
+    }
+
+public:
+    Frame() : cols(0), rows(0), chars(nullptr), styles(nullptr), row(0), col(0), style(0), escape(0), param(0) {}
+    ~Frame() {
+        delete[] chars;
+        delete[] styles;
+    }
+
+    // Blank cols x rows frame, drawing from the top left
+    void begin(int c, int r) {
+        if (c != cols || r != rows) {
+            delete[] chars;
+            delete[] styles;
+            cols = c;
+            rows = r;
+            chars = new char[cols * rows];
+            styles = new unsigned char[cols * rows];
         }
-        delete[] arr;
-        arr = newArr;
+        memset(chars, ' ', cols * rows);
+        memset(styles, 0, cols * rows);
+        row = col = 0;
+        style = 0;
+        escape = 0;
     }
 
-    T& operator[](int index) {
-        return arr[index];
+    int width() const { return cols; }
+    int height() const { return rows; }
+    char charAt(int i) const { return chars[i]; }
+    unsigned char styleAt(int i) const { return styles[i]; }
+};
+
+class Screen {
+    Frame frames[2];
+    int shown;                      // Index of the frame on the terminal
+    bool valid;                     // The terminal still shows frames[shown]
+    string out;
+    ostream stream;
+
+    static void appendStyle(string& s, unsigned char style) {
+        s += "\033[0";
+        if (style & STYLE_BOLD) s += ";1";
+        if (style & STYLE_COLOR) { s += ";3"; s += (char)('0' + (style & STYLE_COLOR) - 1); }
+        s += 'm';
     }
 
-    const T& operator[](int index) const {
-        return arr[index];
+public:
+    Screen() : shown(0), valid(false), stream(nullptr) {
+#ifdef _WIN32
+        // Windows 10 consoles interpret ANSI sequences once asked to
+        HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode;
+        if (GetConsoleMode(h, &mode)) SetConsoleMode(h, mode | 0x0004);   // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#endif
     }
 
-    int size() const {
-        return currentSize;
+    // Stream for the next frame, sized to the terminal
+    ostream& beginFrame() {
+        int cols, rows;
+        terminalSize(cols, rows);
+        // The last column stays empty so no write can wrap or scroll
+        Frame& next = frames[1 - shown];
+        next.begin(cols > 1 ? cols - 1 : 1, rows);
+        stream.rdbuf(&next);
+        stream.clear();
+        return stream;
     }
 
-    bool empty() const {
-        return currentSize == 0;
+    // Sends what differs from the frame on screen; returns the bytes written
+    size_t present() {
+        stream.flush();
+        Frame& next = frames[1 - shown];
+        const Frame& prev = frames[shown];
+        bool full = !valid || prev.width() != next.width() || prev.height() != next.height();
+        out.clear();
+        if (full) out += "\033[0m\033[2J";
+        int cols = next.width();
+        int cursorRow = -1, cursorCol = -1;
+        int current = -1;           // Style the terminal is in, -1 = unknown
+        for (int r = 0; r < next.height(); r++) {
+            for (int c = 0; c < cols; c++) {
+                int i = r * cols + c;
+                char ch = next.charAt(i);
+                unsigned char st = next.styleAt(i);
+                if (!full && ch == prev.charAt(i) && st == prev.styleAt(i)) continue;
+                if (full && ch == ' ' && st == 0) continue;    // Already blank after the clear
+                if (r != cursorRow || c != cursorCol) {
+                    out += "\033[" + to_string(r + 1) + ";" + to_string(c + 1) + "H";
+                    cursorRow = r;
+                    cursorCol = c;
+                }
+                if (st != current) {
+                    appendStyle(out, st);
+                    current = st;
+                }
+                out += ch;
+                cursorCol++;
+            }
+        }
+        if (current > 0) out += "\033[0m";
+        if (!out.empty()) writeTerminal(out.data(), out.size());
+        shown = 1 - shown;
+        valid = true;
+        return out.size();
     }
 
-    // Iterator support for range-based for loops
-    T* begin() { return arr; }
-    T* end() { return arr + currentSize; }
-    const T* begin() const { return arr; }
-    const T* end() const { return arr + currentSize; }
+    // Something else wrote to the terminal: repaint everything next time
+    void invalidate() { valid = false; }
+
+    void hideCursor() { writeTerminal("\033[?25l", 6); }
+    void showCursor() { writeTerminal("\033[0m\033[?25h", 10); }
 };
 
 // =========================================================
-// UI HELPERS
+// NOTIFICATION TAIL READER
 // =========================================================
-namespace Color {
-    const string RESET  = "\033[0m";
-    const string RED    = "\033[31m";
-    const string GREEN  = "\033[32m";
-    const string YELLOW = "\033[33m";
-    const string BLUE   = "\033[34m";
-    const string MAGENTA= "\033[35m";
-    const string CYAN   = "\033[36m";
-    const string BOLD   = "\033[1m";
-    const string WHITE  = "\033[37m";
-}
+// Follows notifications.txt like `tail -f`: remembers its byte offset and
+// parses only what was appended since the last poll, filing each line into
+// a small ring for its hub (plus one for [SYSTEM]). A restarted engine
+// reopens the file: it is replaced, shorter, or truncated in place and
+// possibly already written past our offset, which only shows as the bytes
+// read before (the file's head and the last bytes consumed) no longer being
+// where they were. Any of these starts over as a fresh attach, which reads
+// only the last BACKFILL_BYTES of an existing log.
+class NotificationTail {
+    static const int RING_LINES = 5;
+    static const long long BACKFILL_BYTES = 1 << 20;
+    static const int READ_CHUNK = 64 * 1024;
+    static const int HEAD_BYTES = 256;
+    static const int SEAM_BYTES = 64;
+
+    struct Ring {
+        string lines[RING_LINES];
+        long long seq[RING_LINES];  // Line number in the file, to merge rings in order
+        int count;
+        int next;
+    };
+
+    string path;
+    long long offset;               // Bytes consumed so far
+    unsigned long long fileId;      // Inode, to notice a replaced file
+    bool attached;
+    string partial;                 // Incomplete last line, waiting for its '\n'
+    string head;                    // First bytes of the file, up to HEAD_BYTES
+    string seam;                    // Last bytes consumed, up to SEAM_BYTES
+    long long lineSeq;
+    Vector<Ring> rings;             // One per hub; the last one is [SYSTEM]
+    Vector<int> nameSlots;          // Open-addressing hub-name index, -1 = empty
+
+    static unsigned hashName(const char* s, size_t n) {
+        unsigned h = 2166136261u;   // FNV-1a
+        for (size_t i = 0; i < n; i++) { h ^= (unsigned char)s[i]; h *= 16777619u; }
+        return h;
+    }
+
+    int hubIndex(const char* s, size_t n) {
+        unsigned mask = nameSlots.size() - 1;
+        for (unsigned i = hashName(s, n) & mask; nameSlots[i] != -1; i = (i + 1) & mask) {
+            const string& name = CITIES[nameSlots[i]];
+            if (name.size() == n && memcmp(name.data(), s, n) == 0) return nameSlots[i];
+        }
+        return -1;
+    }
+
+    void reset() {
+        for (int i = 0; i < rings.size(); i++) { rings[i].count = 0; rings[i].next = 0; }
+        partial.clear();
+        head.clear();
+        seam.clear();
+        lineSeq = 0;
+        offset = 0;
+    }
+
+    static bool readAt(ifstream& f, long long pos, long long n, string& out) {
+        out.resize(n);
+        f.clear();
+        f.seekg(pos);
+        f.read(&out[0], n);
+        return f.gcount() == n;
+    }
+
+    // Whether the bytes read so far are still where they were
+    bool sameFile(ifstream& f) {
+        string now;
+        if (!head.empty() && (!readAt(f, 0, head.size(), now) || now != head)) return false;
+        if (!seam.empty() && (!readAt(f, offset - seam.size(), seam.size(), now) || now != seam)) return false;
+        return true;
+    }
 
-const int MAX_CITIES = 8;
-const string CITIES[MAX_CITIES] = {
-    "Lahore", "Karachi", "Islamabad", "Multan",
-    "Faisalabad", "Peshawar", "Quetta", "Sialkot"
+    // "[day][sec] [City] TYPE: message"
+    void fileLine(const string& line) {
+        size_t open = line.find("] [");
+        if (open == string::npos) return;
+        size_t start = open + 3;
+        size_t close = line.find(']', start);
+        if (close == string::npos) return;
+        int ring;
+        if (line.compare(start, close - start, "SYSTEM") == 0) ring = rings.size() - 1;
+        else ring = hubIndex(line.data() + start, close - start);
+        if (ring < 0) return;
+        Ring& r = rings[ring];
+        r.lines[r.next] = line;
+        r.seq[r.next] = lineSeq++;
+        r.next = (r.next + 1) % RING_LINES;
+        if (r.count < RING_LINES) r.count++;
+    }
+
+public:
+    NotificationTail(const string& file) : path(file) {
+        offset = 0;
+        fileId = 0;
+        attached = false;
+        lineSeq = 0;
+        Ring empty;
+        empty.count = empty.next = 0;
+        for (int c = 0; c <= CITIES.size(); c++) rings.push_back(empty);
+        int slots = 16;
+        while (slots < CITIES.size() * 2) slots *= 2;
+        for (int i = 0; i < slots; i++) nameSlots.push_back(-1);
+        for (int c = 0; c < CITIES.size(); c++) {
+            unsigned i = hashName(CITIES[c].data(), CITIES[c].size()) & (slots - 1);
+            while (nameSlots[i] != -1) i = (i + 1) & (slots - 1);
+            nameSlots[i] = c;
+        }
+    }
+
+    // Reads whatever was appended since the last call
+    void poll() {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            if (attached) reset();
+            attached = false;
+            return;
+        }
+        long long size = st.st_size;
+        ifstream f(path.c_str(), ios::binary);
+        if (!f.is_open()) return;
+        if (attached && (size < offset || (unsigned long long)st.st_ino != fileId || !sameFile(f))) attached = false;
+        if (!attached) {
+            attached = true;
+            fileId = st.st_ino;
+            reset();
+            if (size > BACKFILL_BYTES) offset = size - BACKFILL_BYTES;   // First line may be cut; skipped below
+        }
+        if (size == offset) return;
+
+        f.clear();
+        f.seekg(offset);
+        bool skipFirst = offset > 0 && lineSeq == 0 && partial.empty();
+        char chunk[READ_CHUNK];
+        long long remaining = size - offset;
+        while (remaining > 0) {
+            f.read(chunk, remaining < READ_CHUNK ? remaining : READ_CHUNK);
+            long long got = f.gcount();
+            if (got <= 0) break;
+            remaining -= got;
+            offset += got;
+            long long lineStart = 0;
+            for (long long i = 0; i < got; i++) {
+                if (chunk[i] != '\n') continue;
+                partial.append(chunk + lineStart, i - lineStart);
+                if (skipFirst) skipFirst = false;
+                else fileLine(partial);
+                partial.clear();
+                lineStart = i + 1;
+            }
+            partial.append(chunk + lineStart, got - lineStart);
+        }
+        if (head.size() < HEAD_BYTES) readAt(f, 0, min(offset, (long long)HEAD_BYTES), head);
+        long long seamBytes = min(offset, (long long)SEAM_BYTES);
+        readAt(f, offset - seamBytes, seamBytes, seam);
+    }
+
+    // Last RING_LINES events for the hub, [SYSTEM] events included, oldest first
+    Vector<string> recent(int hub) {
+        Vector<string> out;
+        const Ring& a = rings[hub];
+        const Ring& b = rings[rings.size() - 1];
+        // Walk both rings newest to oldest, then reverse
+        int ia = a.count, ib = b.count;
+        Vector<string> newestFirst;
+        while (newestFirst.size() < RING_LINES && (ia > 0 || ib > 0)) {
+            int pa = (a.next - (a.count - ia) - 1 + RING_LINES) % RING_LINES;
+            int pb = (b.next - (b.count - ib) - 1 + RING_LINES) % RING_LINES;
+            bool takeA = ib == 0 || (ia > 0 && a.seq[pa] > b.seq[pb]);
+            if (takeA) { newestFirst.push_back(a.lines[pa]); ia--; }
+            else { newestFirst.push_back(b.lines[pb]); ib--; }
+        }
+        for (int i = newestFirst.size() - 1; i >= 0; i--) out.push_back(newestFirst[i]);
+        return out;
+    }
 };
 
-struct TripInfo {
-    int src, dest;
-    string vehicle;
-    int traveled;
-    int total;
+// =========================================================
+// ENGINE METRICS READER
+// =========================================================
+// The engine rewrites metrics.prom (Prometheus text format) every
+// --metrics-ms. Summaries are folded into one row per series with their
+// quantiles; counters and gauges are kept as single values. Nothing here
+// knows the metric names, so new ones show up without an admin change.
+const char METRICS_FILE[] = "metrics.prom";
+
+struct MetricSummary {
+    string series;                  // "phase_seconds tick"
+    bool seconds;                   // Shown in ms
+    long long count;
+    double p50, p99, p999, max;
 };
 
-struct SystemState {
-    int day;
-    int time;
-    int booked;
-    int transit;
-    int lost;
-    Vector<TripInfo> trips; // Using Custom Vector
+struct MetricValue {
+    string series;
+    double value;
 };
 
-int parseKm(string s) {
-    size_t pos = s.find("km");
-    if (pos != string::npos) return stoi(s.substr(0, pos));
-    try { return stoi(s); } catch(...) { return 0; }
-}
+class MetricsReader {
+    // "swiftex_lock_wait_seconds", "lock=\"data\",quantile=\"0.5\"" -> "lock_wait_seconds data"
+    static string seriesName(const string& name, const string& labels) {
+        string out = name.compare(0, 8, "swiftex_") == 0 ? name.substr(8) : name;
+        size_t i = 0;
+        while((i = labels.find('"', i)) != string::npos) {
+            size_t end = labels.find('"', i + 1);
+            if(end == string::npos) break;
+            size_t key = labels.rfind(',', i);
+            key = key == string::npos ? 0 : key + 1;
+            if(labels.compare(key, i - key, "quantile=") != 0) out += " " + labels.substr(i + 1, end - i - 1);
+            i = end + 1;
+        }
+        return out;
+    }
 
-void clearScreen() {
-    #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
-    #endif
-}
+    static string quantileOf(const string& labels) {
+        size_t q = labels.find("quantile=\"");
+        if(q == string::npos) return "";
+        size_t end = labels.find('"', q + 10);
+        return labels.substr(q + 10, end == string::npos ? string::npos : end - q - 10);
+    }
 
-void drawProgressBar(int current, int total) {
-    if (total == 0) total = 1;
-    if (current >= total) {
-        cout << Color::GREEN << Color::BOLD << "[   ARRIVED  ]" << Color::RESET; 
-        return;
+    static bool endsWith(const string& s, const char* suffix) {
+        size_t n = strlen(suffix);
+        return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
     }
 
-    int percent = (current * 100) / total;
-    int bars = percent / 10; 
-    
-    cout << Color::YELLOW << "[";
-    for(int i=0; i<10; i++) {
-        if(i < bars) cout << "=";
-        else if (i == bars) cout << ">";
-        else cout << " ";
+    int summaryIndex(const string& series, bool seconds) {
+        for(int i = 0; i < summaries.size(); i++)
+            if(summaries[i].series == series) return i;
+        MetricSummary m = {series, seconds, 0, 0, 0, 0, 0};
+        summaries.push_back(m);
+        return summaries.size() - 1;
     }
-    cout << "] " << setw(3) << percent << "%" << Color::RESET;
-}
+
+public:
+    Vector<MetricSummary> summaries;
+    Vector<MetricValue> values;
+    long long ageSeconds;           // Since the engine last wrote the file
+
+    MetricsReader() : ageSeconds(0) {}
+
+    bool read() {
+        summaries.clear();
+        values.clear();
+        struct stat st;
+        if(stat(METRICS_FILE, &st) != 0) return false;
+        ageSeconds = (long long)time(0) - (long long)st.st_mtime;
+        ifstream f(METRICS_FILE);
+        if(!f.is_open()) return false;
+        string line;
+        while(getline(f, line)) {
+            if(line.empty() || line[0] == '#') continue;
+            size_t space = line.rfind(' ');
+            if(space == string::npos) continue;
+            double value = atof(line.c_str() + space + 1);
+            string name = line.substr(0, space), labels;
+            size_t brace = name.find('{');
+            if(brace != string::npos) {
+                labels = name.substr(brace + 1, name.size() - brace - 2);
+                name.resize(brace);
+            }
+            string q = quantileOf(labels);
+            if(!q.empty()) {
+                MetricSummary& m = summaries[summaryIndex(seriesName(name, labels), endsWith(name, "_seconds"))];
+                if(q == "0.5") m.p50 = value;
+                else if(q == "0.99") m.p99 = value;
+                else if(q == "0.999") m.p999 = value;
+                else if(q == "1") m.max = value;
+            }
+            else if(endsWith(name, "_count")) {
+                string base = name.substr(0, name.size() - 6);
+                summaries[summaryIndex(seriesName(base, labels), endsWith(base, "_seconds"))].count = (long long)value;
+            }
+            else if(!endsWith(name, "_sum")) {
+                MetricValue v = {seriesName(name, labels), value};
+                values.push_back(v);
+            }
+        }
+        return true;
+    }
+};
 
 // =========================================================
 // ADMIN PANEL CLASS
@@ -172,96 +648,56 @@ void drawProgressBar(int current, int total) {
 class AdminPanel {
     int monitoredCity; 
     bool running;
+    SnapshotReader snapshot;
+    SnapshotCounters state;
+    SnapshotCity cityState;         // Parcels booked at the monitored hub, per status
+    SnapshotTrip* trips;            // Copy of the engine's trip table
+    Vector<const SnapshotTrip*> outgoing;   // Monitored hub's first trip to each hub, by destination
+    NotificationTail notifications;
+    MetricsReader metrics;
+    Screen screen;
+    int refreshMs;                  // Dashboard redraw interval
 
 public:
-    AdminPanel() {
+    AdminPanel(int refresh) : notifications("notifications.txt") {
         monitoredCity = -1;
         running = true;
+        refreshMs = refresh;
+        memset(&state, 0, sizeof(state));
+        memset(&cityState, 0, sizeof(cityState));
+        trips = new SnapshotTrip[SNAPSHOT_MAX_TRIPS];
     }
 
+    ~AdminPanel() { delete[] trips; }
+
     void selectCity() {
         while(true) {
             clearScreen();
             cout << Color::BLUE << "=== SWIFTEX ADMIN LOGIN ===" << Color::RESET << endl;
             cout << "Select Hub to Monitor:\n";
-            for(int i=0; i<MAX_CITIES; i++) {
+            for(int i=0; i<CITIES.size() && i<FULL_LIST_LIMIT; i++) {
                 cout << Color::CYAN << i << "." << Color::RESET << " " << CITIES[i] << endl;
             }
+            if(CITIES.size() > FULL_LIST_LIMIT) cout << " ... " << CITIES.size() << " hubs in total\n";
             cout << "Enter City ID: ";
-            if(cin >> monitoredCity && monitoredCity >= 0 && monitoredCity < MAX_CITIES) {
+            if(cin >> monitoredCity && monitoredCity >= 0 && monitoredCity < CITIES.size()) {
                 break;
             }
             cin.clear(); cin.ignore(100, '\n');
         }
     }
 
-    SystemState readState() {
-        SystemState state = {0, 0, 0, 0, 0};
-        ifstream f("system_state.txt");
-        if(!f.is_open()) return state;
-
-        string label;
-        f >> label >> state.day;
-        f >> label >> state.time;
-        f >> label >> state.booked;
-        f >> label >> state.transit;
-        
-        string tempLine; 
-        f >> label; 
-        if(label == "PARCELS_LOST:") f >> state.lost;
-        else getline(f, tempLine); 
-
-        string dummy;
-        f >> dummy >> dummy >> dummy; 
-
-        int s, d;
-        string v, t_str, tot_str;
-        while(f >> s >> d >> v >> t_str >> tot_str) {
-            TripInfo t;
-            t.src = s; t.dest = d; t.vehicle = v;
-            t.traveled = parseKm(t_str); t.total = parseKm(tot_str);
-            state.trips.push_back(t); // Custom Vector push_back
-        }
-        f.close();
-        return state;
-    }
-
-    // Changed return type to Custom Vector
-    Vector<string> getLogs(string city) {
-        Vector<string> lines;
-        ifstream f("notifications.txt");
-        if(!f.is_open()) return lines;
-        
-        string line;
-        string tag = "[" + city + "]"; 
-        while(getline(f, line)) {
-            if(line.find(tag) != string::npos || line.find("[SYSTEM]") != string::npos) {
-                lines.push_back(line);
-            }
-        }
-        f.close();
-        
-        // Manual slicing logic since we don't have STL iterators
-        if(lines.size() <= 5) return lines;
-
-        Vector<string> lastFive;
-        int start = lines.size() - 5;
-        for(int i = start; i < lines.size(); i++) {
-            lastFive.push_back(lines[i]);
-        }
-        return lastFive;
-    }
-
     void showMenu() {
         clearScreen();
         cout << Color::BLUE << "=== ADMIN MENU (" << CITIES[monitoredCity] << ") ===" << Color::RESET << endl;
         cout << " 1. Block a Route\n";
         cout << " 2. Clear All Blocks\n";
         cout << " 3. Resume Dashboard\n";
+        cout << " 4. Engine Metrics\n";
         cout << " 0. Exit\n";
         cout << "Select: ";
         
-        char choice = _getch();
+        char choice = (char)waitKey();
         if(choice == '1') {
             int dest, dur;
             cout << "\nDest City ID: "; cin >> dest;
@@ -270,118 +706,216 @@ public:
             f << monitoredCity << " " << dest << " " << dur << endl;
             f.close();
             cout << Color::RED << ">> Route Blocked.\n" << Color::RESET;
-            _getch();
+            waitKey();
         } 
         else if(choice == '2') {
             ofstream f("blocks.txt", ios::trunc);
             f.close();
             cout << Color::GREEN << ">> All Blocks Cleared.\n" << Color::RESET;
-            _getch();
+            waitKey();
+        }
+        else if(choice == '4') {
+            showMetrics();
         }
         else if(choice == '0') {
             exit(0);
         }
     }
 
+    // Tick phase and lock latencies from metrics.prom, redrawn every
+    // refreshMs until a key is pressed
+    void showMetrics() {
+        screen.invalidate();
+        screen.hideCursor();
+        KeyMode keys;
+        while(!keyPressed()) {
+            bool live = metrics.read();
+            ostream& out = screen.beginFrame();
+            out << Color::BLUE << "=== ENGINE METRICS (" << METRICS_FILE << ") ===\n" << Color::RESET;
+            if(!live) out << Color::YELLOW << " Waiting for the engine (" << METRICS_FILE << ")...\n" << Color::RESET;
+            else if(metrics.ageSeconds > 5) out << Color::YELLOW << " Last written " << metrics.ageSeconds << " s ago\n" << Color::RESET;
+
+            out << Color::WHITE << left << setw(28) << " Latency (ms)" << right << setw(10) << "count"
+                << setw(10) << "p50" << setw(10) << "p99" << setw(10) << "p99.9" << setw(10) << "max" << "\n" << Color::RESET;
+            for(const MetricSummary& m : metrics.summaries) {
+                double scale = m.seconds ? 1000 : 1;
+                out << " " << left << setw(27) << m.series.substr(0, 26) << right << setw(10) << m.count
+                    << fixed << setprecision(m.seconds ? 3 : 0)
+                    << setw(10) << m.p50 * scale << setw(10) << m.p99 * scale << setw(10) << m.p999 * scale;
+                bool outlier = m.max > m.p999 * 10;    // A stall far past the tail
+                out << (outlier ? Color::YELLOW : "") << setw(10) << m.max * scale << Color::RESET << "\n";
+            }
+            out << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
+            for(const MetricValue& v : metrics.values) {
+                bool bad = v.value > 0 && (v.series.find("overruns") != string::npos || v.series.find("dropped") != string::npos);
+                out << " " << left << setw(37) << v.series.substr(0, 36) << right << setprecision(6) << defaultfloat
+                    << (bad ? Color::RED : "") << setw(12) << v.value << Color::RESET << "\n";
+            }
+            out << Color::BLUE << "========================================================\n" << Color::RESET;
+            out << " [Any key] Back\n";
+            screen.present();
+            this_thread::sleep_for(chrono::milliseconds(refreshMs));
+        }
+        readKey();
+        screen.showCursor();
+    }
+
     void dashboardLoop() {
         cout << "Starting Dashboard...\n";
         this_thread::sleep_for(chrono::seconds(1));
+        screen.hideCursor();
+        KeyMode keys;
 
         while(running) {
-            if(_kbhit()) {
-                char ch = _getch();
+            if(keyPressed()) {
+                char ch = (char)readKey();
                 if(ch == 'm' || ch == 'M') {
+                    keys.release();         // The menu reads numbers with cin
+                    screen.showCursor();
                     showMenu();
+                    screen.invalidate();
+                    screen.hideCursor();
+                    keys.acquire();
                     continue; 
                 }
             }
 
-            SystemState state = readState();
+            bool live = snapshot.read(state, trips, monitoredCity, cityState);
             // Vector<string> allows range-based loops because we implemented begin() and end()
-            Vector<string> logs = getLogs(CITIES[monitoredCity]); 
+            notifications.poll();
+            Vector<string> logs = notifications.recent(monitoredCity);
 
-            clearScreen();
-            cout << Color::BLUE << "========================================================\n";
-            cout << "   SWIFTEX LIVE MONITOR: " << Color::BOLD << Color::WHITE << CITIES[monitoredCity] << Color::RESET << Color::BLUE << "\n";
-            cout << "========================================================\n" << Color::RESET;
+            ostream& out = screen.beginFrame();
+            out << Color::BLUE << "========================================================\n";
+            out << "   SWIFTEX LIVE MONITOR: " << Color::BOLD << Color::WHITE << CITIES[monitoredCity] << Color::RESET << Color::BLUE << "\n";
+            out << "========================================================\n" << Color::RESET;
             
-            cout << " Day: " << Color::BOLD << state.day << Color::RESET;
-            cout << "  |  Time: " << Color::BOLD << state.time << "/180s" << Color::RESET << "\n";
+            if(!live) out << Color::YELLOW << " Waiting for the engine (" << SNAPSHOT_FILE << ")...\n" << Color::RESET;
+            out << " Day: " << Color::BOLD << state.day << Color::RESET;
+            out << "  |  Time: " << Color::BOLD << state.second << "/180s" << Color::RESET << "\n";
             
-            cout << " Stats: " 
+            out << " Stats: " 
                  << Color::CYAN << "Booked: " << state.booked << Color::RESET << " | "
                  << Color::YELLOW << "Transit: " << state.transit << Color::RESET << " | "
-                 << Color::RED << "Lost: " << state.lost << Color::RESET << "\n";
+                 << Color::GREEN << "Delivered: " << state.delivered << Color::RESET << " | "
+                 << Color::RED << "Lost: " << state.lost << Color::RESET << " | "
+                 << "Cancelled: " << state.cancelled << "\n";
+            if(monitoredCity < state.hubCount) {
+                // Status order: Booked, In Transit, Delivered, LOST, Cancelled
+                out << " Hub:   "
+                     << Color::CYAN << "Booked: " << cityState.counts[0] << Color::RESET << " | "
+                     << Color::YELLOW << "Transit: " << cityState.counts[1] << Color::RESET << " | "
+                     << Color::GREEN << "Delivered: " << cityState.counts[2] << Color::RESET << " | "
+                     << Color::RED << "Lost: " << cityState.counts[3] << Color::RESET << " | "
+                     << "Cancelled: " << cityState.counts[4] << "\n";
+            }
             
-            cout << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
-            cout << Color::WHITE << " OUTGOING TRAFFIC (" << CITIES[monitoredCity] << ")\n" << Color::RESET;
-            cout << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
-            cout << left << setw(12) << "Destination" << setw(15) << "Vehicle" << "Status\n";
+            out << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
+            out << Color::WHITE << " OUTGOING TRAFFIC (" << CITIES[monitoredCity] << ")\n" << Color::RESET;
+            out << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
+            out << left << setw(12) << "Destination" << setw(15) << "Vehicle" << "Status\n";
+
+            // One pass over the trip table picks out this hub's trips; the
+            // lanes below are drawn from that short list
+            const SnapshotTrip* localTrip = nullptr;
+            outgoing.clear();
+            for(int k = 0; k < state.tripCount; k++) {
+                const SnapshotTrip* t = &trips[k];
+                if(t->src != monitoredCity || t->dest < 0 || t->dest >= CITIES.size()) continue;
+                if(t->dest == monitoredCity) {
+                    if(!localTrip) localTrip = t;
+                    continue;
+                }
+                int at = outgoing.size();
+                while(at > 0 && outgoing[at - 1]->dest > t->dest) at--;
+                if(at > 0 && outgoing[at - 1]->dest == t->dest) continue;     // Only the first is shown
+                outgoing.push_back(t);
+                for(int j = outgoing.size() - 1; j > at; j--) outgoing[j] = outgoing[j - 1];
+                outgoing[at] = t;
+            }
 
             // Local Traffic Check
-             bool localActive = false;
-             TripInfo localTrip;
-             for(const auto& t : state.trips) {
-                if(t.src == monitoredCity && t.dest == monitoredCity) {
-                    localTrip = t; localActive = true; break;
-                }
-             }
-             if(localActive) {
-                cout << left << setw(12) << "LOCAL" << setw(15) << localTrip.vehicle;
-                drawProgressBar(localTrip.traveled, localTrip.total);
-                cout << "\n";
+             if(localTrip) {
+                out << left << setw(12) << "LOCAL" << setw(15) << localTrip->vehicle;
+                drawProgressBar(out, localTrip->traveledKm, localTrip->totalKm);
+                out << "\n";
              }
 
-            // Outgoing Traffic
-            for(int i=0; i<MAX_CITIES; i++) {
+            // Outgoing Traffic (large networks: active lanes only)
+            bool listAll = CITIES.size() <= FULL_LIST_LIMIT;
+            int next = 0;                   // First entry of `outgoing` not drawn yet
+            for(int i=0; i<CITIES.size(); i++) {
+                if(!listAll && next == outgoing.size()) break;
                 if(i == monitoredCity) continue;
-                bool active = false;
-                TripInfo currentTrip;
-                for(const auto& t : state.trips) {
-                    if(t.src == monitoredCity && t.dest == i) {
-                        currentTrip = t; active = true; break;
-                    }
-                }
-                if(active) {
-                    cout << left << setw(12) << CITIES[i] << setw(15) << currentTrip.vehicle;
-                    drawProgressBar(currentTrip.traveled, currentTrip.total);
-                    cout << "\n";
+                const SnapshotTrip* currentTrip = nullptr;
+                if(next < outgoing.size() && outgoing[next]->dest == i) currentTrip = outgoing[next++];
+                if(!currentTrip && !listAll) continue;
+                if(currentTrip) {
+                    out << left << setw(12) << CITIES[i] << setw(15) << currentTrip->vehicle;
+                    drawProgressBar(out, currentTrip->traveledKm, currentTrip->totalKm);
+                    out << "\n";
                 } else {
-                    cout << Color::WHITE << left << setw(12) << CITIES[i] << setw(15) << "-" << "Idle\n" << Color::RESET;
+                    out << Color::WHITE << left << setw(12) << CITIES[i] << setw(15) << "-" << "Idle\n" << Color::RESET;
                 }
             }
 
-            cout << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
-            cout << Color::WHITE << " LIVE NOTIFICATIONS\n" << Color::RESET;
-            cout << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
+            out << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
+            out << Color::WHITE << " LIVE NOTIFICATIONS\n" << Color::RESET;
+            out << Color::BLUE << "--------------------------------------------------------\n" << Color::RESET;
             
-            if(logs.empty()) cout << " No events yet.\n";
+            if(logs.empty()) out << " No events yet.\n";
             else {
                 for(const string& l : logs) {
                     // Context-Aware Coloring
                     if(l.find("CRITICAL") != string::npos || l.find("LOST") != string::npos || l.find("FAILURE") != string::npos)
-                        cout << Color::RED << l << Color::RESET << endl;
+                        out << Color::RED << l << Color::RESET << "\n";
                     else if(l.find("DISPATCH") != string::npos || l.find("ARRIVAL") != string::npos)
-                        cout << Color::GREEN << l << Color::RESET << endl;
+                        out << Color::GREEN << l << Color::RESET << "\n";
                     else if(l.find("REROUTE") != string::npos)
-                        cout << Color::MAGENTA << l << Color::RESET << endl;
+                        out << Color::MAGENTA << l << Color::RESET << "\n";
                     else if(l.find("DEFER") != string::npos)
-                        cout << Color::YELLOW << l << Color::RESET << endl;
+                        out << Color::YELLOW << l << Color::RESET << "\n";
                     else
-                        cout << l << endl;
+                        out << l << "\n";
                 }
             }
             
-            cout << Color::BLUE << "========================================================\n" << Color::RESET;
-            cout << " [M] Menu/Block Route  |  [Ctrl+C] Exit\n";
+            out << Color::BLUE << "========================================================\n" << Color::RESET;
+            out << " [M] Menu/Block Route  |  [Ctrl+C] Exit\n";
 
-            this_thread::sleep_for(chrono::seconds(1));
+            screen.present();
+            this_thread::sleep_for(chrono::milliseconds(refreshMs));
         }
     }
 };
 
-int main() {
-    AdminPanel admin;
+// Ctrl+C leaves the dashboard with the cursor hidden and keys unechoed;
+// give both back
+void onInterrupt(int) {
+    restoreLineMode();
+    writeTerminal("\033[0m\033[?25h\n", 11);
+    _exit(0);
+}
+
+int main(int argc, char** argv) {
+    int refreshMs = 250;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(arg == "--refresh-ms" && i + 1 < argc && atoi(argv[i + 1]) > 0) refreshMs = atoi(argv[++i]);
+        else {
+            cout << Color::RED << "[!] Unknown or invalid option: " << arg << Color::RESET << "\n"
+                 << "Usage: " << argv[0] << " [--refresh-ms N]\n";
+            return 1;
+        }
+    }
+    string error;
+    if(!loadHubNames(error)) {
+        cout << Color::RED << "[!] " << NETWORK_FILE << ": " << error << ". Start the engine (source.cpp) first.\n" << Color::RESET;
+        return 1;
+    }
+    saveLineMode();
+    signal(SIGINT, onInterrupt);
+    AdminPanel admin(refreshMs);
     admin.selectCity();
     admin.dashboardLoop();
     return 0;
@@ -0,0 +1,106 @@
+#pragma once
+
+// Growable array used by both programs (source.cpp and admin.cpp) in place
+// of std::vector.
+template <typename T>
+class Vector {
+    T* arr;
+    int capacity;
+    int currentSize;
+
+public:
+    // Constructor
+    Vector() {
+        capacity = 10;
+        currentSize = 0;
+        arr = new T[capacity];
+    }
+
+    // Destructor
+    ~Vector() {
+        if (arr) delete[] arr;
+    }
+
+    // Copy Constructor (Deep Copy) - Critical for passing structs by value
+    Vector(const Vector& other) {
+        capacity = other.capacity;
+        currentSize = other.currentSize;
+        arr = new T[capacity];
+        for (int i = 0; i < currentSize; i++) {
+            arr[i] = other.arr[i];
+        }
+    }
+
+    // Assignment Operator (Deep Copy)
+    Vector& operator=(const Vector& other) {
+        if (this != &other) {
+            if (arr) delete[] arr;
+            capacity = other.capacity;
+            currentSize = other.currentSize;
+            arr = new T[capacity];
+            for (int i = 0; i < currentSize; i++) {
+                arr[i] = other.arr[i];
+            }
+        }
+        return *this;
+    }
+
+    void push_back(T val) {
+        if (currentSize == capacity) {
+            resize();
+        }
+        arr[currentSize++] = val;
+    }
+
+    void resize() {
+        capacity *= 2;
+        T* newArr = new T[capacity];
+        for (int i = 0; i < currentSize; i++) {
+            newArr[i] = arr[i];
+        }
+        delete[] arr;
+        arr = newArr;
+    }
+
+    T& operator[](int index) {
+        return arr[index];
+    }
+
+    const T& operator[](int index) const {
+        return arr[index];
+    }
+
+    int size() const {
+        return currentSize;
+    }
+
+    bool empty() const {
+        return currentSize == 0;
+    }
+
+    // Keeps the capacity so the vector can be refilled without reallocating
+    void clear() {
+        currentSize = 0;
+    }
+
+    void pop_back() {
+        if (currentSize > 0) currentSize--;
+    }
+
+    // Replaces the contents with `count` copies of `val`
+    void assign(int count, const T& val) {
+        if (count > capacity) {
+            delete[] arr;
+            capacity = count;
+            arr = new T[capacity];
+        }
+        currentSize = count;
+        for (int i = 0; i < count; i++) arr[i] = val;
+    }
+
+    // Iterator support for range-based for loops
+    T* begin() { return arr; }
+    T* end() { return arr + currentSize; }
+    const T* begin() const { return arr; }
+    const T* end() const { return arr + currentSize; }
+};
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "custom_vector.h"
+
+// --- ROAD NETWORK (RUNTIME-LOADED) ---
+// Hubs, office names, per-hub fleet sizes and two-way roads are read from
+// network.txt. Roads are kept in compressed-sparse-row form: the roads
+// leaving hub u are adjHub/adjKm[rowStart[u] .. rowStart[u+1]).
+// An optional COORDS section gives each hub a position in km, which lets the
+// A* router aim its search. After the first parse a binary image is written
+// to network.bin and reused while network.txt keeps its size and content
+// hash; an image that does not add up is ignored and the text parsed again.
+// Shared by the engine and the admin panel, which reads hub names from it.
+const char NETWORK_FILE[] = "network.txt";
+const char NETWORK_CACHE_FILE[] = "network.bin";
+const int MAX_HUBS = 65535;         // Hub ids must fit the 16-bit city field of tracking keys
+const int MAX_OFFICES = 256;        // Office ids are stored in one byte per parcel
+
+class Network {
+    struct CacheHeader {
+        char magic[8];
+        long long sourceSize;
+        unsigned long long sourceHash;  // FNV-1a of network.txt
+        int hubCount;
+        int officeCount;
+        int edgeSlots;
+        int namesBytes;
+        int officesBytes;
+        int hasCoords;
+    };
+
+    static bool nextToken(std::ifstream& f, std::string& tok) {
+        while(f >> tok) {
+            if(tok[0] != '#') return true;
+            std::string rest;
+            std::getline(f, rest);       // Comment runs to end of line
+        }
+        return false;
+    }
+
+    static bool nextInt(std::ifstream& f, int& v) {
+        std::string tok;
+        if(!nextToken(f, tok)) return false;
+        char* end;
+        long x = strtol(tok.c_str(), &end, 10);
+        if(*end != '\0') return false;
+        v = (int)x;
+        return true;
+    }
+
+    bool parseText(const char* path, std::string& error) {
+        std::ifstream f(path);
+        if(!f.is_open()) { error = "cannot open " + std::string(path); return false; }
+
+        std::string tok;
+        Vector<int> roadU, roadV, roadKm;
+        hubCount = -1;
+        while(nextToken(f, tok)) {
+            int count;
+            if(!nextInt(f, count) || count < 0) { error = "bad count after " + tok; return false; }
+            if(tok == "HUBS") {
+                if(count < 1 || count > MAX_HUBS) { error = "HUBS must be 1.." + std::to_string(MAX_HUBS); return false; }
+                hubCount = count;
+                for(int i = 0; i < count; i++) {
+                    int id, b3, b6, t2;
+                    std::string name;
+                    if(!nextInt(f, id) || id != i || !nextToken(f, name) ||
+                       !nextInt(f, b3) || !nextInt(f, b6) || !nextInt(f, t2)) {
+                        error = "bad HUBS line for hub " + std::to_string(i);
+                        return false;
+                    }
+                    hubNames.push_back(name);
+                    bus300.push_back(b3);
+                    bus600.push_back(b6);
+                    truck2000.push_back(t2);
+                }
+            } else if(tok == "OFFICES") {
+                if(count > MAX_OFFICES) { error = "OFFICES must be 1.." + std::to_string(MAX_OFFICES); return false; }
+                for(int i = 0; i < count; i++) {
+                    if(!nextToken(f, tok)) { error = "missing office name"; return false; }
+                    officeNames.push_back(tok);
+                }
+            } else if(tok == "COORDS") {
+                if(count != hubCount) { error = "COORDS must follow HUBS and list every hub"; return false; }
+                x.assign(count, 0);
+                y.assign(count, 0);
+                for(int i = 0; i < count; i++) {
+                    int id;
+                    std::string xs, ys;
+                    if(!nextInt(f, id) || id != i || !nextToken(f, xs) || !nextToken(f, ys)) {
+                        error = "bad COORDS line for hub " + std::to_string(i);
+                        return false;
+                    }
+                    x[i] = strtof(xs.c_str(), nullptr);
+                    y[i] = strtof(ys.c_str(), nullptr);
+                }
+                hasCoords = true;
+            } else if(tok == "ROADS") {
+                for(int i = 0; i < count; i++) {
+                    int u, v, km;
+                    if(!nextInt(f, u) || !nextInt(f, v) || !nextInt(f, km)) {
+                        error = "bad ROADS line " + std::to_string(i);
+                        return false;
+                    }
+                    roadU.push_back(u); roadV.push_back(v); roadKm.push_back(km);
+                }
+            } else {
+                error = "unknown section " + tok;
+                return false;
+            }
+        }
+        if(hubCount < 1) { error = "no HUBS section"; return false; }
+        if(officeNames.empty()) { error = "no OFFICES section"; return false; }
+
+        // Counting pass, prefix sum, then fill (both directions per road)
+        rowStart.assign(hubCount + 1, 0);
+        for(int i = 0; i < roadU.size(); i++) {
+            int u = roadU[i], v = roadV[i];
+            if(u < 0 || u >= hubCount || v < 0 || v >= hubCount || u == v || roadKm[i] <= 0) {
+                error = "bad road " + std::to_string(u) + "-" + std::to_string(v);
+                return false;
+            }
+            rowStart[u + 1]++;
+            rowStart[v + 1]++;
+        }
+        for(int i = 0; i < hubCount; i++) rowStart[i + 1] += rowStart[i];
+        adjHub.assign(rowStart[hubCount], 0);
+        adjKm.assign(rowStart[hubCount], 0);
+        Vector<int> fill = rowStart;
+        for(int i = 0; i < roadU.size(); i++) {
+            int u = roadU[i], v = roadV[i];
+            adjHub[fill[u]] = v; adjKm[fill[u]++] = roadKm[i];
+            adjHub[fill[v]] = u; adjKm[fill[v]++] = roadKm[i];
+        }
+
+        // One road per pair: the graph finds, blocks and measures a road by
+        // its two hubs, so a second one would be left open and unreported
+        Vector<int> seenFrom;
+        seenFrom.assign(hubCount, -1);
+        for(int u = 0; u < hubCount; u++) {
+            for(int e = rowStart[u]; e < rowStart[u + 1]; e++) {
+                int v = adjHub[e];
+                if(seenFrom[v] == u) {
+                    error = "duplicate road " + std::to_string(u < v ? u : v) + "-" + std::to_string(u < v ? v : u);
+                    return false;
+                }
+                seenFrom[v] = u;
+            }
+        }
+        return true;
+    }
+
+    static void writeNames(FILE* out, const Vector<std::string>& names) {
+        for(const std::string& s : names) fwrite(s.c_str(), 1, s.size() + 1, out);
+    }
+
+    // Fails if the blob runs out before `count` terminated names
+    static bool readNames(const char* blob, const char* end, int count, Vector<std::string>& names) {
+        for(int i = 0; i < count; i++) {
+            const char* nul = (const char*)memchr(blob, '\0', end - blob);
+            if(!nul) return false;
+            names.push_back(std::string(blob, nul - blob));
+            blob = nul + 1;
+        }
+        return true;
+    }
+
+    static int namesBytes(const Vector<std::string>& names) {
+        int total = 0;
+        for(const std::string& s : names) total += s.size() + 1;
+        return total;
+    }
+
+    // FNV-1a over the whole file; false if it cannot be read
+    static bool hashFile(const char* path, long long& size, unsigned long long& hash) {
+        FILE* in = fopen(path, "rb");
+        if(!in) return false;
+        char buf[64 * 1024];
+        size = 0;
+        hash = 14695981039346656037ull;
+        size_t n;
+        while((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            for(size_t i = 0; i < n; i++) { hash ^= (unsigned char)buf[i]; hash *= 1099511628211ull; }
+            size += n;
+        }
+        bool ok = !ferror(in);
+        fclose(in);
+        return ok;
+    }
+
+    // Written beside the final path and renamed over it, so a reader never
+    // sees half an image
+    void writeCache(const char* path, long long size, unsigned long long hash) {
+        std::string temp = std::string(path) + ".tmp";
+        FILE* out = fopen(temp.c_str(), "wb");
+        if(!out) return;
+        CacheHeader h;
+        memcpy(h.magic, "SWXNET04", 8);
+        h.sourceSize = size;
+        h.sourceHash = hash;
+        h.hubCount = hubCount;
+        h.officeCount = officeNames.size();
+        h.edgeSlots = adjHub.size();
+        h.namesBytes = namesBytes(hubNames);
+        h.officesBytes = namesBytes(officeNames);
+        h.hasCoords = hasCoords ? 1 : 0;
+        fwrite(&h, sizeof(h), 1, out);
+        fwrite(bus300.begin(), sizeof(int), hubCount, out);
+        fwrite(bus600.begin(), sizeof(int), hubCount, out);
+        fwrite(truck2000.begin(), sizeof(int), hubCount, out);
+        fwrite(rowStart.begin(), sizeof(int), hubCount + 1, out);
+        fwrite(adjHub.begin(), sizeof(int), h.edgeSlots, out);
+        fwrite(adjKm.begin(), sizeof(int), h.edgeSlots, out);
+        writeNames(out, hubNames);
+        writeNames(out, officeNames);
+        if(hasCoords) {
+            fwrite(x.begin(), sizeof(float), hubCount, out);
+            fwrite(y.begin(), sizeof(float), hubCount, out);
+        }
+        bool ok = !ferror(out);
+        ok = fclose(out) == 0 && ok;
+#ifdef _WIN32
+        ok = ok && MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        ok = ok && rename(temp.c_str(), path) == 0;
+#endif
+        if(!ok) remove(temp.c_str());
+    }
+
+    // Roads must form a CSR image over hubCount hubs
+    bool validGraph() const {
+        if(rowStart[0] != 0 || rowStart[hubCount] != adjHub.size()) return false;
+        for(int i = 0; i < hubCount; i++) {
+            if(rowStart[i + 1] < rowStart[i]) return false;
+        }
+        for(int e = 0; e < adjHub.size(); e++) {
+            if(adjHub[e] < 0 || adjHub[e] >= hubCount || adjKm[e] <= 0) return false;
+        }
+        return true;
+    }
+
+    // Every size in the header is checked against the file length before
+    // anything is allocated, so a stale or corrupt image just fails
+    bool loadCache(const char* path, long long size, unsigned long long hash) {
+        FILE* in = fopen(path, "rb");
+        if(!in) return false;
+        CacheHeader h;
+        bool ok = fread(&h, sizeof(h), 1, in) == 1 && memcmp(h.magic, "SWXNET04", 8) == 0 &&
+                  h.sourceSize == size && h.sourceHash == hash &&
+                  h.hubCount >= 1 && h.hubCount <= MAX_HUBS && h.edgeSlots >= 0 &&
+                  h.officeCount >= 1 && h.officeCount <= MAX_OFFICES &&
+                  h.namesBytes >= h.hubCount && h.officesBytes >= h.officeCount &&
+                  (long long)h.namesBytes + h.officesBytes < INT_MAX;
+        long long fileBytes = -1;
+        if(ok && fseek(in, 0, SEEK_END) == 0) fileBytes = ftell(in);
+        long long expected = (long long)sizeof(h) + 4LL * (3LL * h.hubCount + h.hubCount + 1 + 2LL * h.edgeSlots) +
+                             h.namesBytes + h.officesBytes + (h.hasCoords ? 8LL * h.hubCount : 0);
+        ok = ok && fileBytes == expected && fseek(in, sizeof(h), SEEK_SET) == 0;
+        if(ok) {
+            hubCount = h.hubCount;
+            bus300.assign(hubCount, 0);
+            bus600.assign(hubCount, 0);
+            truck2000.assign(hubCount, 0);
+            rowStart.assign(hubCount + 1, 0);
+            adjHub.assign(h.edgeSlots, 0);
+            adjKm.assign(h.edgeSlots, 0);
+            int blobBytes = h.namesBytes + h.officesBytes;
+            char* blob = new char[blobBytes];
+            ok = fread(bus300.begin(), sizeof(int), hubCount, in) == (size_t)hubCount &&
+                 fread(bus600.begin(), sizeof(int), hubCount, in) == (size_t)hubCount &&
+                 fread(truck2000.begin(), sizeof(int), hubCount, in) == (size_t)hubCount &&
+                 fread(rowStart.begin(), sizeof(int), hubCount + 1, in) == (size_t)hubCount + 1 &&
+                 fread(adjHub.begin(), sizeof(int), h.edgeSlots, in) == (size_t)h.edgeSlots &&
+                 fread(adjKm.begin(), sizeof(int), h.edgeSlots, in) == (size_t)h.edgeSlots &&
+                 fread(blob, 1, blobBytes, in) == (size_t)blobBytes;
+            ok = ok && validGraph() &&
+                 readNames(blob, blob + h.namesBytes, hubCount, hubNames) &&
+                 readNames(blob + h.namesBytes, blob + blobBytes, h.officeCount, officeNames);
+            if(ok && h.hasCoords) {
+                x.assign(hubCount, 0);
+                y.assign(hubCount, 0);
+                ok = fread(x.begin(), sizeof(float), hubCount, in) == (size_t)hubCount &&
+                     fread(y.begin(), sizeof(float), hubCount, in) == (size_t)hubCount;
+                hasCoords = ok;
+            }
+            delete[] blob;
+        }
+        fclose(in);
+        return ok;
+    }
+
+public:
+    int hubCount;
+    Vector<std::string> hubNames;
+    Vector<std::string> officeNames;
+    Vector<int> bus300;             // Fleet size per hub, restored every day
+    Vector<int> bus600;
+    Vector<int> truck2000;
+    Vector<int> rowStart;           // CSR: hubCount + 1 offsets
+    Vector<int> adjHub;             // CSR: neighbour hub per edge slot
+    Vector<int> adjKm;              // CSR: road length per edge slot
+    Vector<float> x, y;             // Hub positions in km (only if hasCoords)
+    bool hasCoords;
+
+    Network() { hubCount = 0; hasCoords = false; }
+
+    int edgeCount() const { return adjHub.size(); }
+
+    // Direct road length u->v, or -1 when there is no road
+    int roadKm(int u, int v) const {
+        for(int e = rowStart[u]; e < rowStart[u + 1]; e++) {
+            if(adjHub[e] == v) return adjKm[e];
+        }
+        return -1;
+    }
+
+    bool load(const char* path, const char* cachePath, std::string& error) {
+        long long size;
+        unsigned long long hash;
+        if(!hashFile(path, size, hash)) { error = "cannot open " + std::string(path); return false; }
+        if(loadCache(cachePath, size, hash)) return true;
+
+        *this = Network();
+        if(!parseText(path, error)) return false;
+        writeCache(cachePath, size, hash);
+        return true;
+    }
+};
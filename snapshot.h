@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// --- SHARED STATE SNAPSHOT (state.snap) ---
+// Fixed binary layout shared by the engine (SnapshotPublisher) and the
+// admin panel (SnapshotReader) through this header. The engine
+// maps the file and rewrites it in place every tick under a seqlock: `seq`
+// is odd while a write is in progress, and a reader retries whenever it
+// saw an odd value or the value changed during its copy. Readers map the
+// file once and never parse or make a syscall to refresh.
+const char SNAPSHOT_FILE[] = "state.snap";
+const char SNAPSHOT_MAGIC[8] = {'S', 'W', 'X', 'S', 'N', 'A', 'P', '2'};
+const int SNAPSHOT_MAX_TRIPS = 65536;
+const int SNAPSHOT_MAX_HUBS = 4096;     // Per-city rows beyond this are not published
+const int SNAPSHOT_STATUSES = 5;        // Booked, In Transit, Delivered, LOST, Cancelled
+
+struct SnapshotCounters {
+    int day;
+    int second;
+    long long booked;
+    long long transit;
+    long long lost;
+    long long delivered;
+    long long cancelled;
+    long long systemAllocsLastTick;
+    long long systemAllocsTotal;
+    long long poolLiveObjects;
+    long long logWritten;
+    long long logDropped;
+    long long logTruncated;
+    long long logBacklog;
+    int tripCount;                  // Rows of trips[] in use
+    int tripsOnRoad;                // Exceeds tripCount when the table is full
+    int hubCount;                   // Rows of cities[] in use
+};
+
+// Parcels per status, by source city
+struct SnapshotCity {
+    long long counts[SNAPSHOT_STATUSES];
+};
+
+struct SnapshotTrip {
+    int src, dest;
+    int traveledKm, totalKm;
+    char vehicle[16];
+};
+
+struct StateSnapshot {
+    char magic[8];
+    std::atomic<unsigned long long> seq;
+    SnapshotCounters counters;
+    SnapshotCity cities[SNAPSHOT_MAX_HUBS];
+    SnapshotTrip trips[SNAPSHOT_MAX_TRIPS];
+};
+static_assert(std::atomic<unsigned long long>::is_always_lock_free, "seqlock counter must be lock-free to live in shared memory");
+
+// Maps a file of `size` bytes into memory, read-write (created and sized
+// if needed) or read-only (must already be that large).
+class MappedFile {
+    void* base;
+    size_t length;
+    bool heapCopy;                  // openPrivate on Windows: a plain read
+#ifdef _WIN32
+    HANDLE file, mapping;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile() {
+        base = nullptr;
+        length = 0;
+        heapCopy = false;
+#ifdef _WIN32
+        file = mapping = nullptr;
+#else
+        fd = -1;
+#endif
+    }
+
+    ~MappedFile() { close(); }
+
+    void* open(const char* path, size_t size, bool writable) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) { file = nullptr; return nullptr; }
+        LARGE_INTEGER current;
+        if (!GetFileSizeEx(file, &current) || (!writable && (size_t)current.QuadPart < size)) { close(); return nullptr; }
+        mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                     (DWORD)((unsigned long long)size >> 32), (DWORD)size, nullptr);
+        if (!mapping) { close(); return nullptr; }
+        base = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+#else
+        fd = ::open(path, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { close(); return nullptr; }
+        if ((size_t)st.st_size < size) {
+            if (!writable || ftruncate(fd, size) != 0) { close(); return nullptr; }
+        }
+        base = mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) base = nullptr;
+#endif
+        if (!base) { close(); return nullptr; }
+        length = size;
+        return base;
+    }
+
+    // The whole file, writable copy-on-write: changes stay in this process
+    // and pages are read from disk only when first touched. Windows cannot
+    // replace a mapped file, so there it is read into memory instead.
+    void* openPrivate(const char* path, size_t& size) {
+        close();
+#ifdef _WIN32
+        FILE* in = fopen(path, "rb");
+        if (!in) return nullptr;
+        struct _stat64 st;
+        if (_fstat64(_fileno(in), &st) == 0 && st.st_size > 0) {
+            base = new char[(size_t)st.st_size];
+            if (fread(base, 1, (size_t)st.st_size, in) != (size_t)st.st_size) { delete[] (char*)base; base = nullptr; }
+        }
+        fclose(in);
+        if (!base) return nullptr;
+        heapCopy = true;
+        length = (size_t)st.st_size;
+#else
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(); return nullptr; }
+        base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) { base = nullptr; close(); return nullptr; }
+        ::close(fd);
+        fd = -1;
+        length = st.st_size;
+#endif
+        size = length;
+        return base;
+    }
+
+    void close() {
+        if (heapCopy) {
+            delete[] (char*)base;
+            heapCopy = false;
+            base = nullptr;
+        }
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file) CloseHandle(file);
+        file = mapping = nullptr;
+#else
+        if (base) munmap(base, length);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        base = nullptr;
+        length = 0;
+    }
+};
+
+// Engine side: the single writer of state.snap
+class SnapshotPublisher {
+    MappedFile file;
+    StateSnapshot* snap;
+
+public:
+    SnapshotPublisher() { snap = nullptr; }
+
+    bool open(const char* path) {
+        snap = (StateSnapshot*)file.open(path, sizeof(StateSnapshot), true);
+        if (!snap) return false;
+        // A writer that died mid-update leaves seq odd; step past it
+        unsigned long long seq = snap->seq.load();
+        if (seq & 1) snap->seq.store(seq + 1);
+        memcpy(snap->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        return true;
+    }
+
+    bool isOpen() const { return snap != nullptr; }
+
+    // Returns the snapshot to fill in; readers retry until endWrite()
+    StateSnapshot* beginWrite() {
+        unsigned long long seq = snap->seq.load(std::memory_order_relaxed);
+        snap->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return snap;
+    }
+
+    void endWrite() {
+        snap->seq.store(snap->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+// Admin side: copies a consistent snapshot out of the shared mapping
+class SnapshotReader {
+    MappedFile file;
+    const StateSnapshot* snap;
+
+public:
+    SnapshotReader() { snap = nullptr; }
+
+    // Maps state.snap once the engine has created it
+    bool attach() {
+        if (snap) return true;
+        const StateSnapshot* s = (const StateSnapshot*)file.open(SNAPSHOT_FILE, sizeof(StateSnapshot), false);
+        if (!s || memcmp(s->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            file.close();
+            return false;
+        }
+        snap = s;
+        return true;
+    }
+
+    // Copies the counters, trip rows and one city's row; false until the
+    // engine is up or if no consistent copy could be taken
+    bool read(SnapshotCounters& counters, SnapshotTrip* trips, int city, SnapshotCity& cityRow) {
+        if (!attach()) return false;
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            unsigned long long before = snap->seq.load(std::memory_order_acquire);
+            if (before & 1) { std::this_thread::yield(); continue; }
+            memcpy(&counters, &snap->counters, sizeof(counters));
+            int rows = counters.tripCount;
+            if (rows < 0 || rows > SNAPSHOT_MAX_TRIPS) rows = 0;   // Torn copy, rejected below
+            memcpy(trips, snap->trips, rows * sizeof(SnapshotTrip));
+            if (city >= 0 && city < SNAPSHOT_MAX_HUBS) memcpy(&cityRow, &snap->cities[city], sizeof(cityRow));
+            else memset(&cityRow, 0, sizeof(cityRow));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (snap->seq.load(std::memory_order_relaxed) == before) {
+                counters.tripCount = rows;
+                return true;
+            }
+        }
+        return false;
+    }
+};
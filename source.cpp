@@ -3,11 +3,39 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <chrono>
 #include <ctime>
 #include <climits>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
+#include <sstream>
+#include <new>
+#include <utility>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#endif
+#include "custom_vector.h"
+#include "network.h"
+#include "snapshot.h"
 
 using namespace std;
 
@@ -28,34 +56,142 @@ namespace Color {
 // =========================================================
 // 1. CONFIGURATION & CONSTANTS
 // =========================================================
-const int MAX_CITIES = 8;
 const int SECONDS_PER_DAY = 180; 
 const int SECONDS_PER_NODE = 2;
+const int DISPATCH_SECOND = 150;    // Second of the day the dispatch wave runs
 
-const string CITIES[MAX_CITIES] = {
-    "Lahore", "Karachi", "Islamabad", "Multan",
-    "Faisalabad", "Peshawar", "Quetta", "Sialkot"
+// =========================================================
+// 2. CUSTOM DATA STRUCTURES (NO STL)
+// =========================================================
+// Vector is in custom_vector.h, shared with admin.cpp
+
+// --- MEMORY: ALLOCATION COUNTERS ---
+// Every heap request made by the pools/arenas below is counted, so a tick's
+// delta of systemAllocs shows whether steady-state work touched malloc.
+struct AllocCounters {
+    atomic<long long> systemAllocs;   // Slabs/chunks requested from the heap
+    atomic<long long> poolAllocs;     // Objects handed out by pools
+    atomic<long long> poolFrees;      // Objects returned to pools
+    atomic<long long> arenaResets;    // Day arenas released in bulk
 };
+AllocCounters allocStats;
+
+// --- MEMORY: SLAB POOL ---
+// Fixed-size objects carved from 256-object slabs and recycled through a free
+// list. Slabs are never returned to the heap. Not thread-safe: every user
+// runs under dataMutex.
+template <typename T>
+class ObjectPool {
+    static const int SLAB_SIZE = 256;
+    union Cell {
+        Cell* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    struct Slab {
+        Cell cells[SLAB_SIZE];
+        Slab* next;
+    };
+    Slab* slabs;
+    Cell* freeList;
 
-const string OFFICES[6] = {"Hub", "Office-1", "Office-2", "Office-3", "Office-4", "Office-5"};
+    void grow() {
+        Slab* s = new Slab();
+        allocStats.systemAllocs++;
+        s->next = slabs;
+        slabs = s;
+        for(int i = SLAB_SIZE - 1; i >= 0; i--) {
+            s->cells[i].next = freeList;
+            freeList = &s->cells[i];
+        }
+    }
+
+public:
+    ObjectPool() { slabs = nullptr; freeList = nullptr; }
+
+    // One pool per type, shared by every LinkedList<T>
+    static ObjectPool& instance() {
+        static ObjectPool pool;
+        return pool;
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if(!freeList) grow();
+        Cell* c = freeList;
+        freeList = c->next;
+        allocStats.poolAllocs++;
+        return new (c->storage) T(std::forward<Args>(args)...);
+    }
 
-const int DIST_MATRIX[8][8] = {
-    {0, 15, 8, 6, 4, 10, 14, 3},
-    {15, 0, 12, 10, 13, 14, 6, 14},
-    {8, 12, 0, 6, 7, 4, 13, 10},
-    {6, 10, 6, 0, 5, 9, 12, 7},
-    {4, 13, 7, 5, 0, 8, 14, 5},
-    {10, 14, 4, 9, 8, 0, 13, 11},
-    {14, 6, 13, 12, 14, 13, 0, 15},
-    {3, 14, 10, 7, 5, 11, 15, 0}
+    void destroy(T* obj) {
+        obj->~T();
+        Cell* c = reinterpret_cast<Cell*>(obj);
+        c->next = freeList;
+        freeList = c;
+        allocStats.poolFrees++;
+    }
 };
 
-mutex dataMutex;
-mutex fileMutex;
+// --- MEMORY: DAY ARENA ---
+// Bump allocator for everything a dispatch wave creates (Trips and their
+// parcel manifests). Objects are never freed one by one; the whole arena is
+// reset once its last trip is delivered, and its chunks are kept for reuse.
+class DayArena {
+    static const size_t CHUNK_SIZE = 64 * 1024;
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+        size_t used;
+        unsigned char* data;
+    };
+    Chunk* chunks;
+    Chunk* currentChunk;
 
-// =========================================================
-// 2. CUSTOM DATA STRUCTURES (NO STL)
-// =========================================================
+    Chunk* newChunk(size_t minSize) {
+        Chunk* c = new Chunk();
+        c->size = minSize > CHUNK_SIZE ? minSize : CHUNK_SIZE;
+        c->used = 0;
+        c->data = new unsigned char[c->size];
+        c->next = nullptr;
+        allocStats.systemAllocs += 2;
+        return c;
+    }
+
+public:
+    long long day;       // Absolute simulation day this arena serves
+    int liveTrips;       // Trips still referencing this arena
+    DayArena* next;      // Engine's arena list
+
+    DayArena() {
+        chunks = currentChunk = nullptr;
+        day = -1;
+        liveTrips = 0;
+        next = nullptr;
+    }
+
+    void* allocate(size_t bytes) {
+        bytes = (bytes + 15) & ~(size_t)15;
+        while(currentChunk && currentChunk->used + bytes > currentChunk->size) {
+            currentChunk = currentChunk->next;
+        }
+        if(!currentChunk) {
+            Chunk* c = newChunk(bytes);
+            c->next = chunks;
+            chunks = c;
+            currentChunk = c;
+        }
+        void* p = currentChunk->data + currentChunk->used;
+        currentChunk->used += bytes;
+        return p;
+    }
+
+    void reset() {
+        for(Chunk* c = chunks; c; c = c->next) c->used = 0;
+        currentChunk = chunks;
+        liveTrips = 0;
+        allocStats.arenaResets++;
+    }
+};
 
 template <typename T>
 class ListNode {
@@ -75,7 +211,7 @@ public:
     LinkedList() { head = tail = nullptr; size = 0; }
     
     void append(T val) {
-        ListNode<T>* newNode = new ListNode<T>(val);
+        ListNode<T>* newNode = ObjectPool<ListNode<T>>::instance().create(val);
         if (!head) {
             head = tail = newNode;
         } else {
@@ -89,12 +225,23 @@ public:
         while(head) {
             ListNode<T>* temp = head;
             head = head->next;
-            delete temp;
+            ObjectPool<ListNode<T>>::instance().destroy(temp);
         }
         tail = nullptr;
         size = 0;
     }
     
+    // Unlinks the node after prev (or the head when prev is null)
+    void removeAfter(ListNode<T>* prev) {
+        ListNode<T>* victim = prev ? prev->next : head;
+        if(!victim) return;
+        if(prev) prev->next = victim->next;
+        else head = victim->next;
+        if(tail == victim) tail = prev;
+        ObjectPool<ListNode<T>>::instance().destroy(victim);
+        size--;
+    }
+    
     bool isEmpty() { return size == 0; }
 };
 
@@ -117,6 +264,11 @@ public:
         pos = new int[cap];
     }
 
+    ~MinHeap() {
+        delete[] array;
+        delete[] pos;
+    }
+
     void swapNodes(int a, int b) {
         HeapNode t = array[a];
         array[a] = array[b];
@@ -175,475 +327,5522 @@ public:
     }
 };
 
-// =========================================================
-// 3. CORE CLASSES
-// =========================================================
+// Binary heap of (key, vertex) with lazy deletion: a vertex is pushed again
+// when its key drops and stale entries are skipped by the caller. Unlike
+// MinHeap it needs no per-vertex position array, so a point-to-point query
+// only touches the vertices it actually reaches.
+class QueryHeap {
+public:
+    struct Entry {
+        long long key;
+        int v;
+    };
+
+private:
+    Vector<Entry> heap;
 
-class Parcel {
 public:
-    string id;
-    int srcCity, srcOffice;
-    int destCity, destOffice;
-    int weight;
-    int priority; // 1=Overnight, 2=2Day, 3=Normal
-    string status;
-    int bookingDay;
-    long long dispatchTime; 
-    int totalRouteDistance; 
-    
-    Parcel(string i, int sC, int sO, int dC, int dO, int w, int p, int d) 
-        : id(i), srcCity(sC), srcOffice(sO), destCity(dC), destOffice(dO), 
-          weight(w), priority(p), bookingDay(d) {
-        status = "Booked";
-        dispatchTime = 0;
-        totalRouteDistance = 0;
+    void clear() { heap.clear(); }
+    bool isEmpty() const { return heap.empty(); }
+    const Entry& top() const { return heap[0]; }
+
+    void push(long long key, int v) {
+        heap.push_back({key, v});
+        int i = heap.size() - 1;
+        while (i > 0 && heap[(i - 1) / 2].key > heap[i].key) {
+            Entry t = heap[i]; heap[i] = heap[(i - 1) / 2]; heap[(i - 1) / 2] = t;
+            i = (i - 1) / 2;
+        }
+    }
+
+    void pop() {
+        heap[0] = heap[heap.size() - 1];
+        heap.pop_back();
+        int i = 0, n = heap.size();
+        while (true) {
+            int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+            if (l < n && heap[l].key < heap[smallest].key) smallest = l;
+            if (r < n && heap[r].key < heap[smallest].key) smallest = r;
+            if (smallest == i) break;
+            Entry t = heap[i]; heap[i] = heap[smallest]; heap[smallest] = t;
+            i = smallest;
+        }
     }
 };
 
-// --- DATA STRUCTURE: HASH TABLE FOR O(1) LOOKUP ---
-class ParcelHashTable {
-    static const int TABLE_SIZE = 1009; // Prime number for better distribution
-    LinkedList<Parcel*>* table[TABLE_SIZE];
+// --- DATA STRUCTURE: HIERARCHICAL TIMING WHEEL ---
+// Schedules intrusive items (T needs `T* wheelNext` and `long long wheelDue`)
+// by integer tick. Three levels of 256 slots cover 2^24 ticks ahead; items
+// further out wait in an overflow list. Scheduling is O(1) and a tick only
+// touches the items due on it, plus the occasional cascade of one
+// higher-level slot down a level.
+template <typename T>
+class TimingWheel {
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 3;
+    static const long long SLOT_MASK = SLOTS - 1;
+
+    T* slots[LEVELS][SLOTS];
+    T* overflow;
+    long long now;                  // Last tick processed
+    int count;
+
+    void place(T* item) {
+        long long delta = item->wheelDue - now;
+        T** bucket = &overflow;
+        for (int level = 0; level < LEVELS; level++) {
+            if (delta < (1LL << (SLOT_BITS * (level + 1)))) {
+                bucket = &slots[level][(item->wheelDue >> (SLOT_BITS * level)) & SLOT_MASK];
+                break;
+            }
+        }
+        item->wheelNext = *bucket;
+        *bucket = item;
+    }
+
+    static long long earliest(const T* item, long long best) {
+        for (; item; item = item->wheelNext) if (item->wheelDue < best) best = item->wheelDue;
+        return best;
+    }
 
-   unsigned long hash(string key) {
-        unsigned long hash = 5381;
-        for (char c : key) {
-            hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+    void cascade(T** bucket) {
+        T* item = *bucket;
+        *bucket = nullptr;
+        while (item) {
+            T* next = item->wheelNext;
+            place(item);
+            item = next;
         }
-        return hash % TABLE_SIZE;
     }
 
 public:
-    ParcelHashTable() {
-        for(int i=0; i<TABLE_SIZE; i++) table[i] = nullptr;
+    TimingWheel(long long start = 0) {
+        for (int l = 0; l < LEVELS; l++)
+            for (int s = 0; s < SLOTS; s++) slots[l][s] = nullptr;
+        overflow = nullptr;
+        now = start;
+        count = 0;
     }
 
-    void insert(Parcel* p) {
-        unsigned long idx = hash(p->id);
-        if(table[idx] == nullptr) {
-            table[idx] = new LinkedList<Parcel*>();
-        }
-        // Collision Handling: Chaining via LinkedList
-        table[idx]->append(p);
+    // Due ticks at or before the current one fire on the next tick
+    void schedule(T* item, long long due) {
+        item->wheelDue = due > now ? due : now + 1;
+        place(item);
+        count++;
     }
 
-    Parcel* search(string id) {
-        unsigned long idx = hash(id);
-        if(table[idx] == nullptr) return nullptr;
+    // Advances to `tick` and returns every item that became due, chained
+    // through wheelNext.
+    T* advanceTo(long long tick) {
+        T* due = nullptr;
+        while (now < tick) {
+            now++;
+            // Higher levels first, so their items can fall through this tick
+            if ((now & ((1LL << (SLOT_BITS * LEVELS)) - 1)) == 0) cascade(&overflow);
+            for (int level = LEVELS - 1; level >= 1; level--) {
+                if ((now & ((1LL << (SLOT_BITS * level)) - 1)) == 0)
+                    cascade(&slots[level][(now >> (SLOT_BITS * level)) & SLOT_MASK]);
+            }
+            T** bucket = &slots[0][now & SLOT_MASK];
+            while (*bucket) {
+                T* item = *bucket;
+                *bucket = item->wheelNext;
+                item->wheelNext = due;
+                due = item;
+                count--;
+            }
+        }
+        return due;
+    }
 
-        ListNode<Parcel*>* curr = table[idx]->head;
-        while(curr) {
-            if(curr->data->id == id) return curr->data;
-            curr = curr->next;
+    // Earliest due tick after the current one, capped at `limit`. Peeks at
+    // most limit - now level-0 slots, plus the slots that would cascade.
+    long long nextDue(long long limit) const {
+        long long best = limit;
+        for (long long t = now + 1; t < best; t++) {
+            if (slots[0][t & SLOT_MASK]) return t;
+            if ((t & ((1LL << (SLOT_BITS * LEVELS)) - 1)) == 0) best = earliest(overflow, best);
+            for (int level = 1; level < LEVELS; level++) {
+                if ((t & ((1LL << (SLOT_BITS * level)) - 1)) == 0)
+                    best = earliest(slots[level][(t >> (SLOT_BITS * level)) & SLOT_MASK], best);
+            }
         }
-        return nullptr;
+        return best;
     }
+
+    long long currentTick() const { return now; }
+    int size() const { return count; }
 };
 
-class Graph {
-    struct AdjListNode {
-        int dest;
-        int weight;
-        AdjListNode* next;
-        AdjListNode(int d, int w) : dest(d), weight(w), next(nullptr) {}
+// --- DATA STRUCTURE: BOUNDED MPSC RING BUFFER ---
+// Lock-free multi-producer / single-consumer queue (Vyukov's bounded
+// sequence-slot design). Each slot's sequence number says whether it is
+// free for the producer at position p (seq == p) or holds data for the
+// consumer (seq == p + 1). A full ring rejects the push instead of waiting.
+template <typename T>
+class MpscRing {
+    struct Slot {
+        atomic<unsigned long long> seq;
+        T value;
     };
-    AdjListNode* adj[MAX_CITIES];
+
+    Slot* slots;
+    unsigned long long mask;
+    alignas(64) atomic<unsigned long long> tail;    // Next position producers claim
+    alignas(64) atomic<unsigned long long> head;    // Written by the consumer only
 
 public:
-    Graph() {
-        for(int i=0; i<MAX_CITIES; i++) adj[i] = nullptr;
-        for(int i=0; i<MAX_CITIES; i++) {
-            for(int j=0; j<MAX_CITIES; j++) {
-                if(i!=j && DIST_MATRIX[i][j] > 0) {
-                    AdjListNode* node = new AdjListNode(j, DIST_MATRIX[i][j]);
-                    node->next = adj[i];
-                    adj[i] = node;
+    MpscRing(int capacityPow2) {
+        slots = new Slot[capacityPow2];
+        mask = capacityPow2 - 1;
+        for (int i = 0; i < capacityPow2; i++) slots[i].seq.store(i, memory_order_relaxed);
+        tail.store(0, memory_order_relaxed);
+        head.store(0, memory_order_relaxed);
+    }
+
+    ~MpscRing() { delete[] slots; }
+
+    // Claims a slot and lets `fill` write into it; false when the ring is full
+    template <typename Fill>
+    bool push(Fill fill) {
+        unsigned long long pos = tail.load(memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            long long diff = (long long)(slot.seq.load(memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    fill(slot.value);
+                    slot.seq.store(pos + 1, memory_order_release);
+                    return true;
                 }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(memory_order_relaxed);
             }
         }
     }
 
-    int getShortestPath(int src, int dest) {
-        int dist[MAX_CITIES];
-        MinHeap minHeap(MAX_CITIES);
+    // Consumer: copies out the oldest item, false when empty
+    bool pop(T& out) {
+        unsigned long long pos = head.load(memory_order_relaxed);
+        Slot& slot = slots[pos & mask];
+        if (slot.seq.load(memory_order_acquire) != pos + 1) return false;
+        out = slot.value;
+        slot.seq.store(pos + mask + 1, memory_order_release);
+        head.store(pos + 1, memory_order_relaxed);
+        return true;
+    }
 
-        for (int v = 0; v < MAX_CITIES; ++v) {
-            dist[v] = INT_MAX;
-            minHeap.insert(v, dist[v]);
-        }
+    // Approximate, for wake-up heuristics
+    unsigned long long sizeHint() const {
+        return tail.load(memory_order_relaxed) - head.load(memory_order_relaxed);
+    }
+    unsigned long long capacity() const { return mask + 1; }
+};
 
-        minHeap.decreaseKey(src, 0);
-        dist[src] = 0;
+// --- RECOVERY FILE I/O ---
+// Sequential writer and reader for recovery.snap. Large arrays start on a
+// RECOVERY_PAGE boundary, so a restore can use them where they lie in the
+// mapped file instead of copying them out.
+const int RECOVERY_PAGE = 4096;
 
-        while (!minHeap.isEmpty()) {
-            HeapNode minNode = minHeap.extractMin();
-            int u = minNode.v;
+// Data reaches the disk before commit() renames the file into place
+void syncFile(FILE* f) {
+    fflush(f);
+#ifdef _WIN32
+    _commit(_fileno(f));
+#elif defined(__linux__)
+    fdatasync(fileno(f));
+#else
+    fsync(fileno(f));
+#endif
+}
 
-            AdjListNode* crawl = adj[u];
-            while (crawl) {
-                int v = crawl->dest;
-                if (minHeap.isInMinHeap(v) && dist[u] != INT_MAX && 
-                    crawl->weight + dist[u] < dist[v]) {
-                    dist[v] = dist[u] + crawl->weight;
-                    minHeap.decreaseKey(v, dist[v]);
-                }
-                crawl = crawl->next;
+void putLE(unsigned char* p, unsigned long long v, int bytes) {
+    for(int i = 0; i < bytes; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+unsigned long long getLE(const unsigned char* p, int bytes) {
+    unsigned long long v = 0;
+    for(int i = 0; i < bytes; i++) v |= (unsigned long long)p[i] << (8 * i);
+    return v;
+}
+
+// Cuts a file back to its first `size` bytes, e.g. past a torn tail
+bool truncateFile(FILE* f, long long size) {
+    fflush(f);
+#ifdef _WIN32
+    return _chsize_s(_fileno(f), size) == 0;
+#else
+    return ftruncate(fileno(f), size) == 0;
+#endif
+}
+
+// Renames `from` over `to`; readers that still have `to` open keep the old file
+bool replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+class RecoveryWriter {
+    FILE* out;
+    string tempPath;
+    long long pos;
+    bool ok;
+    unsigned char* memory;          // openMemory(): bytes collected here instead
+    size_t memoryCapacity;
+
+public:
+    RecoveryWriter() : out(nullptr), pos(0), ok(false), memory(nullptr), memoryCapacity(0) {}
+    ~RecoveryWriter() {
+        if (out) fclose(out);
+        delete[] memory;
+    }
+
+    bool open(const string& path) {
+        tempPath = path + ".tmp";
+        out = fopen(tempPath.c_str(), "wb");
+        ok = out != nullptr;
+        return ok;
+    }
+
+    // Collects the bytes in memory, to be written to a file later with
+    // write(bytes(), size()). Must not contain an align().
+    void openMemory() {
+        memoryCapacity = 1 << 16;
+        memory = new unsigned char[memoryCapacity];
+        ok = true;
+    }
+
+    void write(const void* p, size_t n) {
+        if (ok && n && memory) {
+            if (pos + n > memoryCapacity) {
+                while (pos + n > memoryCapacity) memoryCapacity *= 2;
+                unsigned char* grown = new unsigned char[memoryCapacity];
+                memcpy(grown, memory, pos);
+                delete[] memory;
+                memory = grown;
             }
-        }
-        return (dist[dest] == INT_MAX) ? -1 : dist[dest];
+            memcpy(memory + pos, p, n);
+        } else if (ok && n && fwrite(p, 1, n, out) != n) ok = false;
+        pos += n;
+    }
+
+    const unsigned char* bytes() const { return memory; }
+    size_t size() const { return (size_t)pos; }
+
+    template <typename T>
+    void value(const T& v) { write(&v, sizeof(T)); }
+
+    // Element count, then the raw elements (T must be plain data)
+    template <typename T>
+    void vector(const Vector<T>& v) {
+        value(v.size());
+        write(v.begin(), sizeof(T) * v.size());
+    }
+
+    void align() {
+        static const char zeros[RECOVERY_PAGE] = {};
+        int pad = (int)((RECOVERY_PAGE - pos % RECOVERY_PAGE) % RECOVERY_PAGE);
+        write(zeros, pad);
+    }
+
+    bool good() const { return ok; }
+
+    // Replaces `path` only once the whole file is on disk. A reader that
+    // still maps the old file keeps its copy.
+    bool commit(const string& path) {
+        if (!out) return false;
+        if (ok) syncFile(out);
+        ok = ok && !ferror(out);
+        fclose(out);
+        out = nullptr;
+        ok = ok && replaceFile(tempPath, path);
+        if (!ok) remove(tempPath.c_str());
+        return ok;
     }
 };
 
-class Trip {
+// Reads from a file image in memory (see MappedFile::openPrivate). take()
+// hands out pointers into the image rather than copies.
+class RecoveryReader {
+    char* base;
+    size_t size;
+    size_t pos;
+    bool ok;
+
 public:
-    int src, dest;
-    string vehicleType;
-    int distance; 
-    long long startTime; 
-    bool isFinished;
-    LinkedList<Parcel*> parcels;
+    RecoveryReader(void* image, size_t bytes) : base((char*)image), size(bytes), pos(0), ok(image != nullptr) {}
+
+    char* take(size_t n) {
+        if (!ok || n > size - pos) { ok = false; return nullptr; }
+        char* p = base + pos;
+        pos += n;
+        return p;
+    }
+
+    template <typename T>
+    bool value(T& v) {
+        char* p = take(sizeof(T));
+        if (p) memcpy(&v, p, sizeof(T));
+        return p != nullptr;
+    }
 
-    Trip(int s, int d, string v, int dist, long long time)
-        : src(s), dest(d), vehicleType(v), distance(dist), startTime(time) {
-        isFinished = false;
+    template <typename T>
+    bool vector(Vector<T>& v, int maxSize) {
+        int n;
+        if (!value(n) || n < 0 || n > maxSize) return ok = false;
+        v.assign(n, T());
+        char* p = take(sizeof(T) * n);
+        if (p && n) memcpy((void*)v.begin(), p, sizeof(T) * n);
+        return p != nullptr;
     }
+
+    void align() {
+        size_t pad = (RECOVERY_PAGE - pos % RECOVERY_PAGE) % RECOVERY_PAGE;
+        take(pad);
+    }
+
+    bool good() const { return ok; }
 };
 
-// =========================================================
-// 4. ENGINE CLASS (The Brain)
-// =========================================================
-class Engine {
-    Graph graph;
-    LinkedList<Parcel*> allParcels; // Main list for iteration
-    ParcelHashTable parcelMap;      // O(1) Lookup for Tracking/Undo
-    LinkedList<Trip*> activeTrips;  
-    
-    int bus300[MAX_CITIES];
-    int bus600[MAX_CITIES];
-    int truck2000[MAX_CITIES];
+// Copy-on-write for a checkpoint that streams a structure out while its
+// owner keeps changing it. From the cut until end(), the first change to
+// each block saves the block's bytes first (keep); the checkpoint copies a
+// block live and then prefers the saved bytes if there are any (cut).
+// Writers are serialized by the owner (dataMutex); cut() is for any thread.
+class CutBlocks {
+    atomic<unsigned char*>* saved;
+    int count;
 
-    int day;
-    int second; 
-    long long totalSeconds;
-    int totalLost;
-    bool running;
-    
 public:
-    Engine() {
-        day = 1;
-        second = 0;
-        totalSeconds = 0;
-        totalLost = 0;
-        running = true;
-        resetVehicles();
-        ofstream f("notifications.txt", ios::trunc);
-        f.close();
+    CutBlocks() : saved(nullptr), count(0) {}
+    ~CutBlocks() { end(); }
+
+    CutBlocks(const CutBlocks&) = delete;
+    CutBlocks& operator=(const CutBlocks&) = delete;
+
+    void begin(int blocks) {
+        count = blocks;
+        saved = new atomic<unsigned char*>[blocks > 0 ? blocks : 1];
+        for (int b = 0; b < blocks; b++) saved[b].store(nullptr, memory_order_relaxed);
     }
 
-    void resetVehicles() {
-        for(int i=0; i<MAX_CITIES; i++) {
-            bus300[i] = 14;
-            bus600[i] = 14;
-            truck2000[i] = 7;
-        }
+    // Writer, before changing block b: `fill` copies the block's current
+    // bytes into the buffer it is given. Published before the change.
+    template <typename Fill>
+    void keep(int b, size_t bytes, Fill fill) {
+        if (b >= count || saved[b].load(memory_order_relaxed)) return;
+        unsigned char* copy = new unsigned char[bytes];
+        fill(copy);
+        saved[b].store(copy, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
     }
 
-    void logSystemEvent(int d, int t, string city, string type, string msg) {
-        lock_guard<mutex> lock(fileMutex);
-        ofstream f("notifications.txt", ios::app);
-        f << "[" << d << "][" << t << "] [" << city << "] " << type << ": " << msg << endl;
-        f.close();
+    // After copying block b live: its bytes as of the cut if it has
+    // changed since, else nullptr and the live copy is the cut's
+    const unsigned char* cut(int b) const {
+        atomic_thread_fence(memory_order_acquire);
+        return saved[b].load(memory_order_relaxed);
     }
 
-    // --- Customer Functions (Styled) ---
-    void bookParcel(int sC, int sO, int dC, int dO, int w, int p) {
-        lock_guard<mutex> lock(dataMutex);
-        
-        if(sC == dC && sO == dO) {
-            cout << Color::RED << "\n[!] ERROR: Source and Destination cannot be the same office.\n" << Color::RESET;
-            return;
-        }
+    void end() {
+        for (int b = 0; b < count; b++) delete[] saved[b].load(memory_order_relaxed);
+        delete[] saved;
+        saved = nullptr;
+        count = 0;
+    }
+};
 
-        string id = "P-" + to_string(rand()%100000);
-        Parcel* newP = new Parcel(id, sC, sO, dC, dO, w, p, day);
-        
-        // Add to both Master List and Hash Table
-        allParcels.append(newP);
-        parcelMap.insert(newP);
+// --- DATA STRUCTURE: CHUNKED COLUMN (STABLE ADDRESSES) ---
+// Append-only array stored in fixed 4096-element chunks behind a directory
+// allocated once. Growing never moves existing elements, so other threads
+// may read elements they learned about (e.g. through a hash table) while
+// the owner keeps appending. Only the owning thread appends.
+template <typename T>
+class ChunkedColumn {
+    static const int CHUNK_BITS = 12;
+    static const int MAX_CHUNKS = 1 << 14;          // 67M elements
+
+    atomic<T*>* chunks;
+    int count;
+    int borrowed;                   // Leading chunks that live in a restored image
+
+public:
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static const int MAX_ELEMENTS = MAX_CHUNKS * CHUNK_SIZE;
 
-        cout << Color::GREEN << "\n[SUCCESS] Parcel Booked Successfully! Tracking ID: " << Color::BOLD << id << Color::RESET << endl;
-        logSystemEvent(day, second, CITIES[sC], "BOOKING", "Customer booked parcel " + id + " to " + CITIES[dC]);
+    ChunkedColumn() {
+        chunks = new atomic<T*>[MAX_CHUNKS];
+        for (int i = 0; i < MAX_CHUNKS; i++) chunks[i].store(nullptr, memory_order_relaxed);
+        count = 0;
+        borrowed = 0;
     }
 
-    void undoParcel(string id) {
-        lock_guard<mutex> lock(dataMutex);
-        
-        // O(1) Search via Hash Table
-        Parcel* p = parcelMap.search(id);
-
-        if(p) {
-            if(p->status == "Booked") {
-                p->status = "Cancelled";
-                cout << Color::GREEN << "[SUCCESS] Parcel " << id << " has been cancelled.\n" << Color::RESET;
-                logSystemEvent(day, second, CITIES[p->srcCity], "UNDO", "Parcel " + id + " cancelled by user.");
-            } else {
-                cout << Color::RED << "[ERROR] Cannot Undo. Parcel is already " << p->status << ".\n" << Color::RESET;
-            }
-            return;
-        }
-        cout << Color::RED << "[ERROR] Parcel ID not found in system.\n" << Color::RESET;
+    ~ChunkedColumn() {
+        for (int i = borrowed; i < MAX_CHUNKS; i++) delete[] chunks[i].load(memory_order_relaxed);
+        delete[] chunks;
     }
 
-    void trackParcel(string id) {
-        lock_guard<mutex> lock(dataMutex);
-        
-        // O(1) Search via Hash Table
-        Parcel* p = parcelMap.search(id);
-
-        if(p) {
-            cout << Color::CYAN << "\n+------------------------------------------------+\n";
-            cout << "|               TRACKING DETAILS                 |\n";
-            cout << "+------------------------------------------------+\n" << Color::RESET;
-            cout << " ID:       " << Color::BOLD << p->id << Color::RESET << "\n";
-            cout << " From:     " << CITIES[p->srcCity] << " (" << OFFICES[p->srcOffice] << ")\n";
-            cout << " To:       " << CITIES[p->destCity] << " (" << OFFICES[p->destOffice] << ")\n";
-            
-            string sColor = Color::YELLOW;
-            if(p->status == "Delivered") sColor = Color::GREEN;
-            if(p->status == "LOST") sColor = Color::RED;
-            if(p->status == "Cancelled") sColor = Color::RED;
+    ChunkedColumn(const ChunkedColumn&) = delete;
+    ChunkedColumn& operator=(const ChunkedColumn&) = delete;
 
-            cout << " Status:   " << sColor << Color::BOLD << p->status << Color::RESET << "\n";
-            
-            if(p->status == "In Transit") {
-                long long elapsed = totalSeconds - p->dispatchTime;
-                double traveledKm = elapsed / (double)SECONDS_PER_NODE;
-                if (traveledKm > p->totalRouteDistance) traveledKm = p->totalRouteDistance;
-                
-                cout << " Progress: " << Color::CYAN;
-                int barWidth = 20;
-                float progress = (float)traveledKm / (float)p->totalRouteDistance;
-                int pos = barWidth * progress;
-                cout << "[";
-                for (int i = 0; i < barWidth; ++i) {
-                    if (i < pos) cout << "=";
-                    else if (i == pos) cout << ">";
-                    else cout << " ";
-                }
-                cout << "] " << int(progress * 100.0) << "%\n" << Color::RESET;
-                
-                cout << fixed << setprecision(1);
-                cout << " Traveled: " << traveledKm << " km\n";
-                cout << " Remaining:" << (p->totalRouteDistance - traveledKm) << " km\n";
-            }
-            cout << Color::CYAN << "+------------------------------------------------+\n" << Color::RESET;
-            return;
+    // Caller checks size() < MAX_ELEMENTS
+    template <typename U>
+    void push_back(const U& val) {
+        int c = count >> CHUNK_BITS;
+        T* chunk = chunks[c].load(memory_order_relaxed);
+        if (!chunk) {
+            chunk = new T[CHUNK_SIZE];
+            chunks[c].store(chunk, memory_order_release);
         }
-        cout << Color::RED << "[!] ID Not Found.\n" << Color::RESET;
+        chunk[count & (CHUNK_SIZE - 1)] = val;
+        count++;
     }
 
-    // --- Background (Silent) ---
-    void runLoop() {
-        while(running) {
-            this_thread::sleep_for(chrono::seconds(1));
-            {
-                lock_guard<mutex> lock(dataMutex);
-                second++;
-                totalSeconds++;
-
-                if(second >= SECONDS_PER_DAY) {
-                    second = 0;
-                    day++;
-                    if(day > 5) day = 1; 
-                    cleanFinishedTrips();
-                    resetVehicles();
-                    logSystemEvent(day, 0, "SYSTEM", "NEW DAY", "Day " + to_string(day) + " Started.");
-                }
+    T& operator[](int index) {
+        return chunks[index >> CHUNK_BITS].load(memory_order_acquire)[index & (CHUNK_SIZE - 1)];
+    }
 
-                updateTrips();
-                if(second == 150) dispatchLogic();
-                writeAdminState();
-            }
-        }
+    const T& operator[](int index) const {
+        return chunks[index >> CHUNK_BITS].load(memory_order_acquire)[index & (CHUNK_SIZE - 1)];
     }
 
-    void cleanFinishedTrips() {
-        ListNode<Trip*>* curr = activeTrips.head;
-        LinkedList<Trip*> nextDayList;
-        while(curr) {
-            Trip* t = curr->data;
-            if(t->isFinished) delete t; 
-            else nextDayList.append(t);
-            curr = curr->next;
+    int size() const { return count; }
+
+    static int chunkOf(int index) { return index >> CHUNK_BITS; }
+    const T* chunk(int c) const { return chunks[c].load(memory_order_acquire); }
+
+    // The first n elements. Chunks are written whole and page-aligned, so
+    // restore() can point the directory straight into the image; the image
+    // must outlive the column. Safe while the owner appends past n: each
+    // chunk is copied first, and `cut` (optional) supplies the bytes of
+    // chunks changed since a checkpoint's cut.
+    void save(RecoveryWriter& out, int n, const CutBlocks* cut = nullptr, size_t cutOffset = 0) const {
+        out.value(n);
+        out.align();
+        int used = (n + CHUNK_SIZE - 1) >> CHUNK_BITS;
+        const size_t bytes = sizeof(T) * CHUNK_SIZE;
+        unsigned char* copy = new unsigned char[bytes];
+        for (int c = 0; c < used; c++) {
+            memcpy(copy, (const void*)chunk(c), bytes);
+            const unsigned char* kept = cut ? cut->cut(c) : nullptr;
+            if (kept) memcpy(copy, kept + cutOffset, bytes);
+            int tail = c == used - 1 ? used * CHUNK_SIZE - n : 0;     // Appended after the cut
+            memset(copy + bytes - sizeof(T) * tail, 0, sizeof(T) * tail);
+            out.write(copy, bytes);
         }
-        activeTrips.clear();
-        activeTrips = nextDayList;
+        delete[] copy;
     }
 
-    void updateTrips() {
-        ListNode<Trip*>* curr = activeTrips.head;
-        LinkedList<Trip*> nextList; 
-        while(curr) {
-            Trip* t = curr->data;
-            if(t->isFinished) {
-                nextList.append(t);
-                curr = curr->next;
-                continue;
-            }
-            long long elapsed = totalSeconds - t->startTime;
-            int reqTime = t->distance * SECONDS_PER_NODE;
-
-            if(elapsed >= reqTime) {
-                t->isFinished = true; 
-                ListNode<Parcel*>* pNode = t->parcels.head;
-                while(pNode) {
-                    int r = rand() % 1000;
-                    if(r < 5) { 
-                        pNode->data->status = "LOST";
-                        totalLost++;
-                        logSystemEvent(day, second, CITIES[t->dest], "CRITICAL", "Parcel " + pNode->data->id + " lost in transit.");
-                    } else {
-                        pNode->data->status = "Delivered";
-                    }
-                    pNode = pNode->next;
-                }
-                logSystemEvent(day, second, CITIES[t->dest], "ARRIVAL", "Trip from " + CITIES[t->src] + " Arrived (" + t->vehicleType + ")");
-                nextList.append(t); 
-            } else {
-                nextList.append(t);
-            }
-            curr = curr->next;
+    // Only into an empty column
+    bool restore(RecoveryReader& in) {
+        int n;
+        if (count || !in.value(n) || n < 0 || n > MAX_ELEMENTS) return false;
+        in.align();
+        int used = (n + CHUNK_SIZE - 1) >> CHUNK_BITS;
+        for (int c = 0; c < used; c++) {
+            T* chunk = (T*)in.take(sizeof(T) * CHUNK_SIZE);
+            if (!chunk) return false;
+            chunks[c].store(chunk, memory_order_release);
+            borrowed = c + 1;
         }
-        activeTrips.clear(); 
-        activeTrips = nextList; 
+        count = n;
+        return true;
     }
+};
 
-    void writeAdminState() {
-        lock_guard<mutex> lock(fileMutex);
-        ofstream f("system_state.txt");
-        int bookedCount = 0;
-        int transitCount = 0;
-        ListNode<Parcel*>* p = allParcels.head;
-        while(p) {
-            if(p->data->status == "Booked") bookedCount++;
-            if(p->data->status == "In Transit") transitCount++;
-            p = p->next;
-        }
-        f << "DAY: " << day << endl;
-        f << "TIME: " << second << endl;
-        f << "PARCELS_BOOKED: " << bookedCount << endl;
-        f << "PARCELS_TRANSIT: " << transitCount << endl;
-        f << "PARCELS_LOST: " << totalLost << endl;
-        f << "--- TRIPS ---" << endl;
-        ListNode<Trip*>* t = activeTrips.head;
-        while(t) {
-            long long elapsed = totalSeconds - t->data->startTime;
-            double traveled = elapsed / (double)SECONDS_PER_NODE;
-            if(traveled > t->data->distance) traveled = t->data->distance;
-            f << t->data->src << " " << t->data->dest << " " << t->data->vehicleType << " " << (int)traveled << "km " << t->data->distance << "km" << endl;
-            t = t->next;
-        }
-        f.close();
+// =========================================================
+// 3. CORE CLASSES
+// =========================================================
+
+// --- ROAD NETWORK (RUNTIME-LOADED) ---
+// Network (network.txt and its network.bin image) is in network.h, shared
+// with admin.cpp.
+Network network;
+
+// The original 8-city network, written out when no network.txt exists yet
+void writeDefaultNetwork(const char* path) {
+    const int n = 8;
+    const string cities[n] = {
+        "Lahore", "Karachi", "Islamabad", "Multan",
+        "Faisalabad", "Peshawar", "Quetta", "Sialkot"
+    };
+    const int distMatrix[n][n] = {
+        {0, 15, 8, 6, 4, 10, 14, 3},
+        {15, 0, 12, 10, 13, 14, 6, 14},
+        {8, 12, 0, 6, 7, 4, 13, 10},
+        {6, 10, 6, 0, 5, 9, 12, 7},
+        {4, 13, 7, 5, 0, 8, 14, 5},
+        {10, 14, 4, 9, 8, 0, 13, 11},
+        {14, 6, 13, 12, 14, 13, 0, 15},
+        {3, 14, 10, 7, 5, 11, 15, 0}
+    };
+    ofstream f(path);
+    f << "# SwiftEx road network\n";
+    f << "# HUBS <count>, then: <id> <name> <bus300> <bus600> <truck2000>\n";
+    f << "HUBS " << n << "\n";
+    for(int i = 0; i < n; i++) f << i << " " << cities[i] << " 14 14 7\n";
+    f << "# OFFICES <count>, then office names (office 0 is the hub itself)\n";
+    f << "OFFICES 6\nHub Office-1 Office-2 Office-3 Office-4 Office-5\n";
+    f << "# ROADS <count>, then: <hub> <hub> <km> (two-way)\n";
+    f << "ROADS " << n * (n - 1) / 2 << "\n";
+    for(int i = 0; i < n; i++) {
+        for(int j = i + 1; j < n; j++) f << i << " " << j << " " << distMatrix[i][j] << "\n";
     }
+}
 
-    void dispatchLogic() {
-        for(int s = 0; s < MAX_CITIES; s++) {
-            for(int d = 0; d < MAX_CITIES; d++) {
-                int count = 0;
-                ListNode<Parcel*>* curr = allParcels.head;
-                while(curr) {
-                    if(curr->data->srcCity == s && curr->data->destCity == d && curr->data->status == "Booked") count++;
-                    curr = curr->next;
-                }
-                if(count == 0) continue;
-
-                Parcel** routeParcels = new Parcel*[count];
-                int idx = 0;
-                curr = allParcels.head;
-                while(curr) {
-                    if(curr->data->srcCity == s && curr->data->destCity == d && curr->data->status == "Booked") routeParcels[idx++] = curr->data;
-                    curr = curr->next;
-                }
+typedef int ParcelHandle; // Row index into ParcelStore
+const ParcelHandle NO_PARCEL = -1;
 
-                for(int i=0; i<count-1; i++) {
-                    for(int j=0; j<count-i-1; j++) {
-                        if(routeParcels[j]->priority > routeParcels[j+1]->priority) {
-                            Parcel* temp = routeParcels[j];
-                            routeParcels[j] = routeParcels[j+1];
-                            routeParcels[j+1] = temp;
-                        }
-                    }
-                }
+// 64-bit tracking key: [origin city : 16 bits][per-city sequence : 40 bits].
+// Sequences start at 1, so a key is never 0 and never collides.
+typedef unsigned long long TrackingKey;
+const int TRACKING_SEQ_BITS = 40;
 
-                LinkedList<Parcel*> batch;
-                int currentBatchWeight = 0;
-                for(int i=0; i<count; i++) {
-                    Parcel* p = routeParcels[i];
-                    bool select = false;
-                    if (day == 5) select = true;
-                    else if (day == 1 || day == 3) {
-                        if (p->priority == 1) select = true;
-                        else if (currentBatchWeight + p->weight <= 300) select = true;
-                    }
-                    else if (day == 2 || day == 4) {
-                        if (p->priority <= 2) select = true;
-                        else if (currentBatchWeight + p->weight <= 600) select = true;
-                    }
-                    if(select) {
-                        batch.append(p);
-                        currentBatchWeight += p->weight;
-                    }
-                }
-                delete[] routeParcels;
+enum ParcelStatus : unsigned char {
+    STATUS_BOOKED,
+    STATUS_IN_TRANSIT,
+    STATUS_DELIVERED,
+    STATUS_LOST,
+    STATUS_CANCELLED,
+    STATUS_COUNT
+};
 
-                if(batch.isEmpty()) continue;
+const string STATUS_NAMES[STATUS_COUNT] = {"Booked", "In Transit", "Delivered", "LOST", "Cancelled"};
 
-                int routeDist = -1;
-                bool isReroute = false;
+// What a tracking query sees of one parcel, copied out consistently
+struct TrackingRecord {
+    TrackingKey key;
+    int srcCity, destCity;
+    int srcOffice, destOffice;
+    ParcelStatus status;
+    long long dispatchTime;
+    int totalRouteDistance;
+    int atHub, legTo;
+    int legCount, legDistance;
+};
 
-                if (s == d) routeDist = 5; 
-                else {
-                    routeDist = graph.getShortestPath(s, d);
-                    int directDist = DIST_MATRIX[s][d];
-                    if(routeDist != -1 && directDist > 0 && routeDist > directDist) isReroute = true;
-                }
+// --- DATA STRUCTURE: COLUMNAR (STRUCT-OF-ARRAYS) PARCEL STORE ---
+// One dense column per field, indexed by ParcelHandle. A parcel costs ~60 bytes
+// with no per-parcel heap allocation. Columns are chunked, so records never
+// move: tracking threads read them without dataMutex while the sim thread
+// books and updates. Each record has a version that is odd while the sim
+// thread changes it (per-record seqlock, see beginUpdate/readRecord).
+class ParcelStore {
+public:
+    static const int MAX_PARCELS = ChunkedColumn<int>::MAX_ELEMENTS;
 
-                if(routeDist == -1) {
-                    logSystemEvent(day, second, CITIES[s], "FAILURE", "Route blocked/unreachable to " + CITIES[d]);
-                    continue;
-                }
+    ChunkedColumn<TrackingKey> trackingKey;
+    ChunkedColumn<unsigned short> srcCity;
+    ChunkedColumn<unsigned short> destCity;
+    ChunkedColumn<unsigned char> srcOffice;
+    ChunkedColumn<unsigned char> destOffice;
+    ChunkedColumn<int> weight;
+    ChunkedColumn<unsigned char> priority;    // 1=Overnight, 2=2Day, 3=Normal
+    ChunkedColumn<unsigned char> status;      // ParcelStatus
+    ChunkedColumn<unsigned short> bookingDay;
+    ChunkedColumn<long long> dispatchTime;    // Start of the current leg
+    ChunkedColumn<int> totalRouteDistance;    // km of all legs started so far
+    // A route is travelled as legs between hubs, with a hand-off at each
+    ChunkedColumn<unsigned short> atHub;      // Where the parcel waits, or its leg started
+    ChunkedColumn<unsigned short> legTo;      // Where the current leg ends
+    ChunkedColumn<unsigned short> legCount;   // Legs started so far
+    ChunkedColumn<int> legDistance;           // km of the current leg, 0 while waiting at a hub
+    ChunkedColumn<int> lane;                  // LaneQueues lane id (current hub's queue)
+    ChunkedColumn<ParcelHandle> lanePrev;     // Intrusive links for LaneQueues (O(1) removal)
+    ChunkedColumn<ParcelHandle> laneNext;
+    ChunkedColumn<atomic<unsigned>> version;  // Odd while the record is being changed
 
-                string vType = "None";
-                bool allocated = false;
-                string reason = "Standard";
-                
-                if(currentBatchWeight <= 300 && bus300[s] > 0) { bus300[s]--; vType="Bus-300"; allocated=true; reason="Standard Overnight"; }
-                else if(currentBatchWeight <= 600 && bus600[s] > 0) { bus600[s]--; vType="Bus-600"; allocated=true; if(currentBatchWeight>300) reason="Capacity Upgrade"; }
-                else if(currentBatchWeight <= 900 && bus600[s]>0 && bus300[s]>0) { bus600[s]--; bus300[s]--; vType="Bus-600+300"; allocated=true; }
-                else if(currentBatchWeight <= 1200 && bus600[s]>=2) { bus600[s]-=2; vType="2xBus-600"; allocated=true; }
-                else if(currentBatchWeight <= 2000 && truck2000[s]>0) { truck2000[s]--; vType="Truck"; allocated=true; reason="Heavy Load Upgrade"; }
-                else if(truck2000[s]>0) { truck2000[s]--; vType="Truck+Convoy"; allocated=true; reason="Heavy Load Upgrade"; }
-
-                if(allocated) {
-                    Trip* newTrip = new Trip(s, d, vType, routeDist, totalSeconds);
-                    ListNode<Parcel*>* b = batch.head;
-                    while(b) {
-                        b->data->status = "In Transit";
-                        b->data->dispatchTime = totalSeconds;
-                        b->data->totalRouteDistance = routeDist;
-                        newTrip->parcels.append(b->data);
-                        b = b->next;
-                    }
-                    activeTrips.append(newTrip);
-                    logSystemEvent(day, second, CITIES[s], "DISPATCH", "Sent " + vType + " to " + CITIES[d] + " (Load: " + to_string(currentBatchWeight) + "kg). " + reason + (isReroute?" [REROUTE]":""));
-                } else {
-                    logSystemEvent(day, second, CITIES[s], "DEFER", "Resource Shortage for " + CITIES[d] + " (Req: " + to_string(currentBatchWeight) + "kg). Deferred.");
-                }
-            }
+private:
+    // Bytes of one chunk of every column touch() keeps, in save order
+    static const size_t CUT_BLOCK_BYTES = ChunkedColumn<int>::CHUNK_SIZE *
+        (sizeof(unsigned char) + sizeof(long long) + sizeof(int) + 3 * sizeof(unsigned short) +
+         sizeof(int) + sizeof(int) + 2 * sizeof(ParcelHandle) + sizeof(atomic<unsigned>));
+
+    CutBlocks cutCopy;
+    int cutCount;                             // 0 outside a checkpoint
+
+    // Appends chunk c of `column` at p, which moves past it
+    template <typename T>
+    static void keepChunk(const ChunkedColumn<T>& column, int c, unsigned char*& p) {
+        memcpy(p, (const void*)column.chunk(c), sizeof(T) * ChunkedColumn<T>::CHUNK_SIZE);
+        p += sizeof(T) * ChunkedColumn<T>::CHUNK_SIZE;
+    }
+
+    template <typename T>
+    void saveCut(RecoveryWriter& out, const ChunkedColumn<T>& column, int n, size_t& at) const {
+        column.save(out, n, &cutCopy, at);
+        at += sizeof(T) * ChunkedColumn<T>::CHUNK_SIZE;
+    }
+
+public:
+    ParcelStore() : cutCount(0) {}
+
+    // NO_PARCEL once the store is full
+    ParcelHandle add(TrackingKey key, int sC, int sO, int dC, int dO, int w, int p, int d) {
+        if (count() >= MAX_PARCELS) return NO_PARCEL;
+        trackingKey.push_back(key);
+        srcCity.push_back(sC);
+        destCity.push_back(dC);
+        srcOffice.push_back(sO);
+        destOffice.push_back(dO);
+        weight.push_back(w);
+        priority.push_back(p);
+        status.push_back(STATUS_BOOKED);
+        bookingDay.push_back(d);
+        dispatchTime.push_back(0);
+        totalRouteDistance.push_back(0);
+        atHub.push_back(sC);
+        legTo.push_back(sC);
+        legCount.push_back(0);
+        legDistance.push_back(0);
+        lane.push_back(-1);
+        lanePrev.push_back(NO_PARCEL);
+        laneNext.push_back(NO_PARCEL);
+        version.push_back(0u);
+        return trackingKey.size() - 1;
+    }
+
+    int count() const { return trackingKey.size(); }
+
+    // A checkpoint's cut (Engine::checkpoint): the first cutCount records are
+    // saved as they are now while the sim thread carries on. Booking fields
+    // never change; the first change to a chunk's other fields keeps a copy
+    // of them for the checkpoint first (touch).
+    void beginCut() {
+        cutCount = count();
+        cutCopy.begin(cutCount > 0 ? ChunkedColumn<int>::chunkOf(cutCount - 1) + 1 : 0);
+    }
+
+    void endCut() {
+        cutCopy.end();
+        cutCount = 0;
+    }
+
+    // Sim thread, before changing any field but the booking ones of `h`
+    void touch(ParcelHandle h) {
+        if (h == NO_PARCEL || h >= cutCount) return;
+        int c = ChunkedColumn<int>::chunkOf(h);
+        cutCopy.keep(c, CUT_BLOCK_BYTES, [&](unsigned char* p) {
+            keepChunk(status, c, p); keepChunk(dispatchTime, c, p); keepChunk(totalRouteDistance, c, p);
+            keepChunk(atHub, c, p); keepChunk(legTo, c, p); keepChunk(legCount, c, p); keepChunk(legDistance, c, p);
+            keepChunk(lane, c, p); keepChunk(lanePrev, c, p); keepChunk(laneNext, c, p); keepChunk(version, c, p);
+        });
+    }
+
+    // The records of the cut; any thread, between beginCut and endCut
+    void save(RecoveryWriter& out) const {
+        int n = cutCount;
+        size_t at = 0;
+        trackingKey.save(out, n); srcCity.save(out, n); destCity.save(out, n);
+        srcOffice.save(out, n); destOffice.save(out, n); weight.save(out, n);
+        priority.save(out, n);
+        saveCut(out, status, n, at);
+        bookingDay.save(out, n);
+        saveCut(out, dispatchTime, n, at); saveCut(out, totalRouteDistance, n, at);
+        saveCut(out, atHub, n, at); saveCut(out, legTo, n, at); saveCut(out, legCount, n, at); saveCut(out, legDistance, n, at);
+        saveCut(out, lane, n, at); saveCut(out, lanePrev, n, at); saveCut(out, laneNext, n, at); saveCut(out, version, n, at);
+    }
+
+    // Maps the columns onto the image in place; only into an empty store
+    bool restore(RecoveryReader& in) {
+        bool ok = trackingKey.restore(in) && srcCity.restore(in) && destCity.restore(in) &&
+                  srcOffice.restore(in) && destOffice.restore(in) && weight.restore(in) &&
+                  priority.restore(in) && status.restore(in) && bookingDay.restore(in) &&
+                  dispatchTime.restore(in) && totalRouteDistance.restore(in) &&
+                  atHub.restore(in) && legTo.restore(in) && legCount.restore(in) && legDistance.restore(in) &&
+                  lane.restore(in) && lanePrev.restore(in) && laneNext.restore(in) && version.restore(in);
+        int n = count();
+        return ok && srcCity.size() == n && destCity.size() == n && srcOffice.size() == n && destOffice.size() == n &&
+               weight.size() == n && priority.size() == n && status.size() == n && bookingDay.size() == n &&
+               dispatchTime.size() == n && totalRouteDistance.size() == n && atHub.size() == n &&
+               legTo.size() == n && legCount.size() == n && legDistance.size() == n && lane.size() == n &&
+               lanePrev.size() == n && laneNext.size() == n && version.size() == n;
+    }
+
+    // Sim thread, around any change to fields that readRecord copies
+    void beginUpdate(ParcelHandle h) {
+        touch(h);
+        version[h].store(version[h].load(memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+
+    void endUpdate(ParcelHandle h) {
+        version[h].store(version[h].load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+    // Any thread. Retries only while the sim thread is inside the few
+    // stores of one update of this very record.
+    void readRecord(ParcelHandle h, TrackingRecord& out) const {
+        while (true) {
+            unsigned before = version[h].load(memory_order_acquire);
+            if (before & 1) continue;
+            out.key = trackingKey[h];
+            out.srcCity = srcCity[h];
+            out.destCity = destCity[h];
+            out.srcOffice = srcOffice[h];
+            out.destOffice = destOffice[h];
+            out.status = (ParcelStatus)status[h];
+            out.dispatchTime = dispatchTime[h];
+            out.totalRouteDistance = totalRouteDistance[h];
+            out.atHub = atHub[h];
+            out.legTo = legTo[h];
+            out.legCount = legCount[h];
+            out.legDistance = legDistance[h];
+            atomic_thread_fence(memory_order_acquire);
+            if (version[h].load(memory_order_relaxed) == before) return;
         }
     }
+};
+
+// --- TRACKING ID GENERATOR ---
+// Monotonic per origin city, so IDs can never collide (unlike rand()).
+class TrackingIdGenerator {
+    Vector<unsigned long long> nextSeq;
+
+public:
+    TrackingIdGenerator() {
+        nextSeq.assign(network.hubCount, 1);
+    }
+
+    TrackingKey next(int originCity) {
+        return ((TrackingKey)originCity << TRACKING_SEQ_BITS) | nextSeq[originCity]++;
+    }
 
-    void stop() { running = false; }
+    void save(RecoveryWriter& out) const { out.vector(nextSeq); }
+    bool restore(RecoveryReader& in) { return in.vector(nextSeq, network.hubCount) && nextSeq.size() == network.hubCount; }
+};
+
+// Printed form: "P-" + Crockford base-32 of the key + one Luhn mod-32 check
+// character (catches any single mistyped character and adjacent swaps).
+const char TRACKING_ALPHABET[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+int trackingCharValue(char c) {
+    if(c >= 'a' && c <= 'z') c = c - 'a' + 'A';
+    if(c == 'O') return 0;                 // Crockford: common misreadings
+    if(c == 'I' || c == 'L') return 1;
+    for(int i = 0; i < 32; i++) if(TRACKING_ALPHABET[i] == c) return i;
+    return -1;
+}
+
+// Luhn mod N over digit values, rightmost digit doubled first
+int trackingCheckValue(const int* digits, int n) {
+    int factor = 2, sum = 0;
+    for(int i = n - 1; i >= 0; i--) {
+        int addend = factor * digits[i];
+        factor = (factor == 2) ? 1 : 2;
+        sum += addend / 32 + addend % 32;
+    }
+    return (32 - sum % 32) % 32;
+}
+
+string formatTrackingId(TrackingKey key) {
+    int digits[13];
+    int n = 0;
+    do { digits[n++] = (int)(key & 31); key >>= 5; } while(key);
+    for(int i = 0; i < n / 2; i++) { int t = digits[i]; digits[i] = digits[n-1-i]; digits[n-1-i] = t; }
+
+    char buf[2 + 13 + 1 + 1];
+    int len = 0;
+    buf[len++] = 'P'; buf[len++] = '-';
+    for(int i = 0; i < n; i++) buf[len++] = TRACKING_ALPHABET[digits[i]];
+    buf[len++] = TRACKING_ALPHABET[trackingCheckValue(digits, n)];
+    buf[len] = '\0';
+    return string(buf, len);
+}
+
+// Parses a printed ID back to its key without allocating. Returns false on a
+// malformed ID or a failed check character.
+bool parseTrackingId(const string& id, TrackingKey& key) {
+    int start = 0;
+    if(id.size() >= 2 && (id[0] == 'P' || id[0] == 'p') && id[1] == '-') start = 2;
+    int n = (int)id.size() - start - 1;  // Payload digits, excluding check char
+    if(n < 1 || n > 12) return false;
+
+    int digits[12];
+    TrackingKey v = 0;
+    for(int i = 0; i < n; i++) {
+        digits[i] = trackingCharValue(id[start + i]);
+        if(digits[i] < 0) return false;
+        v = (v << 5) | digits[i];
+    }
+    int check = trackingCharValue(id[id.size() - 1]);
+    if(check != trackingCheckValue(digits, n)) return false;
+    key = v;
+    return true;
+}
+
+// --- DATA STRUCTURE: ROBIN HOOD HASH TABLE FOR O(1) LOOKUP ---
+// Open addressing keyed on the numeric tracking key, value = ParcelHandle.
+// - Grows incrementally: a resize allocates a table twice the size and every
+//   later write migrates a few old slots, so there is no stop-the-world rehash.
+// - Single writer (callers hold dataMutex), any number of lock-free readers.
+//   Writers bump a sequence counter around each mutation and readers retry
+//   if it moved (seqlock); retired tables are freed once no reader is inside.
+class ParcelHashTable {
+    static const unsigned long long EMPTY_KEY = ~0ULL;
+    static const unsigned long long TOMBSTONE_KEY = ~0ULL - 1;
+    static const int INITIAL_CAPACITY = 1024;   // Power of two
+    static const int MIGRATE_STEP = 16;         // Old slots moved per write
+
+    struct Slot {
+        atomic<unsigned long long> key;
+        atomic<int> value;
+        atomic<int> dist;                       // Probe distance from home slot
+    };
+
+    struct Table {
+        Slot* slots;
+        int capacity;
+        int used;                               // Live entries (+ tombstones in a draining table)
+        Table* nextRetired;
+
+        bool borrowed;                          // Slots live in a restored image
+
+        Table(int cap) {
+            capacity = cap;
+            used = 0;
+            nextRetired = nullptr;
+            borrowed = false;
+            slots = new Slot[cap];
+            for(int i=0; i<cap; i++) {
+                slots[i].key.store(EMPTY_KEY, memory_order_relaxed);
+                slots[i].value.store(NO_PARCEL, memory_order_relaxed);
+                slots[i].dist.store(0, memory_order_relaxed);
+            }
+        }
+        Table(Slot* image, int cap, int usedSlots) {
+            capacity = cap;
+            used = usedSlots;
+            nextRetired = nullptr;
+            borrowed = true;
+            slots = image;
+        }
+        ~Table() { if(!borrowed) delete[] slots; }
+    };
+
+    atomic<Table*> current;
+    atomic<Table*> draining;      // Old table while a resize is in progress
+    int migrateCursor;
+    Table* retired;
+    atomic<unsigned> seq;         // Odd while a write is in progress
+    atomic<int> activeReaders;
+    int liveCount;
+
+    // A checkpoint's cut (beginCut): the table as it was then, kept whole
+    // (not retired) until endCut, with copies of the blocks changed since
+    static const int CUT_BLOCK = 4096;          // Slots
+    Table* frozen;
+    int frozenUsed, frozenLive;
+    CutBlocks cutCopy;
+
+    int cutBlockSlots(Table* t) const { return t->capacity < CUT_BLOCK ? t->capacity : CUT_BLOCK; }
+
+    // Before any change to slot i of t
+    void keep(Table* t, int i) {
+        if(t != frozen) return;
+        int slots = cutBlockSlots(t);
+        int b = i / slots;
+        cutCopy.keep(b, sizeof(Slot) * slots, [&](unsigned char* p) { memcpy(p, (const void*)(t->slots + b * slots), sizeof(Slot) * slots); });
+    }
+
+    static unsigned long long mix(unsigned long long k) {
+        // splitmix64 finalizer: spreads sequential keys over all buckets
+        k ^= k >> 30; k *= 0xbf58476d1ce4e5b9ULL;
+        k ^= k >> 27; k *= 0x94d049bb133111ebULL;
+        k ^= k >> 31;
+        return k;
+    }
+
+    static int find(Table* t, unsigned long long key) {
+        int mask = t->capacity - 1;
+        int i = (int)(mix(key) & mask);
+        for(int d = 0; ; d++) {
+            unsigned long long k = t->slots[i].key.load(memory_order_relaxed);
+            if(k == EMPTY_KEY) return -1;
+            if(k == key) return i;
+            // Robin Hood invariant: key would have displaced this entry
+            if(t->slots[i].dist.load(memory_order_relaxed) < d) return -1;
+            i = (i + 1) & mask;
+        }
+    }
+
+    void insertInto(Table* t, unsigned long long key, int value) {
+        int mask = t->capacity - 1;
+        int i = (int)(mix(key) & mask);
+        int d = 0;
+        while(true) {
+            Slot& s = t->slots[i];
+            unsigned long long k = s.key.load(memory_order_relaxed);
+            if(k == EMPTY_KEY) {
+                keep(t, i);
+                s.key.store(key, memory_order_relaxed);
+                s.value.store(value, memory_order_relaxed);
+                s.dist.store(d, memory_order_relaxed);
+                t->used++;
+                return;
+            }
+            int sd = s.dist.load(memory_order_relaxed);
+            if(sd < d) {
+                // Steal the slot from the richer entry and carry it forward
+                keep(t, i);
+                int v = s.value.load(memory_order_relaxed);
+                s.key.store(key, memory_order_relaxed);
+                s.value.store(value, memory_order_relaxed);
+                s.dist.store(d, memory_order_relaxed);
+                key = k; value = v; d = sd;
+            }
+            i = (i + 1) & mask;
+            d++;
+        }
+    }
+
+    // Backward-shift deletion keeps probe sequences short without tombstones
+    void eraseAt(Table* t, int i) {
+        int mask = t->capacity - 1;
+        int next = (i + 1) & mask;
+        while(t->slots[next].key.load(memory_order_relaxed) != EMPTY_KEY &&
+              t->slots[next].dist.load(memory_order_relaxed) > 0) {
+            keep(t, i);
+            t->slots[i].key.store(t->slots[next].key.load(memory_order_relaxed), memory_order_relaxed);
+            t->slots[i].value.store(t->slots[next].value.load(memory_order_relaxed), memory_order_relaxed);
+            t->slots[i].dist.store(t->slots[next].dist.load(memory_order_relaxed) - 1, memory_order_relaxed);
+            i = next;
+            next = (next + 1) & mask;
+        }
+        keep(t, i);
+        t->slots[i].key.store(EMPTY_KEY, memory_order_relaxed);
+        t->slots[i].dist.store(0, memory_order_relaxed);
+        t->used--;
+    }
+
+    void beginWrite() {
+        seq.store(seq.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+
+    void endWrite() {
+        seq.store(seq.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+    void migrateStep(int steps) {
+        Table* old = draining.load(memory_order_relaxed);
+        if(!old) return;
+        Table* cur = current.load(memory_order_relaxed);
+        // Entries are copied, not moved: the old table stays valid for readers
+        while(steps-- > 0 && migrateCursor < old->capacity) {
+            Slot& s = old->slots[migrateCursor++];
+            unsigned long long k = s.key.load(memory_order_relaxed);
+            if(k != EMPTY_KEY && k != TOMBSTONE_KEY && find(cur, k) < 0) {
+                insertInto(cur, k, s.value.load(memory_order_relaxed));
+            }
+        }
+        if(migrateCursor >= old->capacity) {
+            draining.store(nullptr);
+            old->nextRetired = retired;
+            retired = old;
+        }
+    }
+
+    void reclaim() {
+        if(retired && !frozen && activeReaders.load() == 0) {
+            while(retired) {
+                Table* t = retired;
+                retired = retired->nextRetired;
+                delete t;
+            }
+        }
+    }
+
+public:
+    ParcelHashTable() {
+        current.store(new Table(INITIAL_CAPACITY));
+        draining.store(nullptr);
+        migrateCursor = 0;
+        retired = nullptr;
+        seq.store(0);
+        activeReaders.store(0);
+        liveCount = 0;
+        frozen = nullptr;
+        frozenUsed = frozenLive = 0;
+    }
+
+    // Writer side (caller holds dataMutex)
+    void insert(TrackingKey key, ParcelHandle h) {
+        reclaim();
+        beginWrite();
+        Table* cur = current.load(memory_order_relaxed);
+        if((long long)(cur->used + 1) * 8 > (long long)cur->capacity * 7) {
+            while(draining.load(memory_order_relaxed)) migrateStep(cur->capacity);
+            draining.store(cur);
+            migrateCursor = 0;
+            cur = new Table(cur->capacity * 2);
+            current.store(cur);
+        }
+        migrateStep(MIGRATE_STEP);
+        int i = find(cur, key);
+        if(i >= 0) {
+            keep(cur, i);
+            cur->slots[i].value.store(h, memory_order_relaxed);
+        } else {
+            insertInto(cur, key, h);
+            // A key not yet migrated out of the draining table is already
+            // counted; tombstone its old copy so migration skips it
+            Table* old = draining.load(memory_order_relaxed);
+            int j = old ? find(old, key) : -1;
+            if(j >= 0) {
+                keep(old, j);
+                old->slots[j].key.store(TOMBSTONE_KEY, memory_order_relaxed);
+            } else liveCount++;
+        }
+        endWrite();
+    }
+
+    bool erase(TrackingKey key) {
+        reclaim();
+        beginWrite();
+        bool found = false;
+        Table* cur = current.load(memory_order_relaxed);
+        int i = find(cur, key);
+        if(i >= 0) { eraseAt(cur, i); found = true; }
+        Table* old = draining.load(memory_order_relaxed);
+        if(old) {
+            // Tombstone (not shift) so the migration cursor never skips an entry
+            int j = find(old, key);
+            if(j >= 0) {
+                keep(old, j);
+                old->slots[j].key.store(TOMBSTONE_KEY, memory_order_relaxed);
+                found = true;
+            }
+        }
+        if(found) liveCount--;
+        migrateStep(MIGRATE_STEP);
+        endWrite();
+        return found;
+    }
+
+    int size() const { return liveCount; }
+
+    // Writer side, for a checkpoint: finishes a resize in progress and
+    // freezes the one table left as the cut (see CutBlocks)
+    void beginCut() {
+        beginWrite();
+        while(draining.load(memory_order_relaxed)) migrateStep(draining.load(memory_order_relaxed)->capacity);
+        endWrite();
+        frozen = current.load(memory_order_relaxed);
+        frozenUsed = frozen->used;
+        frozenLive = liveCount;
+        cutCopy.begin(frozen->capacity / cutBlockSlots(frozen));
+    }
+
+    void endCut() {
+        cutCopy.end();
+        frozen = nullptr;
+    }
+
+    // The table as of the cut; any thread, between beginCut and endCut.
+    // restore() probes it in place in the image, no rehash.
+    void save(RecoveryWriter& out) const {
+        Table* t = frozen;
+        int slots = t->capacity < CUT_BLOCK ? t->capacity : CUT_BLOCK;
+        out.value(t->capacity);
+        out.value(frozenUsed);
+        out.value(frozenLive);
+        out.align();
+        unsigned char* copy = new unsigned char[sizeof(Slot) * slots];
+        for(int b = 0; b < t->capacity / slots; b++) {
+            memcpy(copy, (const void*)(t->slots + b * slots), sizeof(Slot) * slots);
+            const unsigned char* kept = cutCopy.cut(b);
+            out.write(kept ? kept : copy, sizeof(Slot) * slots);
+        }
+        delete[] copy;
+    }
+
+    // Before any reader uses the table
+    bool restore(RecoveryReader& in) {
+        int capacity, used, live;
+        if(!in.value(capacity) || !in.value(used) || !in.value(live)) return false;
+        if(capacity < INITIAL_CAPACITY || (capacity & (capacity - 1)) || used < 0 || used > capacity || live != used) return false;
+        in.align();
+        Slot* image = (Slot*)in.take(sizeof(Slot) * capacity);
+        if(!image) return false;
+        delete current.load();
+        current.store(new Table(image, capacity, used));
+        liveCount = live;
+        return true;
+    }
+
+    // Reader side: safe from any thread without dataMutex
+    ParcelHandle search(TrackingKey key) {
+        activeReaders.fetch_add(1);
+        ParcelHandle result = NO_PARCEL;
+        while(true) {
+            unsigned s1 = seq.load(memory_order_acquire);
+            if(s1 & 1) { this_thread::yield(); continue; }
+            result = NO_PARCEL;
+            Table* cur = current.load();
+            int i = find(cur, key);
+            if(i >= 0) result = cur->slots[i].value.load(memory_order_relaxed);
+            else {
+                Table* old = draining.load();
+                if(old) {
+                    int j = find(old, key);
+                    if(j >= 0) result = old->slots[j].value.load(memory_order_relaxed);
+                }
+            }
+            atomic_thread_fence(memory_order_acquire);
+            if(seq.load(memory_order_relaxed) == s1) break;
+        }
+        activeReaders.fetch_sub(1);
+        return result;
+    }
+};
+
+// --- DATA STRUCTURE: PER-LANE DISPATCH QUEUES ---
+// Parcels waiting for a vehicle are filed by (hub they are at, destCity) and
+// bucketed by priority when queued (at booking, and again at each relay hub),
+// so dispatch walks only the parcels pending on each lane and gets them
+// already in priority order (FIFO within a bucket).
+// Lanes are created on first use (thousands of hubs means millions of
+// possible pairs but few busy ones); each source keeps its lanes in a list
+// sorted by destination so dispatch visits them in a stable order.
+class LaneQueues {
+    static const int PRIORITY_LEVELS = 3;
+    struct Bucket {
+        ParcelHandle head;
+        ParcelHandle tail;
+    };
+    struct Lane {
+        int src, dest;
+        Bucket buckets[PRIORITY_LEVELS];
+        int pending;
+        int nextInSource;           // Next lane id of the same source, -1 = end
+    };
+    ParcelStore& store;
+    Vector<Lane> lanes;
+    Vector<int> firstLane;          // Per source hub, -1 = no lanes yet
+    ParcelHashTable laneIndex;      // (src, dest) key -> lane id
+
+    // Priorities are 1-3; validBooking turns anything else away before a
+    // parcel is created
+    int bucketOf(ParcelHandle h) { return store.priority[h] - 1; }
+
+    static TrackingKey laneKey(int s, int d) { return ((TrackingKey)s << 16) | (TrackingKey)d; }
+
+    int findOrCreateLane(int s, int d) {
+        int id = laneIndex.search(laneKey(s, d));
+        if(id != NO_PARCEL) return id;
+
+        Lane l;
+        l.src = s; l.dest = d; l.pending = 0;
+        for(int b=0; b<PRIORITY_LEVELS; b++) l.buckets[b] = {NO_PARCEL, NO_PARCEL};
+        id = lanes.size();
+
+        // Sorted insert into the source's lane list
+        int prev = -1, curr = firstLane[s];
+        while(curr != -1 && lanes[curr].dest < d) { prev = curr; curr = lanes[curr].nextInSource; }
+        l.nextInSource = curr;
+        lanes.push_back(l);
+        if(prev == -1) firstLane[s] = id;
+        else lanes[prev].nextInSource = id;
+
+        laneIndex.insert(laneKey(s, d), id);
+        return id;
+    }
+
+public:
+    LaneQueues(ParcelStore& s) : store(s) {
+        firstLane.assign(network.hubCount, -1);
+    }
+
+    void push(ParcelHandle h) {
+        int id = findOrCreateLane(store.atHub[h], store.destCity[h]);
+        Bucket& b = lanes[id].buckets[bucketOf(h)];
+        store.touch(h);
+        store.touch(b.tail);
+        store.lane[h] = id;
+        store.laneNext[h] = NO_PARCEL;
+        store.lanePrev[h] = b.tail;
+        if(b.tail != NO_PARCEL) store.laneNext[b.tail] = h;
+        else b.head = h;
+        b.tail = h;
+        lanes[id].pending++;
+    }
+
+    void remove(ParcelHandle h) {
+        int id = store.lane[h];
+        Bucket& b = lanes[id].buckets[bucketOf(h)];
+        ParcelHandle prev = store.lanePrev[h];
+        ParcelHandle next = store.laneNext[h];
+        store.touch(h);
+        store.touch(prev);
+        store.touch(next);
+        if(prev != NO_PARCEL) store.laneNext[prev] = next;
+        else b.head = next;
+        if(next != NO_PARCEL) store.lanePrev[next] = prev;
+        else b.tail = prev;
+        store.lanePrev[h] = store.laneNext[h] = NO_PARCEL;
+        lanes[id].pending--;
+    }
+
+    int priorityLevels() { return PRIORITY_LEVELS; }
+
+    // Lanes of one source: for(l = firstLaneOf(s); l != -1; l = nextLane(l))
+    int firstLaneOf(int s) { return firstLane[s]; }
+    int nextLane(int lane) { return lanes[lane].nextInSource; }
+    int destOf(int lane) { return lanes[lane].dest; }
+    int pendingCount(int lane) { return lanes[lane].pending; }
+
+    // Iterate a bucket with: for(h = head(lane,b); h != NO_PARCEL; h = store.laneNext[h])
+    ParcelHandle head(int lane, int bucket) { return lanes[lane].buckets[bucket].head; }
+
+    // The parcel links are in the store's columns; the index is rebuilt
+    void save(RecoveryWriter& out) const {
+        out.vector(lanes);
+        out.vector(firstLane);
+    }
+
+    bool restore(RecoveryReader& in) {
+        if(!in.vector(lanes, ParcelStore::MAX_PARCELS) || !in.vector(firstLane, network.hubCount) || firstLane.size() != network.hubCount) return false;
+        for(int id = 0; id < lanes.size(); id++) laneIndex.insert(laneKey(lanes[id].src, lanes[id].dest), id);
+        return true;
+    }
+};
+
+// --- AGGREGATE STATUS COUNTERS ---
+// Parcel counts per status, kept current on every transition
+// (booked -> in transit -> delivered/lost, booked -> cancelled) so stats
+// never need a sweep over the parcel history. Broken down by source city,
+// by lane (the LaneQueues lane the parcel was last queued on) and by priority.
+class StatusCounters {
+    static const int PRIORITY_LEVELS = 3;
+
+    const ParcelStore& store;
+    long long totals[STATUS_COUNT];
+    Vector<long long> byCity;       // [hub * STATUS_COUNT + status]
+    Vector<long long> byLane;       // [lane * STATUS_COUNT + status], grows with lanes
+    long long byPriority[PRIORITY_LEVELS][STATUS_COUNT];
+    Vector<unsigned char> cityDirty;    // Per hub: changed since clearDirtyCities()
+    Vector<int> dirtyCities;            // The hubs with cityDirty set
+
+    static int priorityIndex(int p) { return p - 1; }       // 1-3, see validBooking
+
+    void bump(ParcelHandle h, int status, long long delta) {
+        int hub = store.srcCity[h];
+        totals[status] += delta;
+        byCity[hub * STATUS_COUNT + status] += delta;
+        if (!cityDirty[hub]) {
+            cityDirty[hub] = 1;
+            dirtyCities.push_back(hub);
+        }
+        byLane[store.lane[h] * STATUS_COUNT + status] += delta;
+        byPriority[priorityIndex(store.priority[h])][status] += delta;
+    }
+
+public:
+    StatusCounters(const ParcelStore& s) : store(s) {
+        for (int st = 0; st < STATUS_COUNT; st++) totals[st] = 0;
+        for (int p = 0; p < PRIORITY_LEVELS; p++)
+            for (int st = 0; st < STATUS_COUNT; st++) byPriority[p][st] = 0;
+        byCity.assign(network.hubCount * STATUS_COUNT, 0);
+        cityDirty.assign(network.hubCount, 0);
+    }
+
+    // A new parcel, already filed in its lane
+    void added(ParcelHandle h) {
+        while (byLane.size() <= store.lane[h] * STATUS_COUNT) {
+            for (int st = 0; st < STATUS_COUNT; st++) byLane.push_back(0);
+        }
+        bump(h, store.status[h], 1);
+    }
+
+    void moved(ParcelHandle h, ParcelStatus from, ParcelStatus to) {
+        bump(h, from, -1);
+        bump(h, to, 1);
+    }
+
+    // The parcel was queued again, on another lane, at a relay hub
+    void changedLane(ParcelHandle h, int fromLane) {
+        while (byLane.size() <= store.lane[h] * STATUS_COUNT) {
+            for (int st = 0; st < STATUS_COUNT; st++) byLane.push_back(0);
+        }
+        byLane[fromLane * STATUS_COUNT + store.status[h]]--;
+        byLane[store.lane[h] * STATUS_COUNT + store.status[h]]++;
+    }
+
+    long long total(ParcelStatus st) const { return totals[st]; }
+    long long city(int hub, ParcelStatus st) const { return byCity[hub * STATUS_COUNT + st]; }
+    long long lane(int laneId, ParcelStatus st) const {
+        int i = laneId * STATUS_COUNT + st;
+        return i < byLane.size() ? byLane[i] : 0;
+    }
+    long long priority(int p, ParcelStatus st) const { return byPriority[priorityIndex(p)][st]; }
+    int priorityLevels() const { return PRIORITY_LEVELS; }
+
+    // Hubs whose city counts changed since the last clearDirtyCities(), so
+    // state.snap rewrites only those rows
+    const Vector<int>& changedCities() const { return dirtyCities; }
+    void clearDirtyCities() {
+        for (int hub : dirtyCities) cityDirty[hub] = 0;
+        dirtyCities.clear();
+    }
+
+    void save(RecoveryWriter& out) const {
+        out.value(totals);
+        out.value(byPriority);
+        out.vector(byCity);
+        out.vector(byLane);
+    }
+
+    bool restore(RecoveryReader& in) {
+        return in.value(totals) && in.value(byPriority) && in.vector(byCity, network.hubCount * STATUS_COUNT) &&
+               byCity.size() == network.hubCount * STATUS_COUNT && in.vector(byLane, ParcelStore::MAX_PARCELS);
+    }
+};
+
+// --- VEHICLE ALLOCATION: FIRST-FIT DECREASING BIN PACKING ---
+// Packs the batches of all lanes leaving one source hub into that hub's
+// remaining fleet, as many vehicles per lane as it takes. Parcels are placed
+// by priority class (overnight first, across every lane, so a later lane's
+// overnight parcels are never starved by an earlier lane's normal ones), and
+// heaviest first within a class, into the first open vehicle of their lane
+// with room; a max-tree per lane finds it in O(log V). A vehicle is opened
+// only when none fits: the smallest type that would hold all that is still
+// unplaced on that lane, else the largest type left. A parcel heavier than a
+// truck gets a truck to itself (a convoy). What fits nowhere stays queued.
+enum VehicleType { VEHICLE_BUS300, VEHICLE_BUS600, VEHICLE_TRUCK, VEHICLE_TYPES };
+const int VEHICLE_CAPACITY[VEHICLE_TYPES] = {300, 600, 2000};
+
+class VehicleAllocator {
+public:
+    struct Load {
+        int lane;
+        int vehicle;                // VehicleType
+        bool convoy;                // One parcel over truck capacity
+        int weight;
+        int first, count;           // Slice of `packed`
+    };
+
+private:
+    struct Item {
+        ParcelHandle h;
+        int lane;
+        int weight;
+        int priority;
+        int load;                   // Index into loads, -1 = did not fit
+    };
+
+    struct Lane {
+        int items;
+        long long unplaced;         // kg of this lane not placed yet
+        int leaves;                 // Max-tree over the lane's vehicles
+        int treeBase;               // Node i of the tree is tree[treeBase + i]
+        int opened;                 // Vehicles opened so far
+        int firstLoad, loadCount;   // Range of `loads` once packed
+        int leftoverCount, leftoverWeight;
+    };
+
+    Vector<Item> items, sortBuffer;
+    Vector<Lane> lanes;
+    Vector<int> tree;               // Room left per vehicle, max per segment
+    Vector<int> laneVehicle;        // treeBase + leaf -> index into loads
+    Vector<Load> opened;            // Opening order, regrouped into `loads`
+    Vector<int> remap;
+
+    static bool before(const Item& a, const Item& b) {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        return a.weight > b.weight;
+    }
+
+    // Stable bottom-up merge sort, so equal parcels keep booking order
+    void sortItems() {
+        int n = items.size();
+        sortBuffer.assign(n, Item());
+        Item* src = items.begin();
+        Item* dst = sortBuffer.begin();
+        for (int width = 1; width < n; width *= 2) {
+            for (int lo = 0; lo < n; lo += 2 * width) {
+                int mid = min(lo + width, n), hi = min(lo + 2 * width, n);
+                int i = lo, j = mid, k = lo;
+                while (i < mid && j < hi) dst[k++] = before(src[j], src[i]) ? src[j++] : src[i++];
+                while (i < mid) dst[k++] = src[i++];
+                while (j < hi) dst[k++] = src[j++];
+            }
+            Item* t = src; src = dst; dst = t;
+        }
+        if (src != items.begin()) for (int i = 0; i < n; i++) items[i] = src[i];
+    }
+
+    void setRoom(const Lane& l, int slot, int room) {
+        int* t = tree.begin() + l.treeBase;
+        int i = l.leaves + slot;
+        t[i] = room;
+        for (i /= 2; i >= 1; i /= 2) t[i] = max(t[2 * i], t[2 * i + 1]);
+    }
+
+    // Leftmost open vehicle of the lane with at least `w` kg of room, -1 if none
+    int firstFit(const Lane& l, int w) const {
+        const int* t = tree.begin() + l.treeBase;
+        if (t[1] < w) return -1;
+        int i = 1;
+        while (i < l.leaves) i = t[2 * i] >= w ? 2 * i : 2 * i + 1;
+        return i - l.leaves;
+    }
+
+    int openVehicle(int lane, int type, bool convoy, int available[VEHICLE_TYPES]) {
+        Lane& l = lanes[lane];
+        available[type]--;
+        int slot = l.opened++;
+        laneVehicle[l.treeBase + slot] = opened.size();
+        opened.push_back({lane, type, convoy, 0, 0, 0});
+        setRoom(l, slot, convoy ? -1 : VEHICLE_CAPACITY[type]);    // -1: closed
+        return slot;
+    }
+
+public:
+    Vector<Load> loads;             // Grouped by lane, in opening order within one
+    Vector<ParcelHandle> packed;    // Parcels grouped by load
+
+    void reset() {
+        items.clear();
+        lanes.clear();
+        loads.clear();
+        packed.clear();
+    }
+
+    // Lanes are numbered in the order they are added
+    int addLane() {
+        lanes.push_back({0, 0, 0, 0, 0, 0, 0, 0, 0});
+        return lanes.size() - 1;
+    }
+
+    void add(int lane, ParcelHandle h, int weight, int priority) {
+        int w = weight > 0 ? weight : 0;
+        items.push_back({h, lane, w, priority, -1});
+        lanes[lane].items++;
+        lanes[lane].unplaced += w;
+    }
+
+    // Withdraws the most recently added lane and its parcels
+    void dropLastLane() {
+        int lane = lanes.size() - 1;
+        while (!items.empty() && items[items.size() - 1].lane == lane) items.pop_back();
+        lanes.pop_back();
+    }
+
+    int laneCount() const { return lanes.size(); }
+    int parcelCount(int lane) const { return lanes[lane].items; }
+    int firstLoad(int lane) const { return lanes[lane].firstLoad; }
+    int loadCount(int lane) const { return lanes[lane].loadCount; }
+    int leftoverCount(int lane) const { return lanes[lane].leftoverCount; }
+    int leftoverWeight(int lane) const { return lanes[lane].leftoverWeight; }
+
+    // Takes vehicles out of `available` (per VehicleType) for what it packs
+    void pack(int available[VEHICLE_TYPES]) {
+        int fleet = 0;
+        for (int t = 0; t < VEHICLE_TYPES; t++) fleet += available[t];
+        int treeSize = 0;
+        for (Lane& l : lanes) {
+            int maxVehicles = max(1, min(fleet, l.items));
+            l.leaves = 1;
+            while (l.leaves < maxVehicles) l.leaves *= 2;
+            l.treeBase = treeSize;
+            treeSize += 2 * l.leaves;
+        }
+        tree.assign(treeSize, -1);
+        laneVehicle.assign(treeSize, -1);
+        opened.clear();
+        sortItems();
+
+        for (Item& it : items) {
+            Lane& l = lanes[it.lane];
+            int slot = -1;
+            if (it.weight > VEHICLE_CAPACITY[VEHICLE_TRUCK]) {
+                if (available[VEHICLE_TRUCK] > 0) slot = openVehicle(it.lane, VEHICLE_TRUCK, true, available);
+            } else {
+                slot = firstFit(l, it.weight);
+                if (slot < 0) {
+                    int type = -1;
+                    for (int t = 0; t < VEHICLE_TYPES && type < 0; t++)
+                        if (available[t] > 0 && VEHICLE_CAPACITY[t] >= l.unplaced) type = t;
+                    for (int t = VEHICLE_TYPES - 1; t >= 0 && type < 0; t--)
+                        if (available[t] > 0 && VEHICLE_CAPACITY[t] >= it.weight) type = t;
+                    if (type >= 0) slot = openVehicle(it.lane, type, false, available);
+                }
+                if (slot >= 0) setRoom(l, slot, tree[l.treeBase + l.leaves + slot] - it.weight);
+            }
+            l.unplaced -= it.weight;
+            it.load = slot < 0 ? -1 : laneVehicle[l.treeBase + slot];
+            if (it.load >= 0) { opened[it.load].weight += it.weight; opened[it.load].count++; }
+            else { l.leftoverCount++; l.leftoverWeight += it.weight; }
+        }
+
+        // Regroup the vehicles by lane, then the manifests by vehicle
+        int next = 0;
+        for (Lane& l : lanes) { l.firstLoad = next; next += l.opened; l.loadCount = 0; }
+        loads.assign(opened.size(), Load());
+        remap.assign(opened.size(), -1);
+        for (int v = 0; v < opened.size(); v++) {
+            Lane& l = lanes[opened[v].lane];
+            remap[v] = l.firstLoad + l.loadCount++;
+            loads[remap[v]] = opened[v];
+        }
+        int offset = 0;
+        for (Load& ld : loads) { ld.first = offset; offset += ld.count; ld.count = 0; }
+        packed.assign(offset, NO_PARCEL);
+        for (const Item& it : items) {
+            if (it.load < 0) continue;
+            Load& ld = loads[remap[it.load]];
+            packed[ld.first + ld.count++] = it.h;
+        }
+    }
+};
+
+// --- ROUTING ENGINES ---
+// Point-to-point shortest paths over a CSR road graph, returning the full
+// hop sequence. Roads are two-way with the same length both ways, so a
+// backward search can walk the forward edges. Queries only read the engine;
+// their working state lives in a RouteScratch, so threads share one engine
+// and each brings its own scratch.
+struct RoadGraph {
+    int n;
+    const int* rowStart;
+    const int* adj;
+    const int* weight;              // Per edge slot, <= 0 = closed
+    const float* x;                 // Hub positions in km, or nullptr
+    const float* y;
+};
+
+struct RoutePath {
+    int distance;                   // -1 when unreachable
+    Vector<int> hubs;               // src ... dest
+};
+
+// Per-thread query state, sized on first use
+struct RouteScratch {
+    Vector<int> dist[2], parent[2];     // [0] forward search, [1] backward
+    Vector<unsigned> stamp[2];          // Entry valid only if stamp == queryStamp
+    unsigned queryStamp;
+    QueryHeap heap[2];
+
+    RouteScratch() : queryStamp(0) {}
+
+    // Starts a query over n hubs: invalidates the previous one's entries
+    void begin(int n) {
+        if (dist[0].size() != n) {
+            for (int side = 0; side < 2; side++) {
+                dist[side].assign(n, INT_MAX);
+                parent[side].assign(n, -1);
+                stamp[side].assign(n, 0);
+            }
+            queryStamp = 0;
+        }
+        if (++queryStamp == 0) {
+            for (int side = 0; side < 2; side++) stamp[side].assign(n, 0);
+            queryStamp = 1;
+        }
+        heap[0].clear(); heap[1].clear();
+    }
+
+    void set(int side, int v, int d, int from) {
+        dist[side][v] = d; parent[side][v] = from; stamp[side][v] = queryStamp;
+    }
+
+    bool seen(int side, int v) const { return stamp[side][v] == queryStamp; }
+    int distOf(int side, int v) const { return seen(side, v) ? dist[side][v] : INT_MAX; }
+};
+
+class RoutingEngine {
+    RouteScratch ownScratch;
+
+public:
+    virtual ~RoutingEngine() {}
+    virtual const char* name() const = 0;
+    // Safe to call from several threads at once, each with its own scratch
+    virtual bool query(int src, int dest, RouteScratch& scratch, RoutePath& out) const = 0;
+    // Single-threaded callers use the engine's own scratch
+    bool query(int src, int dest, RoutePath& out) { return query(src, dest, ownScratch, out); }
+};
+
+// Baseline: the full single-source Dijkstra with MinHeap that Graph used
+class DijkstraRouter : public RoutingEngine {
+    RoadGraph g;
+
+public:
+    using RoutingEngine::query;
+
+    DijkstraRouter(const RoadGraph& graph) : g(graph) {}
+
+    const char* name() const { return "Dijkstra (MinHeap)"; }
+
+    bool query(int src, int dest, RouteScratch& scratch, RoutePath& out) const {
+        scratch.begin(g.n);
+        Vector<int>& dist = scratch.dist[0];
+        Vector<int>& parent = scratch.parent[0];
+        MinHeap minHeap(g.n);
+        for (int v = 0; v < g.n; ++v) {
+            dist[v] = INT_MAX;
+            parent[v] = -1;
+            minHeap.insert(v, dist[v]);
+        }
+        minHeap.decreaseKey(src, 0);
+        dist[src] = 0;
+        while (!minHeap.isEmpty()) {
+            int u = minHeap.extractMin().v;
+            if (dist[u] == INT_MAX) break;
+            for (int e = g.rowStart[u]; e < g.rowStart[u + 1]; e++) {
+                int v = g.adj[e];
+                if (g.weight[e] > 0 && minHeap.isInMinHeap(v) && dist[u] + g.weight[e] < dist[v]) {
+                    dist[v] = dist[u] + g.weight[e];
+                    parent[v] = u;
+                    minHeap.decreaseKey(v, dist[v]);
+                }
+            }
+        }
+        out.hubs.clear();
+        if (dist[dest] == INT_MAX) { out.distance = -1; return false; }
+        out.distance = dist[dest];
+        for (int v = dest; v != -1; v = parent[v]) out.hubs.push_back(v);
+        for (int i = 0, j = out.hubs.size() - 1; i < j; i++, j--) {
+            int t = out.hubs[i]; out.hubs[i] = out.hubs[j]; out.hubs[j] = t;
+        }
+        return true;
+    }
+};
+
+// Bidirectional A* with average potentials (Ikeda et al.): forward key
+// 2*d + (hf - hb), backward key 2*d - (hf - hb), where hf/hb are straight-line
+// lower bounds to the target/from the source. Keys are doubled to stay in
+// integers. Without coordinates the bounds are 0 and this is plain
+// bidirectional Dijkstra. Works on live weights, so it needs no preprocessing.
+class BidirectionalAStarRouter : public RoutingEngine {
+    RoadGraph g;
+    double scale;                   // km of road per km of straight line, lower bound
+
+    long long bound(int a, int b) const {
+        if (!g.x || scale <= 0) return 0;
+        double dx = g.x[a] - g.x[b], dy = g.y[a] - g.y[b];
+        return (long long)(scale * sqrt(dx * dx + dy * dy));   // floor keeps it consistent
+    }
+
+    long long potential2(int src, int dest, int v) const { return bound(v, dest) - bound(src, v); }
+
+public:
+    using RoutingEngine::query;
+
+    BidirectionalAStarRouter(const RoadGraph& graph) : g(graph) {
+        // Largest factor that never overestimates any road
+        scale = 0;
+        if (g.x) {
+            scale = 1.0;
+            for (int u = 0; u < g.n; u++) {
+                for (int e = g.rowStart[u]; e < g.rowStart[u + 1]; e++) {
+                    int v = g.adj[e];
+                    double dx = g.x[u] - g.x[v], dy = g.y[u] - g.y[v];
+                    double straight = sqrt(dx * dx + dy * dy);
+                    if (straight > 0 && g.weight[e] > 0 && g.weight[e] / straight < scale) scale = g.weight[e] / straight;
+                }
+            }
+        }
+    }
+
+    const char* name() const { return g.x ? "Bidirectional A*" : "Bidirectional Dijkstra"; }
+
+    bool query(int s, int t, RouteScratch& scratch, RoutePath& out) const {
+        out.hubs.clear();
+        scratch.begin(g.n);
+        Vector<int>* dist = scratch.dist;
+        Vector<int>* parent = scratch.parent;
+        QueryHeap* heap = scratch.heap;
+        scratch.set(0, s, 0, -1);
+        scratch.set(1, t, 0, -1);
+        heap[0].push(potential2(s, t, s), s);
+        heap[1].push(-potential2(s, t, t), t);
+
+        long long best = (s == t) ? 0 : LLONG_MAX / 4;
+        int meet = (s == t) ? s : -1;
+        while (!heap[0].isEmpty() && !heap[1].isEmpty()) {
+            if (heap[0].top().key + heap[1].top().key >= 2 * best) break;
+            int side = heap[0].top().key <= heap[1].top().key ? 0 : 1;
+            QueryHeap::Entry top = heap[side].top();
+            heap[side].pop();
+            int u = top.v;
+            long long sign = side == 0 ? 1 : -1;
+            if (top.key != 2LL * dist[side][u] + sign * potential2(s, t, u)) continue;   // Stale
+
+            for (int e = g.rowStart[u]; e < g.rowStart[u + 1]; e++) {
+                if (g.weight[e] <= 0) continue;
+                int v = g.adj[e];
+                int nd = dist[side][u] + g.weight[e];
+                if (nd >= scratch.distOf(side, v)) continue;
+                scratch.set(side, v, nd, u);
+                heap[side].push(2LL * nd + sign * potential2(s, t, v), v);
+                int other = scratch.distOf(1 - side, v);
+                if (other != INT_MAX && (long long)nd + other < best) {
+                    best = (long long)nd + other;
+                    meet = v;
+                }
+            }
+        }
+        if (meet < 0) { out.distance = -1; return false; }
+
+        out.distance = (int)best;
+        for (int v = meet; v != -1; v = parent[0][v]) out.hubs.push_back(v);
+        for (int i = 0, j = out.hubs.size() - 1; i < j; i++, j--) {
+            int tmp = out.hubs[i]; out.hubs[i] = out.hubs[j]; out.hubs[j] = tmp;
+        }
+        for (int v = parent[1][meet]; v != -1; v = parent[1][v]) out.hubs.push_back(v);
+        return true;
+    }
+};
+
+// Contraction hierarchies: hubs are contracted one at a time in order of
+// importance (edge difference + contracted neighbours, lazily updated),
+// adding a shortcut u-w through v whenever a bounded witness search finds no
+// path at least as short. A query is then two upward Dijkstra searches that
+// settle only a few hundred hubs, and shortcuts are unpacked into the real
+// hop sequence. Built on a snapshot of the weights; rebuild after changes.
+class ContractionHierarchy : public RoutingEngine {
+    static const int WITNESS_SETTLE_LIMIT = 500;
+
+    struct CHEdge {
+        int to;
+        int weight;
+        int middle;                 // Contracted hub a shortcut bypasses, -1 = real road
+    };
+
+    int n;
+    Vector<int> rank;
+    Vector<int> upStart, upTo, upWeight, upMiddle;  // Upward CSR (to higher rank)
+
+    // Preprocessing scratch
+    Vector<Vector<CHEdge>> graph;
+    Vector<char> contracted;
+    Vector<int> witnessDist;
+    Vector<unsigned> witnessStamp;
+    unsigned witnessRun;
+    QueryHeap witnessHeap;
+
+    void addOrUpdate(int u, int w, int weight, int middle) {
+        Vector<CHEdge>& list = graph[u];
+        for (int i = 0; i < list.size(); i++) {
+            if (list[i].to == w) {
+                if (weight < list[i].weight) { list[i].weight = weight; list[i].middle = middle; }
+                return;
+            }
+        }
+        list.push_back({w, weight, middle});
+    }
+
+    // Bounded Dijkstra from u that ignores `skip` and contracted hubs
+    void witnessSearch(int u, int skip, int maxDist) {
+        if (++witnessRun == 0) { witnessStamp.assign(n, 0); witnessRun = 1; }
+        witnessHeap.clear();
+        witnessDist[u] = 0; witnessStamp[u] = witnessRun;
+        witnessHeap.push(0, u);
+        int settled = 0;
+        while (!witnessHeap.isEmpty() && settled < WITNESS_SETTLE_LIMIT) {
+            QueryHeap::Entry top = witnessHeap.top();
+            witnessHeap.pop();
+            if (top.key != witnessDist[top.v]) continue;
+            if (top.key > maxDist) break;
+            settled++;
+            Vector<CHEdge>& list = graph[top.v];
+            for (int i = 0; i < list.size(); i++) {
+                int v = list[i].to;
+                if (v == skip || contracted[v]) continue;
+                int nd = (int)top.key + list[i].weight;
+                if (witnessStamp[v] != witnessRun || nd < witnessDist[v]) {
+                    witnessDist[v] = nd; witnessStamp[v] = witnessRun;
+                    witnessHeap.push(nd, v);
+                }
+            }
+        }
+    }
+
+    int witnessOf(int v) const { return witnessStamp[v] == witnessRun ? witnessDist[v] : INT_MAX; }
+
+    // Shortcuts needed to contract v (added when apply is true)
+    int contract(int v, bool apply) {
+        Vector<CHEdge>& list = graph[v];
+        int shortcuts = 0;
+        for (int i = 0; i < list.size(); i++) {
+            int u = list[i].to;
+            if (contracted[u]) continue;
+            int maxDist = 0;
+            for (int j = i + 1; j < list.size(); j++) {
+                if (!contracted[list[j].to] && list[i].weight + list[j].weight > maxDist) maxDist = list[i].weight + list[j].weight;
+            }
+            if (maxDist == 0) continue;
+            witnessSearch(u, v, maxDist);
+            for (int j = i + 1; j < list.size(); j++) {
+                int w = list[j].to;
+                if (contracted[w] || w == u) continue;
+                int via = list[i].weight + list[j].weight;
+                if (witnessOf(w) <= via) continue;
+                shortcuts++;
+                if (apply) {
+                    addOrUpdate(u, w, via, v);
+                    addOrUpdate(w, u, via, v);
+                }
+            }
+        }
+        return shortcuts;
+    }
+
+    int liveDegree(int v) {
+        int d = 0;
+        for (int i = 0; i < graph[v].size(); i++) if (!contracted[graph[v][i].to]) d++;
+        return d;
+    }
+
+    // Appends the real hops of edge a->b (excluding a) to out
+    void unpack(int a, int b, Vector<int>& out) const {
+        int low = rank[a] < rank[b] ? a : b;
+        int high = low == a ? b : a;
+        int middle = -1;
+        for (int e = upStart[low]; e < upStart[low + 1]; e++) {
+            if (upTo[e] == high) { middle = upMiddle[e]; break; }
+        }
+        if (middle < 0) { out.push_back(b); return; }
+        unpack(a, middle, out);
+        unpack(middle, b, out);
+    }
+
+public:
+    double buildSeconds;
+    int shortcutCount;
+    long long weightsVersion;       // Graph weights this hierarchy was built from
+
+    using RoutingEngine::query;
+
+    ContractionHierarchy() { n = 0; buildSeconds = 0; shortcutCount = 0; weightsVersion = 0; }
+
+    const char* name() const { return "Contraction Hierarchies"; }
+
+    void build(const RoadGraph& g) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        n = g.n;
+        graph.assign(n, Vector<CHEdge>());
+        for (int u = 0; u < n; u++) {
+            for (int e = g.rowStart[u]; e < g.rowStart[u + 1]; e++) {
+                if (g.weight[e] > 0 && g.adj[e] != u) addOrUpdate(u, g.adj[e], g.weight[e], -1);
+            }
+        }
+        contracted.assign(n, 0);
+        witnessDist.assign(n, INT_MAX);
+        witnessStamp.assign(n, 0);
+        witnessRun = 0;
+        rank.assign(n, 0);
+        Vector<int> deletedNeighbours;
+        deletedNeighbours.assign(n, 0);
+
+        QueryHeap order;
+        for (int v = 0; v < n; v++) order.push(contract(v, false) - liveDegree(v), v);
+
+        shortcutCount = 0;
+        int nextRank = 0;
+        while (!order.isEmpty()) {
+            int v = order.top().v;
+            order.pop();
+            if (contracted[v]) continue;
+            // Lazy update: re-evaluate, contract only if still the cheapest
+            long long priority = contract(v, false) - liveDegree(v) + deletedNeighbours[v];
+            if (!order.isEmpty() && priority > order.top().key) {
+                order.push(priority, v);
+                continue;
+            }
+            shortcutCount += contract(v, true);
+            contracted[v] = 1;
+            rank[v] = nextRank++;
+            for (int i = 0; i < graph[v].size(); i++) deletedNeighbours[graph[v][i].to]++;
+        }
+
+        // Keep only upward edges, as CSR
+        upStart.assign(n + 1, 0);
+        for (int u = 0; u < n; u++) {
+            for (int i = 0; i < graph[u].size(); i++) if (rank[graph[u][i].to] > rank[u]) upStart[u + 1]++;
+        }
+        for (int u = 0; u < n; u++) upStart[u + 1] += upStart[u];
+        upTo.assign(upStart[n], 0);
+        upWeight.assign(upStart[n], 0);
+        upMiddle.assign(upStart[n], 0);
+        Vector<int> fill = upStart;
+        for (int u = 0; u < n; u++) {
+            for (int i = 0; i < graph[u].size(); i++) {
+                const CHEdge& e = graph[u][i];
+                if (rank[e.to] <= rank[u]) continue;
+                upTo[fill[u]] = e.to; upWeight[fill[u]] = e.weight; upMiddle[fill[u]++] = e.middle;
+            }
+        }
+        graph = Vector<Vector<CHEdge>>();  // Release the build graph
+        buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    bool query(int s, int t, RouteScratch& scratch, RoutePath& out) const {
+        out.hubs.clear();
+        scratch.begin(n);
+        Vector<int>* dist = scratch.dist;
+        Vector<int>* parentHub = scratch.parent;
+        QueryHeap* heap = scratch.heap;
+        scratch.set(0, s, 0, -1); heap[0].push(0, s);
+        scratch.set(1, t, 0, -1); heap[1].push(0, t);
+
+        long long best = LLONG_MAX;
+        int meet = -1;
+        int side = 0;
+        while (!heap[0].isEmpty() || !heap[1].isEmpty()) {
+            if (heap[side].isEmpty()) side = 1 - side;
+            QueryHeap::Entry top = heap[side].top();
+            heap[side].pop();
+            int u = top.v;
+            if (top.key != dist[side][u]) { side = 1 - side; continue; }  // Stale
+            if (top.key >= best) {
+                heap[side].clear();             // This direction cannot improve
+                side = 1 - side;
+                continue;
+            }
+            if (scratch.seen(1 - side, u) && top.key + dist[1 - side][u] < best) {
+                best = top.key + dist[1 - side][u];
+                meet = u;
+            }
+            for (int e = upStart[u]; e < upStart[u + 1]; e++) {
+                int v = upTo[e];
+                int nd = (int)top.key + upWeight[e];
+                if (!scratch.seen(side, v) || nd < dist[side][v]) {
+                    scratch.set(side, v, nd, u);
+                    heap[side].push(nd, v);
+                }
+            }
+            side = 1 - side;
+        }
+        if (meet < 0) { out.distance = -1; return false; }
+
+        out.distance = (int)best;
+        // Upward chain s..meet (reversed), then meet..t, unpacking every edge
+        Vector<int> chain;
+        for (int v = meet; v != -1; v = parentHub[0][v]) chain.push_back(v);
+        out.hubs.push_back(s);
+        for (int i = chain.size() - 1; i > 0; i--) unpack(chain[i], chain[i - 1], out.hubs);
+        for (int v = meet; parentHub[1][v] != -1; v = parentHub[1][v]) unpack(v, parentHub[1][v], out.hubs);
+        return true;
+    }
+};
+
+// --- ROUTE TABLE: DISTANCE + NEXT HOP PER SOURCE ---
+// Row s holds dist[d] (shortest s->d distance, -1 = unreachable), nextHop[d]
+// (first hub after s on that path) and parent[d] (d's predecessor in s's
+// shortest-path tree, used to find which rows an edge change affects).
+// Small networks get every row up front; large ones fill rows on first use.
+struct RouteRow {
+    int* dist;
+    int* nextHop;
+    int* parent;
+
+    RouteRow(int n) {
+        dist = new int[n];
+        nextHop = new int[n];
+        parent = new int[n];
+    }
+    ~RouteRow() {
+        delete[] dist;
+        delete[] nextHop;
+        delete[] parent;
+    }
+};
+
+struct RouteTable {
+    int n;
+    RouteRow** rows;                // nullptr until the row is computed
+    long long weightsVersion;       // Graph weights this table was built from
+
+    RouteTable(int count) {
+        n = count;
+        rows = new RouteRow*[n];
+        for (int i = 0; i < n; i++) rows[i] = nullptr;
+        weightsVersion = 0;
+    }
+    ~RouteTable() {
+        for (int i = 0; i < n; i++) delete rows[i];
+        delete[] rows;
+    }
+};
+
+class Graph {
+    static const int PREBUILD_LIMIT = 512;  // Hubs up to which the full route table is kept
+
+    // CSR structure comes from `network`; only the weights change at run time
+    int n;
+    Vector<int> weight;             // Per edge slot, 0 while the road is closed
+    mutex graphMutex;               // Guards weights against the rebuild thread
+
+    // Route cache: the sim thread owns `routes`; the rebuild thread hands a
+    // fresh table over through `pendingRoutes` whenever an edge changes.
+    RouteTable* routes;
+    RouteTable* pendingRoutes;
+    Vector<char> rowWanted;         // Sources the rebuild thread should include
+    mutex routeMutex;
+    condition_variable rebuildCv;
+    long long edgeVersion;          // Bumped by setEdgeWeight (full rebuild requests)
+    long long builtVersion;         // Version the rebuild thread last finished
+    long long weightsVersion;       // Bumped on every weight change, any path
+    bool stopRebuild;
+    thread rebuildThread;
+
+    // Large networks skip the table (n rows of n entries) and answer each
+    // query point to point: contraction hierarchies once the rebuild thread
+    // has preprocessed the current weights, bidirectional A* over the live
+    // weights until then.
+    bool tableMode;
+    ContractionHierarchy* ch;
+    ContractionHierarchy* pendingCh;
+    BidirectionalAStarRouter* fallback;
+    RoutePath scratchPath;
+
+    // Parallel dispatch: every worker queries the shared point router with
+    // its own scratch (worker 0 is the sim thread and uses the router's).
+    // Kept across hierarchy swaps: scratch does not depend on the router.
+    struct WorkerScratch {
+        RouteScratch scratch;
+        RoutePath path;
+    };
+    Vector<WorkerScratch*> workerScratch;
+
+    RoadGraph liveGraph(const int* weights) {
+        return {n, network.rowStart.begin(), network.adjHub.begin(), weights,
+                network.hasCoords ? network.x.begin() : nullptr,
+                network.hasCoords ? network.y.begin() : nullptr};
+    }
+
+    // Rebuild thread, graphMutex held
+    ContractionHierarchy* buildHierarchy() {
+        ContractionHierarchy* h = new ContractionHierarchy();
+        h->build(liveGraph(weight.begin()));
+        h->weightsVersion = weightsVersion;
+        return h;
+    }
+
+    RoutingEngine* pointRouter() {
+        if (ch && ch->weightsVersion == weightsVersion) return ch;
+        return fallback;
+    }
+
+    int edgeSlot(int u, int v) {
+        for (int e = network.rowStart[u]; e < network.rowStart[u + 1]; e++) {
+            if (network.adjHub[e] == v) return e;
+        }
+        return -1;
+    }
+
+    // Single-source Dijkstra over the current weights, filling one table row
+    void computeRow(int src, RouteRow* row) {
+        int* dist = row->dist;
+        int* nextHop = row->nextHop;
+        int* parent = row->parent;
+        MinHeap minHeap(n);
+        int* settled = new int[n];
+        int settledCount = 0;
+
+        for (int v = 0; v < n; ++v) {
+            dist[v] = INT_MAX;
+            parent[v] = -1;
+            minHeap.insert(v, dist[v]);
+        }
+
+        minHeap.decreaseKey(src, 0);
+        dist[src] = 0;
+
+        while (!minHeap.isEmpty()) {
+            HeapNode minNode = minHeap.extractMin();
+            int u = minNode.v;
+            if (dist[u] == INT_MAX) break;      // Rest of the heap is unreachable
+            settled[settledCount++] = u;
+
+            for (int e = network.rowStart[u]; e < network.rowStart[u + 1]; e++) {
+                int v = network.adjHub[e];
+                if (weight[e] > 0 && minHeap.isInMinHeap(v) && weight[e] + dist[u] < dist[v]) {
+                    dist[v] = dist[u] + weight[e];
+                    parent[v] = u;
+                    minHeap.decreaseKey(v, dist[v]);
+                }
+            }
+        }
+
+        // Parents settle before children, so first hops resolve in one pass
+        for (int v = 0; v < n; ++v) nextHop[v] = -1;
+        for (int i = 0; i < settledCount; i++) {
+            int v = settled[i];
+            if (v != src) nextHop[v] = (parent[v] == src) ? v : nextHop[parent[v]];
+        }
+        for (int v = 0; v < n; ++v) {
+            if (dist[v] == INT_MAX) { dist[v] = -1; parent[v] = -1; }
+        }
+        delete[] settled;
+    }
+
+    RouteTable* buildRouteTable(const Vector<char>& wanted) {
+        RouteTable* t = new RouteTable(n);
+        for (int s = 0; s < n; s++) {
+            if (!wanted[s]) continue;
+            t->rows[s] = new RouteRow(n);
+            computeRow(s, t->rows[s]);
+        }
+        t->weightsVersion = weightsVersion;
+        return t;
+    }
+
+    RouteRow* row(int src) {
+        RouteRow* r = routes->rows[src];
+        if (r) return r;
+        r = new RouteRow(n);
+        computeRow(src, r);
+        routes->rows[src] = r;
+        lock_guard<mutex> lock(routeMutex);
+        rowWanted[src] = 1;
+        return r;
+    }
+
+    void rebuildLoop() {
+        unique_lock<mutex> lock(routeMutex);
+        while (true) {
+            rebuildCv.wait(lock, [this]{ return stopRebuild || builtVersion != edgeVersion; });
+            if (stopRebuild) return;
+            long long version = edgeVersion;
+            Vector<char> wanted = rowWanted;
+            lock.unlock();
+
+            RouteTable* fresh = nullptr;
+            ContractionHierarchy* freshCh = nullptr;
+            {
+                lock_guard<mutex> g(graphMutex);
+                if (tableMode) fresh = buildRouteTable(wanted);
+                else freshCh = buildHierarchy();
+            }
+
+            lock.lock();
+            if (fresh) {
+                if (pendingRoutes) delete pendingRoutes;
+                pendingRoutes = fresh;
+            } else {
+                if (pendingCh) delete pendingCh;
+                pendingCh = freshCh;
+            }
+            builtVersion = version;
+        }
+    }
+
+public:
+    Graph() {
+        n = network.hubCount;
+        weight = network.adjKm;
+        tableMode = n <= PREBUILD_LIMIT;
+        rowWanted.assign(n, tableMode ? 1 : 0);
+        weightsVersion = 0;
+        routes = buildRouteTable(rowWanted);
+        pendingRoutes = nullptr;
+        ch = pendingCh = nullptr;
+        fallback = new BidirectionalAStarRouter(liveGraph(weight.begin()));
+        // In router mode the first rebuild preprocesses the hierarchy
+        edgeVersion = tableMode ? 0 : 1;
+        builtVersion = 0;
+        stopRebuild = false;
+        rebuildThread = thread(&Graph::rebuildLoop, this);
+    }
+
+    ~Graph() {
+        {
+            lock_guard<mutex> lock(routeMutex);
+            stopRebuild = true;
+        }
+        rebuildCv.notify_one();
+        rebuildThread.join();
+        delete routes;
+        if (pendingRoutes) delete pendingRoutes;
+        for (WorkerScratch* w : workerScratch) delete w;
+        delete ch;
+        delete pendingCh;
+        delete fallback;
+    }
+
+    // Changes one directed edge (weight <= 0 closes it) and schedules a
+    // background rebuild of the route table.
+    void setEdgeWeight(int u, int v, int w) {
+        int e = edgeSlot(u, v);
+        if (e < 0) return;
+        {
+            lock_guard<mutex> g(graphMutex);
+            weight[e] = w > 0 ? w : 0;
+            weightsVersion++;
+        }
+        {
+            lock_guard<mutex> lock(routeMutex);
+            edgeVersion++;
+        }
+        rebuildCv.notify_one();
+    }
+
+    // Closes (open=false) or reopens one directed edge and patches the route
+    // table in place on the calling (sim) thread. Only the source rows whose
+    // shortest-path tree can change are recomputed:
+    //  - closing u->v affects sources whose tree uses that edge (parent of v is u)
+    //  - reopening u->v affects sources for which it now gives a shorter path to v
+    // Returns the number of rows recomputed.
+    int updateEdge(int u, int v, bool open) {
+        int e = edgeSlot(u, v);
+        if (e < 0) return 0;
+        int newWeight = open ? network.adjKm[e] : 0;
+        if (weight[e] == newWeight) return 0;
+        if (!tableMode) {
+            // A* follows the live weights right away; the hierarchy is rebuilt
+            setEdgeWeight(u, v, newWeight);
+            return 0;
+        }
+
+        refreshRoutes();
+        {
+            lock_guard<mutex> g(graphMutex);
+            weight[e] = newWeight;
+            weightsVersion++;
+        }
+
+        int recomputed = 0;
+        for (int s = 0; s < n; s++) {
+            RouteRow* r = routes->rows[s];
+            if (!r) continue;
+            bool affected;
+            if (!open) affected = r->parent[v] == u;
+            else affected = r->dist[u] != -1 && (r->dist[v] == -1 || r->dist[u] + newWeight < r->dist[v]);
+            if (!affected) continue;
+            computeRow(s, r);
+            recomputed++;
+        }
+        routes->weightsVersion = weightsVersion;
+        return recomputed;
+    }
+
+    bool isEdgeOpen(int u, int v) {
+        int e = edgeSlot(u, v);
+        return e >= 0 && weight[e] > 0;
+    }
+
+    // Road length ignoring blocks, -1 when there is no direct road
+    int baseWeight(int u, int v) { return network.roadKm(u, v); }
+
+    // Called by the sim thread before a batch of lookups: adopts the newest
+    // table the rebuild thread has finished, if any. A table built from
+    // weights that have since been patched incrementally is dropped.
+    void refreshRoutes() {
+        lock_guard<mutex> lock(routeMutex);
+        if (pendingCh) {
+            delete ch;
+            ch = pendingCh;
+            pendingCh = nullptr;
+        }
+        if (pendingRoutes) {
+            if (pendingRoutes->weightsVersion == weightsVersion) {
+                // Keep rows that were filled lazily after the rebuild started
+                for (int s = 0; s < n; s++) {
+                    if (!pendingRoutes->rows[s] && routes->rows[s]) {
+                        pendingRoutes->rows[s] = routes->rows[s];
+                        routes->rows[s] = nullptr;
+                    }
+                }
+                delete routes;
+                routes = pendingRoutes;
+            } else {
+                delete pendingRoutes;
+            }
+            pendingRoutes = nullptr;
+        }
+    }
+
+    // Sim thread, after refreshRoutes: readies firstHop(.., worker) for
+    // workers 0..count-1
+    void prepareWorkers(int count) {
+        if (tableMode) return;
+        while (workerScratch.size() < count - 1) workerScratch.push_back(new WorkerScratch());
+    }
+
+    // First hub after src on the shortest route to dest, the length of the
+    // road to it and the whole route's length, from one lookup; false when
+    // unreachable. Safe to call concurrently from different workers, as
+    // long as in table mode each source row is only asked for by one of them.
+    // The first road is a shortest path itself, so its length is the live
+    // weight of that road.
+    bool firstHop(int src, int dest, int worker, int& hop, int& hopDist, int& dist) {
+        if (tableMode) {
+            RouteRow* r = row(src);
+            dist = r->dist[dest];
+            hop = r->nextHop[dest];
+        } else {
+            RoutingEngine* router = pointRouter();
+            bool found = worker == 0 ? router->query(src, dest, scratchPath)
+                                     : router->query(src, dest, workerScratch[worker - 1]->scratch, workerScratch[worker - 1]->path);
+            if (!found) return false;
+            RoutePath& path = worker == 0 ? scratchPath : workerScratch[worker - 1]->path;
+            dist = path.distance;
+            hop = path.hubs.size() > 1 ? path.hubs[1] : dest;
+        }
+        if (dist == -1) return false;
+        hopDist = hop == dest ? dist : weight[edgeSlot(src, hop)];
+        return true;
+    }
+
+    // Full hop sequence src..dest; false when unreachable
+    bool routePath(int src, int dest, RoutePath& out) {
+        out.hubs.clear();
+        if (!tableMode) return pointRouter()->query(src, dest, out);
+        out.distance = row(src)->dist[dest];
+        if (out.distance < 0) return false;
+        out.hubs.push_back(src);
+        for (int v = src; v != dest; ) {
+            v = row(v)->nextHop[dest];
+            out.hubs.push_back(v);
+        }
+        return true;
+    }
+
+    const char* routerName() { return tableMode ? "Route table" : pointRouter()->name(); }
+
+    int getShortestPath(int src, int dest) {
+        RouteRow r(n);
+        lock_guard<mutex> g(graphMutex);
+        computeRow(src, &r);
+        return r.dist[dest];
+    }
+};
+
+class Trip {
+public:
+    int src, dest;           // One leg; parcels may be bound further on
+    int vehicle;             // vehicleCode()
+    int distance; 
+    long long startTime; 
+    ParcelHandle* parcels;   // Manifest, allocated from the same DayArena
+    int parcelCount;
+    DayArena* arena;
+    Trip* prevActive;        // Engine's list of trips on the road
+    Trip* nextActive;
+    Trip* wheelNext;         // Arrival schedule (TimingWheel)
+    long long wheelDue;
+
+    Trip(int s, int d, int v, int dist, long long time)
+        : src(s), dest(d), vehicle(v), distance(dist), startTime(time) {
+        parcels = nullptr;
+        parcelCount = 0;
+        arena = nullptr;
+        prevActive = nextActive = wheelNext = nullptr;
+        wheelDue = 0;
+    }
+
+    long long arrivalTime() const { return startTime + (long long)distance * SECONDS_PER_NODE; }
+};
+
+// --- SIMULATION CLOCK ---
+// Maps simulated seconds to wall time. Real time runs one tick per second,
+// accelerated runs `speed` ticks per second, and discrete-event mode never
+// waits: the engine jumps straight to its next scheduled event instead.
+enum ClockMode { CLOCK_REAL_TIME, CLOCK_ACCELERATED, CLOCK_DISCRETE_EVENT };
+
+class SimClock {
+    ClockMode mode;
+    double speed;                   // Simulated seconds per wall second
+    long long originTick;
+    chrono::steady_clock::time_point origin;
+
+public:
+    SimClock(ClockMode m = CLOCK_REAL_TIME, double ticksPerSecond = 1.0, long long startTick = 0) {
+        mode = m;
+        speed = (m == CLOCK_REAL_TIME || ticksPerSecond <= 0) ? 1.0 : ticksPerSecond;
+        originTick = startTick;
+        origin = chrono::steady_clock::now();
+    }
+
+    bool jumps() const { return mode == CLOCK_DISCRETE_EVENT; }
+
+    // Blocks until `tick` is due. Deadlines are absolute, so a slow tick
+    // is caught up instead of drifting.
+    void waitUntil(long long tick) const {
+        if (mode == CLOCK_DISCRETE_EVENT) return;
+        chrono::duration<double> offset((tick - originTick) / speed);
+        this_thread::sleep_until(origin + chrono::duration_cast<chrono::steady_clock::duration>(offset));
+    }
+
+    // Wall time a tick lasts; 0 in discrete-event mode, which has no budget
+    long long tickNs() const { return mode == CLOCK_DISCRETE_EVENT ? 0 : (long long)(1e9 / speed); }
+
+    // How long ago `tick` was due, 0 if it is not yet
+    long long lateNs(long long tick) const {
+        if (mode == CLOCK_DISCRETE_EVENT) return 0;
+        chrono::duration<double> offset((tick - originTick) / speed);
+        chrono::steady_clock::duration late = chrono::steady_clock::now() - (origin + chrono::duration_cast<chrono::steady_clock::duration>(offset));
+        return late.count() > 0 ? chrono::duration_cast<chrono::nanoseconds>(late).count() : 0;
+    }
+
+    string describe() const {
+        if (mode == CLOCK_DISCRETE_EVENT) return "discrete-event";
+        if (mode == CLOCK_REAL_TIME) return "real-time";
+        ostringstream out;
+        out << speed << "x";
+        return out.str();
+    }
+};
+
+// --- WORK-STEALING THREAD POOL ---
+// Runs a batch of independent tasks 0..count-1 on a fixed set of workers and
+// returns when all are done. Tasks are dealt round-robin into per-worker
+// deques; a worker takes from the back of its own deque and, once that is
+// empty, steals from the front of the others, so a few expensive tasks (busy
+// hubs) do not leave the other workers idle. The calling thread is worker 0.
+// Tasks are coarse, so each deque is guarded by a plain mutex.
+class WorkStealingPool {
+public:
+    typedef void (*TaskFn)(void* context, int task, int worker);
+
+private:
+    struct alignas(64) TaskDeque {
+        mutex lock;
+        Vector<int> tasks;
+        int front;                  // Next task a thief takes; back is tasks.size()
+    };
+
+    int workerCount;
+    TaskDeque* deques;
+    Vector<thread*> threads;
+
+    mutex runMutex;
+    condition_variable startCv, doneCv;
+    long long generation;           // Bumped once per run()
+    int busyWorkers;                // Helper threads still inside the current run
+    bool stopping;
+    TaskFn fn;
+    void* context;
+
+    bool takeTask(int worker, int& task) {
+        for (int k = 0; k < workerCount; k++) {
+            TaskDeque& q = deques[(worker + k) % workerCount];
+            lock_guard<mutex> lock(q.lock);
+            if (q.front == q.tasks.size()) continue;
+            if (k == 0) {
+                task = q.tasks[q.tasks.size() - 1];
+                q.tasks.pop_back();
+            } else {
+                task = q.tasks[q.front++];
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void runTasks(int worker) {
+        int task;
+        while (takeTask(worker, task)) fn(context, task, worker);
+    }
+
+    void workerLoop(int worker) {
+        long long seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(runMutex);
+                startCv.wait(lock, [&]{ return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            runTasks(worker);
+            lock_guard<mutex> lock(runMutex);
+            if (--busyWorkers == 0) doneCv.notify_one();
+        }
+    }
+
+    void runErased(int count, TaskFn f, void* ctx) {
+        fn = f;
+        context = ctx;
+        for (int w = 0; w < workerCount; w++) {
+            deques[w].tasks.clear();
+            deques[w].front = 0;
+        }
+        for (int t = 0; t < count; t++) deques[t % workerCount].tasks.push_back(t);
+        if (workerCount == 1) { runTasks(0); return; }
+        {
+            lock_guard<mutex> lock(runMutex);
+            generation++;
+            busyWorkers = workerCount - 1;
+        }
+        startCv.notify_all();
+        runTasks(0);
+        unique_lock<mutex> lock(runMutex);
+        doneCv.wait(lock, [&]{ return busyWorkers == 0; });
+    }
+
+public:
+    explicit WorkStealingPool(int workers) {
+        workerCount = workers < 1 ? 1 : workers;
+        deques = new TaskDeque[workerCount];
+        for (int w = 0; w < workerCount; w++) deques[w].front = 0;
+        generation = 0;
+        busyWorkers = 0;
+        stopping = false;
+        fn = nullptr;
+        context = nullptr;
+        for (int w = 1; w < workerCount; w++) threads.push_back(new thread(&WorkStealingPool::workerLoop, this, w));
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(runMutex);
+            stopping = true;
+        }
+        startCv.notify_all();
+        for (thread* t : threads) { t->join(); delete t; }
+        delete[] deques;
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return workerCount; }
+
+    // body(task, worker); worker is in [0, size()) and never runs two tasks at once
+    template <typename F>
+    void run(int count, F& body) {
+        runErased(count, [](void* ctx, int task, int worker) { (*(F*)ctx)(task, worker); }, &body);
+    }
+};
+
+// --- EVENT RECORDS ---
+// What the engine logs, as fields rather than text. The text form in
+// notifications.txt is rendered from these by renderEvent.
+enum EventType {
+    EV_BOOKING, EV_UNDO, EV_DISPATCH, EV_DEFER, EV_FAILURE, EV_ARRIVAL, EV_LOST,
+    EV_BLOCK, EV_UNBLOCK, EV_NEW_DAY, EV_IMPORT, EV_CHECKPOINT, EVENT_TYPES
+};
+const char* const EVENT_NAMES[EVENT_TYPES] = {"BOOKING", "UNDO", "DISPATCH", "DEFER", "FAILURE", "ARRIVAL", "CRITICAL",
+                                              "BLOCK", "UNBLOCK", "NEW DAY", "IMPORT", "CHECKPOINT"};
+const int NO_HUB = -1;                      // City of a [SYSTEM] event, or no peer
+const int EVENT_TEXT_BYTES = 64;
+
+// Fields by type (unused ones stay 0, NO_HUB or -1):
+//   BOOKING             city = origin, peer = destination, parcel
+//   UNDO, CRITICAL      city, parcel
+//   DISPATCH            city = source, peer = next hub, vehicle, kg = load,
+//                       parcels, extra = parcels relaying, vehicleNo of vehicles, reroute
+//   DEFER               city, peer = next hub, kg and parcels left waiting
+//   FAILURE             city, peer = destination out of reach
+//   ARRIVAL             city, peer = trip origin, vehicle, extra = parcels to relay
+//   BLOCK, UNBLOCK      city and peer = the road's ends, extra = route rows updated
+//   NEW DAY             system
+//   IMPORT              system, parcels booked, text = manifest
+//   CHECKPOINT          system, parcels, extra = ms
+struct LogEvent {
+    long long tick;                         // Absolute sim second; day and second derive from it
+    TrackingKey parcel;
+    int type, city, peer;
+    int vehicle;                            // vehicleCode(), -1 = none
+    int kg, parcels, extra;
+    int vehicleNo, vehicles;
+    int reroute;
+    char text[EVENT_TEXT_BYTES];
+
+    LogEvent() : LogEvent(0, EV_NEW_DAY, NO_HUB) {}
+    LogEvent(long long t, EventType ty, int hub) {
+        tick = t;
+        parcel = 0;
+        type = ty;
+        city = hub;
+        peer = NO_HUB;
+        vehicle = -1;
+        kg = parcels = extra = vehicleNo = vehicles = reroute = 0;
+        text[0] = '\0';
+    }
+
+    int weekday() const { return (int)(tick / SECONDS_PER_DAY % 5) + 1; }
+    int second() const { return (int)(tick % SECONDS_PER_DAY); }
+};
+
+// Vehicles as events, trips and the recovery files store them: type * 2,
+// +1 for a convoy
+const int VEHICLE_CODES = VEHICLE_TYPES * 2;
+const char* const VEHICLE_CODE_NAMES[VEHICLE_CODES] = {"Bus-300", "Bus-300+Convoy", "Bus-600", "Bus-600+Convoy", "Truck", "Truck+Convoy"};
+int vehicleCode(int type, bool convoy) { return type * 2 + (convoy ? 1 : 0); }
+const char* vehicleName(int code) { return VEHICLE_CODE_NAMES[code]; }
+
+// Names behind the ids in events: the live network, or the dictionary
+// stored in events.bin for --query
+struct EventDictionary {
+    Vector<string> hubs;
+    Vector<string> vehicles;
+
+    void fromNetwork() {
+        hubs = network.hubNames;
+        vehicles.clear();
+        for(int code = 0; code < VEHICLE_CODES; code++) vehicles.push_back(vehicleName(code));
+    }
+
+    const string& hub(int id) const {
+        static const string system = "SYSTEM", unknown = "?";
+        return id == NO_HUB ? system : id >= 0 && id < hubs.size() ? hubs[id] : unknown;
+    }
+    const string& vehicle(int code) const {
+        static const string unknown = "?";
+        return code >= 0 && code < vehicles.size() ? vehicles[code] : unknown;
+    }
+};
+
+// Appends text to a fixed buffer, cutting it short at the end; the writer
+// thread renders every event with it, so it avoids printf parsing
+struct LineWriter {
+    char* p;
+    char* end;                      // Last usable byte, kept for the newline
+
+    LineWriter(char* out, int cap) : p(out), end(out + cap - 2) {}
+
+    LineWriter& operator<<(const char* s) {
+        while(*s && p < end) *p++ = *s++;
+        return *this;
+    }
+    LineWriter& operator<<(const string& s) {
+        size_t n = s.size() < (size_t)(end - p) ? s.size() : (size_t)(end - p);
+        memcpy(p, s.data(), n);
+        p += n;
+        return *this;
+    }
+    LineWriter& operator<<(long long v) {
+        char digits[24];
+        int n = 0;
+        unsigned long long u = v < 0 ? 0 - (unsigned long long)v : v;
+        do { digits[n++] = (char)('0' + u % 10); u /= 10; } while(u);
+        if(v < 0 && p < end) *p++ = '-';
+        while(n && p < end) *p++ = digits[--n];
+        return *this;
+    }
+    LineWriter& operator<<(int v) { return *this << (long long)v; }
+};
+
+// "[day][second] [City] TYPE: message", as notifications.txt has always
+// read. Returns the length written (less than cap), newline included.
+int renderEvent(const LogEvent& e, const EventDictionary& dict, char* out, int cap) {
+    LineWriter w(out, cap);
+    const char* type = e.type >= 0 && e.type < EVENT_TYPES ? EVENT_NAMES[e.type] : "?";
+    w << "[" << e.weekday() << "][" << e.second() << "] [" << dict.hub(e.city) << "] " << type << ": ";
+    const string& peer = dict.hub(e.peer);
+    switch(e.type) {
+    case EV_BOOKING:
+        w << "Customer booked parcel " << formatTrackingId(e.parcel) << " to " << peer;
+        break;
+    case EV_UNDO:
+        w << "Parcel " << formatTrackingId(e.parcel) << " cancelled by user.";
+        break;
+    case EV_LOST:
+        w << "Parcel " << formatTrackingId(e.parcel) << " lost in transit.";
+        break;
+    case EV_DISPATCH:
+        w << "Sent " << dict.vehicle(e.vehicle) << " to " << peer << " (Load: " << e.kg << "kg, " << e.parcels << " parcels";
+        if(e.extra) w << ", " << e.extra << " relaying";
+        w << "). Vehicle " << e.vehicleNo << " of " << e.vehicles << (e.reroute ? " [REROUTE]" : "");
+        break;
+    case EV_DEFER:
+        w << "Resource Shortage for " << peer << " (Req: " << e.kg << "kg, " << e.parcels << " parcels). Deferred.";
+        break;
+    case EV_FAILURE:
+        w << "Route blocked/unreachable to " << peer;
+        break;
+    case EV_ARRIVAL:
+        w << "Trip from " << peer << " Arrived (" << dict.vehicle(e.vehicle) << ")";
+        if(e.extra) w << ", " << e.extra << " parcels to relay";
+        break;
+    case EV_BLOCK:
+    case EV_UNBLOCK:
+        w << "Route to " << peer << (e.type == EV_BLOCK ? " closed" : " reopened") << " (" << e.extra << " route rows updated)";
+        break;
+    case EV_NEW_DAY:
+        w << "Day " << e.weekday() << " Started.";
+        break;
+    case EV_IMPORT:
+        w << "Booked " << e.parcels << " parcels from " << e.text << ".";
+        break;
+    case EV_CHECKPOINT:
+        w << "Snapshot of " << e.parcels << " parcels written in " << e.extra << " ms.";
+        break;
+    default:
+        w << "?";
+    }
+    *w.p++ = '\n';
+    *w.p = '\0';
+    return (int)(w.p - out);
+}
+
+// --- BINARY EVENT LOG (events.bin) ---
+// The same events stored by column, for offline queries (--query). After
+// EVENT_LOG_MAGIC come blocks of u32 kind, u32 payload bytes, payload:
+//   EVENT_DICT   u16 hubs, u16 vehicles, then each name as u8 length + bytes.
+//                Written at the start of every run; ids in the event blocks
+//                after it refer to it.
+//   EVENT_BLOCK  u32 events, i64 first and last tick, u32 mask of the types
+//                present (a query skips a block from these alone), then per
+//                column u8 codec + u32 bytes, then the columns.
+// Hubs, types and vehicles are dictionary ids. Each integer column is stored
+// in whichever codec is smallest for that block: zigzag varints of the
+// values or of their deltas, either one run-length encoded. Ticks, types,
+// hubs and the many zero fields shrink to a few bytes per run. The text
+// column holds only the events that have text (u32 count, then varint
+// index, u8 length, bytes).
+const char EVENT_LOG_FILE[] = "events.bin";
+const char EVENT_LOG_MAGIC[8] = {'S', 'W', 'X', 'E', 'V', 'T', '1', '\n'};
+const unsigned EVENT_DICT = 0x54434944;     // "DICT"
+const unsigned EVENT_BLOCK = 0x4b434c42;    // "BLCK"
+const int EVENT_BLOCK_EVENTS = 4096;
+const int EVENT_BLOCK_HEADER = 4 + 8 + 8 + 4;
+
+enum EventColumn {
+    COL_TICK, COL_TYPE, COL_CITY, COL_PEER, COL_VEHICLE, COL_PARCEL, COL_KG, COL_PARCELS,
+    COL_EXTRA, COL_VEHICLE_NO, COL_VEHICLES, COL_REROUTE, COL_TEXT, EVENT_COLUMNS
+};
+const int EVENT_INT_COLUMNS = COL_TEXT;
+enum ColumnCodec { CODEC_PLAIN = 0, CODEC_DELTA = 1, CODEC_RUNS = 2, CODEC_DELTA_RUNS = 3, CODEC_TEXT = 4 };
+
+static inline unsigned long long zigzag(long long v) { return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63); }
+static inline long long unzigzag(unsigned long long v) { return (long long)(v >> 1) ^ -(long long)(v & 1); }
+
+static inline int varintBytes(unsigned long long v) {
+    if(v < (1ULL << 7)) return 1;
+    if(v < (1ULL << 14)) return 2;
+    if(v < (1ULL << 21)) return 3;
+    int n = 4;
+    for(v >>= 28; v; v >>= 7) n++;
+    return n;
+}
+
+static inline unsigned char* putVarint(unsigned char* p, unsigned long long v) {
+    while(v >= 0x80) { *p++ = (unsigned char)(v | 0x80); v >>= 7; }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+// false past `end` or on an over-long varint
+static inline bool getVarint(const unsigned char*& p, const unsigned char* end, unsigned long long& v) {
+    v = 0;
+    for(int shift = 0; shift < 64 && p < end; shift += 7) {
+        unsigned char b = *p++;
+        v |= (unsigned long long)(b & 0x7f) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Size of `n` values in each integer codec, in one pass without encoding.
+// Varint sizes are only recomputed where the value or the step changes, so
+// the mostly constant columns cost a compare per value.
+static void codedSizes(const long long* v, int n, long long size[CODEC_DELTA_RUNS + 1]) {
+    for(int c = 0; c <= CODEC_DELTA_RUNS; c++) size[c] = 0;
+    if(n == 0) return;
+    long long prev = v[0], prevStep = v[0];         // The first step is from 0
+    int valueBytes = varintBytes(zigzag(prev)), stepBytes = valueBytes;
+    int run = 1, stepRun = 1;
+    size[CODEC_PLAIN] = size[CODEC_DELTA] = valueBytes;
+    for(int i = 1; i < n; i++) {
+        long long step = v[i] - prev;
+        // A run ends where the stored value (the value, or the step) changes
+        if(v[i] != prev) {
+            size[CODEC_RUNS] += varintBytes(run) + valueBytes;
+            run = 0;
+            valueBytes = varintBytes(zigzag(v[i]));
+            prev = v[i];
+        }
+        if(step != prevStep) {
+            size[CODEC_DELTA_RUNS] += varintBytes(stepRun) + stepBytes;
+            stepRun = 0;
+            stepBytes = varintBytes(zigzag(step));
+            prevStep = step;
+        }
+        size[CODEC_PLAIN] += valueBytes;
+        size[CODEC_DELTA] += stepBytes;
+        run++;
+        stepRun++;
+    }
+    size[CODEC_RUNS] += varintBytes(run) + valueBytes;
+    size[CODEC_DELTA_RUNS] += varintBytes(stepRun) + stepBytes;
+}
+
+// Returns the end of what it wrote
+static unsigned char* encodeValues(const long long* v, int n, int codec, unsigned char* p) {
+    long long prev = 0;
+    for(int i = 0; i < n; ) {
+        long long x = (codec & CODEC_DELTA) ? v[i] - prev : v[i];
+        int run = 1;
+        if(codec & CODEC_RUNS) {
+            while(i + run < n && ((codec & CODEC_DELTA) ? v[i + run] - v[i + run - 1] : v[i + run]) == x) run++;
+            p = putVarint(p, run);
+        }
+        p = putVarint(p, zigzag(x));
+        prev = v[i + run - 1];
+        i += run;
+    }
+    return p;
+}
+
+static bool decodeValues(const unsigned char* p, const unsigned char* end, int codec, int n, long long* out) {
+    long long prev = 0;
+    for(int i = 0; i < n; ) {
+        unsigned long long run = 1, raw;
+        if((codec & CODEC_RUNS) && !getVarint(p, end, run)) return false;
+        if(!getVarint(p, end, raw) || run == 0 || run > (unsigned long long)(n - i)) return false;
+        long long x = unzigzag(raw);
+        for(unsigned long long k = 0; k < run; k++) {
+            out[i] = (codec & CODEC_DELTA) ? prev + x : x;
+            prev = out[i++];
+        }
+    }
+    return p == end;
+}
+
+// Collects events column by column until a block is full. Encodes into a
+// buffer sized for the worst case, so the writer thread never reallocates.
+class EventBlockBuilder {
+    static const int MAX_BLOCK_BYTES = 8 + EVENT_BLOCK_HEADER + EVENT_COLUMNS * 5 +
+                                       EVENT_INT_COLUMNS * EVENT_BLOCK_EVENTS * 13 +     // Run and value varints
+                                       10 + EVENT_BLOCK_EVENTS * (3 + 1 + 255);          // Texts
+    long long* columns[EVENT_INT_COLUMNS];
+    unsigned char* encoded;
+    Vector<int> textIndex;
+    Vector<string> texts;
+    int count;
+    long long firstTick, lastTick;
+    unsigned typeMask;
+
+public:
+    EventBlockBuilder() {
+        for(int c = 0; c < EVENT_INT_COLUMNS; c++) columns[c] = new long long[EVENT_BLOCK_EVENTS];
+        encoded = new unsigned char[MAX_BLOCK_BYTES];
+        clear();
+    }
+    ~EventBlockBuilder() {
+        for(int c = 0; c < EVENT_INT_COLUMNS; c++) delete[] columns[c];
+        delete[] encoded;
+    }
+    EventBlockBuilder(const EventBlockBuilder&) = delete;
+    EventBlockBuilder& operator=(const EventBlockBuilder&) = delete;
+
+    void clear() {
+        count = 0;
+        typeMask = 0;
+        firstTick = lastTick = 0;
+        textIndex.clear();
+        texts.clear();
+    }
+
+    bool empty() const { return count == 0; }
+    bool full() const { return count == EVENT_BLOCK_EVENTS; }
+
+    void add(const LogEvent& e) {
+        if(count == 0) firstTick = e.tick;
+        lastTick = e.tick;
+        typeMask |= 1u << e.type;
+        columns[COL_TICK][count] = e.tick;
+        columns[COL_TYPE][count] = e.type;
+        columns[COL_CITY][count] = e.city;
+        columns[COL_PEER][count] = e.peer;
+        columns[COL_VEHICLE][count] = e.vehicle;
+        columns[COL_PARCEL][count] = (long long)e.parcel;
+        columns[COL_KG][count] = e.kg;
+        columns[COL_PARCELS][count] = e.parcels;
+        columns[COL_EXTRA][count] = e.extra;
+        columns[COL_VEHICLE_NO][count] = e.vehicleNo;
+        columns[COL_VEHICLES][count] = e.vehicles;
+        columns[COL_REROUTE][count] = e.reroute;
+        if(e.text[0]) { textIndex.push_back(count); texts.push_back(e.text); }
+        count++;
+    }
+
+    // The block, framing included, valid until the next encode; starts the next block
+    const unsigned char* encode(int& length) {
+        unsigned char* header = encoded;
+        unsigned char* start = encoded + 8 + EVENT_BLOCK_HEADER + EVENT_COLUMNS * 5;
+        unsigned char* p = start;
+        for(int c = 0; c < EVENT_INT_COLUMNS; c++) {
+            long long size[CODEC_DELTA_RUNS + 1];
+            codedSizes(columns[c], count, size);
+            int best = CODEC_PLAIN;
+            for(int codec = CODEC_DELTA; codec <= CODEC_DELTA_RUNS; codec++) if(size[codec] < size[best]) best = codec;
+            unsigned char* before = p;
+            p = encodeValues(columns[c], count, best, p);
+            header[32 + c * 5] = (unsigned char)best;
+            putLE(header + 33 + c * 5, p - before, 4);
+        }
+        unsigned char* before = p;
+        p = putVarint(p, texts.size());
+        for(int i = 0; i < texts.size(); i++) {
+            p = putVarint(p, textIndex[i]);
+            int n = texts[i].size() < 255 ? (int)texts[i].size() : 255;
+            *p++ = (unsigned char)n;
+            memcpy(p, texts[i].data(), n);
+            p += n;
+        }
+        header[32 + COL_TEXT * 5] = CODEC_TEXT;
+        putLE(header + 33 + COL_TEXT * 5, p - before, 4);
+
+        length = (int)(p - encoded);
+        putLE(header, EVENT_BLOCK, 4);
+        putLE(header + 4, length - 8, 4);
+        putLE(header + 8, count, 4);
+        putLE(header + 12, (unsigned long long)firstTick, 8);
+        putLE(header + 20, (unsigned long long)lastTick, 8);
+        putLE(header + 28, typeMask, 4);
+        clear();
+        return encoded;
+    }
+};
+
+void encodeDictionary(const EventDictionary& dict, Vector<unsigned char>& out) {
+    Vector<unsigned char> body;
+    body.push_back(dict.hubs.size() & 255); body.push_back(dict.hubs.size() >> 8 & 255);
+    body.push_back(dict.vehicles.size() & 255); body.push_back(dict.vehicles.size() >> 8 & 255);
+    for(int list = 0; list < 2; list++) {
+        const Vector<string>& names = list ? dict.vehicles : dict.hubs;
+        for(const string& name : names) {
+            int n = name.size() < 255 ? (int)name.size() : 255;
+            body.push_back((unsigned char)n);
+            for(int k = 0; k < n; k++) body.push_back((unsigned char)name[k]);
+        }
+    }
+    unsigned char header[8];
+    putLE(header, EVENT_DICT, 4);
+    putLE(header + 4, body.size(), 4);
+    for(unsigned char b : header) out.push_back(b);
+    for(unsigned char b : body) out.push_back(b);
+}
+
+bool decodeDictionary(const unsigned char* p, int n, EventDictionary& dict) {
+    const unsigned char* end = p + n;
+    if(n < 4) return false;
+    int hubs = p[0] | p[1] << 8, vehicles = p[2] | p[3] << 8;
+    p += 4;
+    dict.hubs.clear();
+    dict.vehicles.clear();
+    for(int i = 0; i < hubs + vehicles; i++) {
+        if(p >= end || p + 1 + *p > end) return false;
+        string name((const char*)p + 1, *p);
+        p += 1 + *p;
+        (i < hubs ? dict.hubs : dict.vehicles).push_back(name);
+    }
+    return true;
+}
+
+// Bytes of `path` that form whole blocks after a valid header; 0 if it is
+// not an event log. A crash can leave a torn block at the end.
+long long eventLogValidBytes(FILE* f) {
+    unsigned char header[8];
+    fseek(f, 0, SEEK_END);
+    long long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if(size < 8 || fread(header, 1, 8, f) != 8 || memcmp(header, EVENT_LOG_MAGIC, 8) != 0) return 0;
+    long long pos = 8;
+    while(size - pos >= 8) {
+        fseek(f, pos, SEEK_SET);
+        if(fread(header, 1, 8, f) != 8) break;
+        long long payload = (long long)getLE(header + 4, 4);
+        if(payload > size - pos - 8) break;
+        pos += 8 + payload;
+    }
+    return pos;
+}
+
+// Reads events.bin block by block; columns are decoded only when asked for
+class EventLogReader {
+    const unsigned char* data;
+    long long size, pos;
+    const unsigned char* block;     // Current event block's payload
+    long long* columns[EVENT_INT_COLUMNS];
+    bool decoded[EVENT_COLUMNS];
+    Vector<int> textIndex;
+    Vector<string> texts;
+    bool damaged;
+
+public:
+    EventDictionary dictionary;
+    int dictionaries;               // Read so far; ids change meaning with each
+    int count;                      // Events in the current block
+    long long firstTick, lastTick;
+    unsigned typeMask;
+
+    EventLogReader(const void* image, long long bytes) : data((const unsigned char*)image), size(bytes), pos(8), block(nullptr), damaged(false),
+                                                          dictionaries(0), count(0), firstTick(0), lastTick(0), typeMask(0) {
+        for(int c = 0; c < EVENT_INT_COLUMNS; c++) columns[c] = new long long[EVENT_BLOCK_EVENTS];
+    }
+    ~EventLogReader() { for(int c = 0; c < EVENT_INT_COLUMNS; c++) delete[] columns[c]; }
+    EventLogReader(const EventLogReader&) = delete;
+    EventLogReader& operator=(const EventLogReader&) = delete;
+
+    bool valid() const { return size >= 8 && memcmp(data, EVENT_LOG_MAGIC, 8) == 0; }
+    bool isDamaged() const { return damaged; }
+
+    // Next event block, reading any dictionary on the way
+    bool next() {
+        while(size - pos >= 8) {
+            unsigned kind = (unsigned)getLE(data + pos, 4);
+            long long payload = (long long)getLE(data + pos + 4, 4);
+            if(payload > size - pos - 8) { damaged = true; return false; }
+            const unsigned char* p = data + pos + 8;
+            pos += 8 + payload;
+            if(kind == EVENT_DICT) {
+                if(!decodeDictionary(p, (int)payload, dictionary)) { damaged = true; return false; }
+                dictionaries++;
+                continue;
+            }
+            if(kind != EVENT_BLOCK || payload < EVENT_BLOCK_HEADER + EVENT_COLUMNS * 5) { damaged = true; return false; }
+            count = (int)getLE(p, 4);
+            firstTick = (long long)getLE(p + 4, 8);
+            lastTick = (long long)getLE(p + 12, 8);
+            typeMask = (unsigned)getLE(p + 20, 4);
+            long long columnBytes = 0;
+            for(int c = 0; c < EVENT_COLUMNS; c++) columnBytes += getLE(p + 25 + c * 5, 4);
+            if(count < 0 || count > EVENT_BLOCK_EVENTS || EVENT_BLOCK_HEADER + EVENT_COLUMNS * 5 + columnBytes != payload) { damaged = true; return false; }
+            block = p;
+            for(int c = 0; c < EVENT_COLUMNS; c++) decoded[c] = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Column `c` of the current block; nullptr if it does not decode
+    const long long* column(int c) {
+        if(decoded[c]) return columns[c];
+        const unsigned char* p = block + EVENT_BLOCK_HEADER + EVENT_COLUMNS * 5;
+        for(int k = 0; k < c; k++) p += getLE(block + 25 + k * 5, 4);
+        const unsigned char* end = p + getLE(block + 25 + c * 5, 4);
+        if(block[24 + c * 5] > CODEC_DELTA_RUNS || !decodeValues(p, end, block[24 + c * 5], count, columns[c])) {
+            damaged = true;
+            return nullptr;
+        }
+        decoded[c] = true;
+        return columns[c];
+    }
+
+    // Text of event i of the current block, "" if it has none
+    string text(int i) {
+        if(!decoded[COL_TEXT]) {
+            textIndex.clear();
+            texts.clear();
+            const unsigned char* p = block + EVENT_BLOCK_HEADER + EVENT_COLUMNS * 5;
+            for(int k = 0; k < COL_TEXT; k++) p += getLE(block + 25 + k * 5, 4);
+            const unsigned char* end = p + getLE(block + 25 + COL_TEXT * 5, 4);
+            unsigned long long n = 0, index;
+            bool ok = getVarint(p, end, n);
+            for(unsigned long long k = 0; ok && k < n; k++) {
+                ok = getVarint(p, end, index) && p < end && p + 1 + *p <= end;
+                if(!ok) break;
+                textIndex.push_back((int)index);
+                texts.push_back(string((const char*)p + 1, *p));
+                p += 1 + *p;
+            }
+            if(!ok) damaged = true;
+            decoded[COL_TEXT] = true;
+        }
+        for(int k = 0; k < textIndex.size(); k++) if(textIndex[k] == i) return texts[k];
+        return "";
+    }
+
+    // Event i of the current block, every column decoded
+    bool event(int i, LogEvent& e) {
+        for(int c = 0; c < EVENT_INT_COLUMNS; c++) if(!column(c)) return false;
+        e.tick = columns[COL_TICK][i];
+        e.type = (int)columns[COL_TYPE][i];
+        e.city = (int)columns[COL_CITY][i];
+        e.peer = (int)columns[COL_PEER][i];
+        e.vehicle = (int)columns[COL_VEHICLE][i];
+        e.parcel = (TrackingKey)columns[COL_PARCEL][i];
+        e.kg = (int)columns[COL_KG][i];
+        e.parcels = (int)columns[COL_PARCELS][i];
+        e.extra = (int)columns[COL_EXTRA][i];
+        e.vehicleNo = (int)columns[COL_VEHICLE_NO][i];
+        e.vehicles = (int)columns[COL_VEHICLES][i];
+        e.reroute = (int)columns[COL_REROUTE][i];
+        string t = text(i);
+        snprintf(e.text, sizeof(e.text), "%s", t.c_str());
+        return true;
+    }
+};
+
+// --- ASYNC EVENT LOGGER ---
+// Engine threads push LogEvents into an MPSC ring and return at once. A
+// writer thread renders them into notifications.txt and files them into
+// events.bin, writing both in large batches and flushing at least every
+// flushIntervalMs (a partial event block is written at each flush). When
+// the ring is full the event is dropped and counted, never waited for.
+class AsyncLogger {
+    static const int MIN_RING_CAPACITY = 1 << 16;
+    static const int MAX_RING_CAPACITY = 1 << 20;
+    static const int BATCH_BYTES = 64 * 1024;
+
+    MpscRing<LogEvent> ring;
+    FILE* text;                     // notifications.txt
+    FILE* binary;                   // events.bin
+    EventDictionary dictionary;
+    atomic<int> flushIntervalMs;
+    atomic<long long> pushed, written, dropped, truncated, batches;
+    atomic<bool> stopping;
+    mutex wakeMutex;
+    condition_variable wakeCv;
+    thread writer;
+
+    // The biggest burst is a dispatch wave, one event per vehicle sent out,
+    // pushed back to back by the apply phase. Room for two whole fleets keeps
+    // it from dropping even when the writer has not run since the last one.
+    static int ringCapacity() {
+        long long fleet = 0;
+        for (int h = 0; h < network.hubCount; h++) fleet += network.bus300[h] + network.bus600[h] + network.truck2000[h];
+        int capacity = MIN_RING_CAPACITY;
+        while (capacity < MAX_RING_CAPACITY && capacity < 2 * fleet) capacity *= 2;
+        return capacity;
+    }
+
+    static bool copyField(char* dst, size_t cap, const char* src) {
+        size_t len = strlen(src);
+        size_t n = len < cap - 1 ? len : cap - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+        return n == len;
+    }
+
+    // Positioned after the last whole block, with this run's dictionary
+    FILE* openEventLog(const char* binaryPath, bool append) {
+        FILE* f = append ? fopen(binaryPath, "r+b") : nullptr;
+        long long valid = f ? eventLogValidBytes(f) : 0;
+        if(f && valid == 0) { fclose(f); f = nullptr; }
+        if(f) {
+            fflush(f);
+            truncateFile(f, valid);
+            fseek(f, 0, SEEK_END);
+        } else {
+            f = fopen(binaryPath, "wb");
+            if(!f) return nullptr;
+            fwrite(EVENT_LOG_MAGIC, 1, 8, f);
+        }
+        Vector<unsigned char> dict;
+        encodeDictionary(dictionary, dict);
+        fwrite(dict.begin(), 1, dict.size(), f);
+        return f;
+    }
+
+    void writerLoop() {
+        FILE* f = text;
+        FILE* bin = binary;
+        char* buffer = new char[BATCH_BYTES];
+        size_t used = 0;
+        EventBlockBuilder* block = new EventBlockBuilder();
+        int length;
+        chrono::steady_clock::time_point lastFlush = chrono::steady_clock::now();
+        LogEvent e;
+        while (true) {
+            bool stop = stopping.load();
+            long long count = 0;
+            while (ring.pop(e)) {
+                if (used + 1024 >= (size_t)BATCH_BYTES) {
+                    // May not fit: write the batch first
+                    if (f) fwrite(buffer, 1, used, f);
+                    batches++;
+                    used = 0;
+                }
+                used += renderEvent(e, dictionary, buffer + used, BATCH_BYTES - used);
+                block->add(e);
+                if (block->full()) {
+                    const unsigned char* bytes = block->encode(length);
+                    if (bin) fwrite(bytes, 1, length, bin);
+                }
+                count++;
+            }
+            written += count;
+
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            bool due = now - lastFlush >= chrono::milliseconds(flushIntervalMs.load());
+            if ((used > 0 || !block->empty()) && (due || stop)) {
+                if (f) { fwrite(buffer, 1, used, f); fflush(f); }
+                if (!block->empty()) {
+                    const unsigned char* bytes = block->encode(length);
+                    if (bin) fwrite(bytes, 1, length, bin);
+                }
+                if (bin) fflush(bin);
+                batches++;
+                used = 0;
+                lastFlush = now;
+            }
+            if (stop) break;
+
+            unique_lock<mutex> lock(wakeMutex);
+            wakeCv.wait_for(lock, chrono::milliseconds(flushIntervalMs.load()));
+        }
+        delete block;
+        delete[] buffer;
+        if (f) fclose(f);
+        if (bin) fclose(bin);
+    }
+
+public:
+    // `keepLog`: append to the files of an earlier run (--durable restart).
+    // The files are opened (or emptied, which takes a while for a big log)
+    // here, before anything can be logged.
+    AsyncLogger(const char* file, const char* binaryFile, bool keepLog, int flushMs = 200) : ring(ringCapacity()) {
+        dictionary.fromNetwork();
+        text = fopen(file, keepLog ? "a" : "w");
+        binary = openEventLog(binaryFile, keepLog);
+        flushIntervalMs = flushMs > 0 ? flushMs : 1;
+        pushed = written = dropped = truncated = batches = 0;
+        stopping = false;
+        writer = thread(&AsyncLogger::writerLoop, this);
+    }
+
+    // Drains everything still queued before returning
+    ~AsyncLogger() {
+        stopping = true;
+        wakeCv.notify_one();
+        writer.join();
+    }
+
+    void setFlushInterval(int ms) { flushIntervalMs = ms > 0 ? ms : 1; }
+
+    // `text` only for the events that carry one (IMPORT)
+    void log(const LogEvent& event, const char* text = nullptr) {
+        bool cut = false;
+        bool ok = ring.push([&](LogEvent& e) {
+            e = event;
+            if (text) cut = !copyField(e.text, sizeof(e.text), text);
+        });
+        if (!ok) { dropped++; return; }
+        pushed++;
+        if (cut) truncated++;
+        // Wake the writer early once the ring is half full
+        if (ring.sizeHint() >= ring.capacity() / 2) wakeCv.notify_one();
+    }
+
+    long long eventsWritten() const { return written.load(); }
+    long long eventsDropped() const { return dropped.load(); }
+    long long eventsTruncated() const { return truncated.load(); }
+    long long batchesWritten() const { return batches.load(); }
+    long long backlog() const { return pushed.load() - written.load(); }
+};
+
+// --- SHARED STATE SNAPSHOT (state.snap) ---
+// Layout, MappedFile and the seqlock writer/reader are in snapshot.h
+static_assert(SNAPSHOT_STATUSES == STATUS_COUNT, "snapshot city rows hold one count per ParcelStatus");
+
+// --- BULK MANIFEST READER ---
+// Partner manifests are streamed through a 1 MB buffer, never loaded whole.
+// CSV rows ("src,srcOffice,dest,destOffice,weight,priority"; hubs and offices
+// by id or name, '#' comments, optional header line) are split and checked
+// in place in the buffer, so a row costs no allocation. A file starting with
+// MANIFEST_MAGIC holds fixed 12-byte little-endian records instead:
+// u16 src, u16 dest, u8 srcOffice, u8 destOffice, u8 priority, u8 unused,
+// i32 weight.
+const char MANIFEST_MAGIC[8] = {'S', 'W', 'X', 'M', 'A', 'N', '1', '\n'};
+const int MANIFEST_RECORD_BYTES = 12;
+
+enum ManifestReject {
+    REJECT_SYNTAX,          // Field count, non-number, over-long line, truncated record
+    REJECT_HUB,
+    REJECT_OFFICE,
+    REJECT_WEIGHT,
+    REJECT_PRIORITY,
+    REJECT_SAME_OFFICE,
+    REJECT_STORE_FULL,      // Filed by the importer when the engine refuses a row
+    REJECT_REASONS
+};
+const char* REJECT_NAMES[REJECT_REASONS] = {"Bad syntax", "Unknown hub", "Bad office", "Bad weight", "Bad priority", "Same office", "Store full"};
+
+struct ManifestRow {
+    int src, srcOffice, dest, destOffice, weight, priority;
+    long long line;         // CSV line or binary record number, from 1
+};
+
+// Checks a booking against the network; shared by the manifest reader, the
+// customer panel and the socket server
+bool validBooking(const ManifestRow& row, ManifestReject& reason) {
+    int offices = network.officeNames.size();
+    if(row.src < 0 || row.src >= network.hubCount || row.dest < 0 || row.dest >= network.hubCount) reason = REJECT_HUB;
+    else if(row.srcOffice < 0 || row.srcOffice >= offices || row.destOffice < 0 || row.destOffice >= offices) reason = REJECT_OFFICE;
+    else if(row.weight <= 0) reason = REJECT_WEIGHT;
+    else if(row.priority < 1 || row.priority > 3) reason = REJECT_PRIORITY;
+    else if(row.src == row.dest && row.srcOffice == row.destOffice) reason = REJECT_SAME_OFFICE;
+    else return true;
+    return false;
+}
+
+// The 12-byte binary manifest record, also the body of a socket booking
+void decodeBookingRecord(const unsigned char* r, ManifestRow& row) {
+    row.src = r[0] | r[1] << 8;
+    row.dest = r[2] | r[3] << 8;
+    row.srcOffice = r[4];
+    row.destOffice = r[5];
+    row.priority = r[6];
+    row.weight = (int)((unsigned)r[8] | (unsigned)r[9] << 8 | (unsigned)r[10] << 16 | (unsigned)r[11] << 24);
+}
+
+void encodeBookingRecord(const ManifestRow& row, unsigned char* r) {
+    r[0] = row.src & 255; r[1] = row.src >> 8 & 255;
+    r[2] = row.dest & 255; r[3] = row.dest >> 8 & 255;
+    r[4] = row.srcOffice; r[5] = row.destOffice;
+    r[6] = row.priority; r[7] = 0;
+    for(int i = 0; i < 4; i++) r[8 + i] = (unsigned)row.weight >> (8 * i) & 255;
+}
+
+class ManifestReader {
+    static const int CHUNK = 1 << 20;
+    static const int FIELDS = 6;
+
+    FILE* file;
+    char* buf;
+    int start, end;         // Unparsed bytes are buf[start, end)
+    bool eof;
+    bool binary;
+    bool skipping;          // Inside a line longer than the buffer
+    bool headerChecked;
+    long long line;
+    Vector<int> nameSlots;  // Hub name hash -> hub id, -1 = empty
+    int nameMask;
+
+    static unsigned hashName(const char* s, int len) {
+        unsigned h = 2166136261u;                     // FNV-1a
+        for(int i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+        return h;
+    }
+
+    void buildNameIndex() {
+        int size = 16;
+        while(size < 2 * network.hubCount) size *= 2;
+        nameSlots.assign(size, -1);
+        nameMask = size - 1;
+        for(int i = 0; i < network.hubCount; i++) {
+            const string& n = network.hubNames[i];
+            unsigned s = hashName(n.data(), n.size()) & nameMask;
+            while(nameSlots[s] >= 0) s = (s + 1) & nameMask;
+            nameSlots[s] = i;
+        }
+    }
+
+    static bool sameName(const string& name, const char* s, int len) {
+        return (int)name.size() == len && memcmp(name.data(), s, len) == 0;
+    }
+
+    int findHub(const char* s, int len) {
+        for(unsigned k = hashName(s, len) & nameMask; nameSlots[k] >= 0; k = (k + 1) & nameMask)
+            if(sameName(network.hubNames[nameSlots[k]], s, len)) return nameSlots[k];
+        return -1;
+    }
+
+    // Decimal with optional sign; false on anything else. Values too big for
+    // an int come back as LLONG_MAX so range checks still reject them.
+    static bool parseNumber(const char* s, int len, long long& v) {
+        int i = 0;
+        bool negative = len > 0 && s[0] == '-';
+        if(negative || (len > 0 && s[0] == '+')) i++;
+        if(i == len) return false;
+        v = 0;
+        for(; i < len; i++) {
+            if(s[i] < '0' || s[i] > '9') return false;
+            if(v < INT_MAX) v = v * 10 + (s[i] - '0');
+        }
+        if(v > INT_MAX) v = LLONG_MAX;
+        else if(negative) v = -v;
+        return true;
+    }
+
+    // Hub id or name; -1 if neither (rejected by validBooking)
+    int parseHub(const char* s, int len) {
+        long long v;
+        if(parseNumber(s, len, v)) return v >= 0 && v < network.hubCount ? (int)v : -1;
+        return findHub(s, len);
+    }
+
+    // Office id or name; -1 if neither
+    static int parseOffice(const char* s, int len) {
+        long long v;
+        int offices = network.officeNames.size();
+        if(parseNumber(s, len, v)) return v >= 0 && v < offices ? (int)v : -1;
+        for(int i = 0; i < offices; i++)
+            if(sameName(network.officeNames[i], s, len)) return i;
+        return -1;
+    }
+
+    bool fill() {
+        if(eof) return false;
+        if(start > 0) {
+            memmove(buf, buf + start, end - start);
+            end -= start;
+            start = 0;
+        }
+        size_t got = fread(buf + end, 1, CHUNK - end, file);
+        end += (int)got;
+        bytesRead += got;
+        if(got == 0) eof = true;
+        return got > 0;
+    }
+
+    // Column titles: a first row with no number in any field. A first row
+    // with only a bad weight or priority is a data row and gets rejected.
+    static bool isHeader(const char* const* field, const int* length, int n, bool extra) {
+        if(n != FIELDS || extra) return false;
+        long long v;
+        for(int i = 0; i < n; i++) if(parseNumber(field[i], length[i], v)) return false;
+        return true;
+    }
+
+    // Checks one CSV line buf[p, q); false if it was not a data row
+    bool parseLine(char* p, char* q, ManifestRow& row) {
+        if(q > p && q[-1] == '\r') q--;
+        while(p < q && (*p == ' ' || *p == '\t')) p++;
+        if(p == q || *p == '#') return false;
+
+        const char* field[FIELDS];
+        int length[FIELDS];
+        int n = 0;
+        bool extra = false;
+        for(char* f = p; ; ) {
+            char* comma = (char*)memchr(f, ',', q - f);
+            char* e = comma ? comma : q;
+            char* b = f;
+            while(b < e && (*b == ' ' || *b == '\t')) b++;
+            while(e > b && (e[-1] == ' ' || e[-1] == '\t')) e--;
+            if(e - b >= 2 && *b == '"' && e[-1] == '"') { b++; e--; }
+            if(n < FIELDS) { field[n] = b; length[n] = e - b; n++; }
+            else extra = true;
+            if(!comma) break;
+            f = comma + 1;
+        }
+
+        if(!headerChecked) {
+            headerChecked = true;
+            if(isHeader(field, length, n, extra)) return false;
+        }
+
+        long long weight, priority;
+        rows++;
+        row.line = line;
+        if(n != FIELDS || extra || !parseNumber(field[4], length[4], weight) || !parseNumber(field[5], length[5], priority)) return fail(REJECT_SYNTAX);
+        row.src = parseHub(field[0], length[0]);
+        row.dest = parseHub(field[2], length[2]);
+        row.srcOffice = parseOffice(field[1], length[1]);
+        row.destOffice = parseOffice(field[3], length[3]);
+        row.weight = (int)min(weight, (long long)INT_MAX);
+        row.priority = (int)min(priority, (long long)INT_MAX);
+        return check(row);
+    }
+
+    bool parseRecord(const unsigned char* r, ManifestRow& row) {
+        rows++;
+        row.line = line;
+        decodeBookingRecord(r, row);
+        return check(row);
+    }
+
+    bool check(const ManifestRow& row) {
+        ManifestReject reason;
+        return validBooking(row, reason) || fail(reason);
+    }
+
+    bool fail(ManifestReject reason) {
+        reject(line, reason);
+        return false;
+    }
+
+public:
+    static const int MAX_SAMPLES = 8;
+    struct Sample {
+        long long line;
+        ManifestReject reason;
+    };
+
+    long long rows;                         // Data rows seen, valid or not
+    long long bytesRead;
+    long long rejected[REJECT_REASONS];
+    Sample samples[MAX_SAMPLES];            // First few rejected rows
+    int sampleCount;
+
+    ManifestReader() : file(nullptr), buf(nullptr), start(0), end(0), eof(false), binary(false),
+                       skipping(false), headerChecked(false), line(0), nameMask(0),
+                       rows(0), bytesRead(0), sampleCount(0) {
+        for(int i = 0; i < REJECT_REASONS; i++) rejected[i] = 0;
+    }
+
+    ~ManifestReader() {
+        if(file) fclose(file);
+        delete[] buf;
+    }
+
+    ManifestReader(const ManifestReader&) = delete;
+    ManifestReader& operator=(const ManifestReader&) = delete;
+
+    bool open(const char* path, string& error) {
+        file = fopen(path, "rb");
+        if(!file) { error = "cannot open " + string(path); return false; }
+        buf = new char[CHUNK];
+        fill();
+        binary = end >= (int)sizeof(MANIFEST_MAGIC) && memcmp(buf, MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) == 0;
+        if(binary) start = sizeof(MANIFEST_MAGIC);
+        else buildNameIndex();
+        return true;
+    }
+
+    bool isBinary() const { return binary; }
+
+    long long rejectedRows() const {
+        long long total = 0;
+        for(int i = 0; i < REJECT_REASONS; i++) total += rejected[i];
+        return total;
+    }
+
+    void reject(long long at, ManifestReject reason) {
+        rejected[reason]++;
+        if(sampleCount < MAX_SAMPLES) samples[sampleCount++] = {at, reason};
+    }
+
+    // Fills `out` with up to `max` valid rows; returns 0 at end of file
+    int next(ManifestRow* out, int max) {
+        int n = 0;
+        while(n < max) {
+            if(binary) {
+                if(end - start < MANIFEST_RECORD_BYTES && !fill()) {
+                    if(end > start) { line++; rows++; fail(REJECT_SYNTAX); start = end; }   // Truncated record
+                    break;
+                }
+                while(n < max && end - start >= MANIFEST_RECORD_BYTES) {
+                    line++;
+                    if(parseRecord((const unsigned char*)buf + start, out[n])) n++;
+                    start += MANIFEST_RECORD_BYTES;
+                }
+                continue;
+            }
+
+            char* nl = (char*)memchr(buf + start, '\n', end - start);
+            if(!nl) {
+                if(end - start == CHUNK) {          // No room left to finish the line
+                    if(!skipping) { line++; rows++; fail(REJECT_SYNTAX); }
+                    skipping = true;
+                    start = end;
+                }
+                if(fill()) continue;
+                if(end == start) break;
+                nl = buf + end;                     // Last line without a newline
+            }
+            if(skipping) skipping = false;
+            else {
+                line++;
+                if(parseLine(buf + start, nl, out[n])) n++;
+            }
+            start = nl < buf + end ? (int)(nl - buf) + 1 : end;
+        }
+        return n;
+    }
+};
+
+// --- CUSTOMER DESK ---
+// Everything a customer can do: book, track, cancel. The engine answers
+// these itself; RemoteDesk forwards them to a --serve process. The panel
+// only sees this interface, so it is the same program in-process or remote.
+enum DeskResult {
+    DESK_OK,
+    DESK_NOT_FOUND,
+    DESK_REJECTED,          // Booking refused, reason is a ManifestReject
+    DESK_NOT_CANCELLABLE,   // Already past BOOKED
+    DESK_BAD_REQUEST,       // Unknown op or wrong body size on the socket
+    DESK_UNREACHABLE,       // RemoteDesk lost its server
+    DESK_BUSY               // Engine-internal: dataMutex taken, try again
+};
+
+class CustomerDesk {
+public:
+    virtual ~CustomerDesk() {}
+    virtual DeskResult book(const ManifestRow& row, TrackingKey& key, ManifestReject& reason) = 0;
+    // `now` is the simulation second the record was current at
+    virtual DeskResult track(TrackingKey key, TrackingRecord& rec, long long& now) = 0;
+    // `status` is the parcel's status afterwards
+    virtual DeskResult cancel(TrackingKey key, ParcelStatus& status) = 0;
+};
+
+// --- CUSTOMER SOCKET PROTOCOL ---
+// Little-endian frames on a Unix stream socket. Request: u8 op, u8 body
+// length, u32 tag, body. Answer: u8 DeskResult, u8 body length, the same
+// tag, body. Answers come back in request order, so a client may pipeline
+// any number of requests; the tag is only a check.
+//   OP_BOOK    body: the 12-byte manifest record
+//              OK: u64 key; REJECTED: u8 ManifestReject
+//   OP_TRACK   body: u64 key     OK: TRACK_BODY_BYTES, see encodeTracking
+//   OP_CANCEL  body: u64 key     OK / NOT_CANCELLABLE: u8 ParcelStatus
+const char DESK_SOCKET_FILE[] = "swiftex.sock";
+const int FRAME_HEADER_BYTES = 6;
+const int KEY_BODY_BYTES = 8;
+const int TRACK_BODY_BYTES = 48;
+
+enum DeskOp {
+    OP_BOOK = 1,
+    OP_TRACK = 2,
+    OP_CANCEL = 3
+};
+
+void putFrameHeader(unsigned char* p, int code, int bodyLength, unsigned tag) {
+    p[0] = (unsigned char)code;
+    p[1] = (unsigned char)bodyLength;
+    putLE(p + 2, tag, 4);
+}
+
+void encodeTracking(const TrackingRecord& rec, long long now, unsigned char* b) {
+    putLE(b, rec.key, 8);
+    putLE(b + 8, rec.srcCity, 2);
+    putLE(b + 10, rec.destCity, 2);
+    b[12] = (unsigned char)rec.srcOffice;
+    b[13] = (unsigned char)rec.destOffice;
+    b[14] = (unsigned char)rec.status;
+    b[15] = 0;
+    putLE(b + 16, rec.legCount, 2);
+    putLE(b + 18, rec.atHub, 2);
+    putLE(b + 20, rec.legTo, 2);
+    putLE(b + 22, 0, 2);
+    putLE(b + 24, (unsigned)rec.legDistance, 4);
+    putLE(b + 28, (unsigned)rec.totalRouteDistance, 4);
+    putLE(b + 32, (unsigned long long)rec.dispatchTime, 8);
+    putLE(b + 40, (unsigned long long)now, 8);
+}
+
+void decodeTracking(const unsigned char* b, TrackingRecord& rec, long long& now) {
+    rec.key = getLE(b, 8);
+    rec.srcCity = (int)getLE(b + 8, 2);
+    rec.destCity = (int)getLE(b + 10, 2);
+    rec.srcOffice = b[12];
+    rec.destOffice = b[13];
+    rec.status = (ParcelStatus)b[14];
+    rec.legCount = (int)getLE(b + 16, 2);
+    rec.atHub = (int)getLE(b + 18, 2);
+    rec.legTo = (int)getLE(b + 20, 2);
+    rec.legDistance = (int)(unsigned)getLE(b + 24, 4);
+    rec.totalRouteDistance = (int)(unsigned)getLE(b + 28, 4);
+    rec.dispatchTime = (long long)getLE(b + 32, 8);
+    now = (long long)getLE(b + 40, 8);
+}
+
+// --- WRITE-AHEAD LOG (recovery.wal) ---
+// With --durable, every change that cannot be recomputed on restart is
+// appended here: bookings, cancellations, the trips of each dispatch wave,
+// each tick's arrivals with the parcels lost, and road block changes. A
+// restart maps the latest recovery.snap and replays only the records after
+// it. File: 16-byte header (WAL_MAGIC, u64 generation), then records of
+// u32 payload length, u8 WalRecordType, payload, u32 FNV-1a of type and
+// payload. Payloads are little-endian and start with the u64 sim second.
+// Replay stops at the first torn or damaged record and cuts the file there.
+//
+// Group commit: appends only copy into a memory buffer. A writer thread
+// writes whatever has accumulated and syncs once, so every record appended
+// while one sync runs shares the next. Customer answers wait for durable().
+const char RECOVERY_SNAP_FILE[] = "recovery.snap";
+const char RECOVERY_WAL_FILE[] = "recovery.wal";
+const char WAL_MAGIC[8] = {'S', 'W', 'X', 'W', 'A', 'L', '2', '\n'};
+const int WAL_HEADER_BYTES = 16;
+const int WAL_FRAME_BYTES = 9;              // Length, type and checksum
+
+enum WalRecordType {
+    WAL_BOOK = 1,       // u64 key, the 12-byte manifest record; handle = next in the store
+    WAL_CANCEL,         // u32 handle
+    WAL_BLOCKS,         // u64 blocks.txt offset, u32 n, n x (u32 u, u32 v, u64 liftDay): all active blocks
+    WAL_ARRIVE,         // u32 n, n x u32 handle lost, in arrival order
+    WAL_DISPATCH        // u32 trips, per trip: u32 src, dest, km, u8 name length, name, u32 n, n x u32 handle
+};
+
+unsigned walChecksum(const unsigned char* p, int n, unsigned h = 2166136261u) {
+    for(int i = 0; i < n; i++) h = (h ^ p[i]) * 16777619u;     // FNV-1a
+    return h;
+}
+
+// Payload being built; reused, so steady-state appends do not allocate
+class WalRecord {
+    unsigned char* bytes;
+    int length, capacity;
+
+public:
+    WalRecord() : bytes(new unsigned char[256]), length(0), capacity(256) {}
+    ~WalRecord() { delete[] bytes; }
+    WalRecord(const WalRecord&) = delete;
+    WalRecord& operator=(const WalRecord&) = delete;
+
+    void clear() { length = 0; }
+
+    unsigned char* extend(int n) {
+        if(length + n > capacity) {
+            while(capacity < length + n) capacity *= 2;
+            unsigned char* grown = new unsigned char[capacity];
+            memcpy(grown, bytes, length);
+            delete[] bytes;
+            bytes = grown;
+        }
+        length += n;
+        return bytes + length - n;
+    }
+
+    void put(unsigned long long v, int n) { putLE(extend(n), v, n); }
+
+    const unsigned char* data() const { return bytes; }
+    int size() const { return length; }
+};
+
+// Reads a payload back; any read past the end clears ok
+struct WalCursor {
+    const unsigned char* p;
+    int left;
+    bool ok;
+
+    WalCursor(const unsigned char* payload, int n) : p(payload), left(n), ok(true) {}
+
+    unsigned long long get(int n) {
+        if(n > left) { ok = false; left = 0; return 0; }
+        unsigned long long v = getLE(p, n);
+        p += n;
+        left -= n;
+        return v;
+    }
+
+    const unsigned char* skip(int n) {
+        if(n > left) { ok = false; left = 0; return nullptr; }
+        p += n;
+        left -= n;
+        return p - n;
+    }
+};
+
+class WriteAheadLog {
+    FILE* file;
+    string path;
+    unsigned long long gen;
+    unsigned long long fileStart;   // Position of the file's first byte: positions never go back
+    unsigned char* pending;         // Appended, not yet handed to the writer
+    size_t pendingLength, pendingCapacity;
+    unsigned char* writing;         // The writer's batch
+    size_t writingCapacity;
+    unsigned long long appended;    // Position after the last appended record
+    atomic<unsigned long long> synced;     // ... and after the last synced one
+    long long syncs;
+    bool stopping;
+    bool failed;
+    mutex walMutex;
+    condition_variable work, done;
+    thread writer;
+
+    void writeHeader() {
+        unsigned char header[WAL_HEADER_BYTES];
+        memcpy(header, WAL_MAGIC, 8);
+        putLE(header + 8, gen, 8);
+        fwrite(header, 1, WAL_HEADER_BYTES, file);
+        syncFile(file);
+    }
+
+    void writerLoop() {
+        unique_lock<mutex> lock(walMutex);
+        while(true) {
+            work.wait(lock, [this] { return pendingLength > 0 || stopping; });
+            if(pendingLength == 0) break;
+            unsigned char* batch = pending;
+            size_t batchLength = pendingLength, batchCapacity = pendingCapacity;
+            pending = writing;
+            pendingCapacity = writingCapacity;
+            writing = batch;
+            writingCapacity = batchCapacity;
+            pendingLength = 0;
+            unsigned long long upTo = appended;
+            lock.unlock();
+            bool ok = file && fwrite(batch, 1, batchLength, file) == batchLength;
+            if(file) syncFile(file);
+            ok = ok && !ferror(file);
+            lock.lock();
+            if(!ok && !failed) {
+                failed = true;
+                cout << Color::RED << "[!] Cannot write " << RECOVERY_WAL_FILE << "; changes from now on will not survive a crash." << Color::RESET << endl;
+            }
+            syncs++;
+            synced.store(upTo, memory_order_release);
+            done.notify_all();
+        }
+    }
+
+public:
+    WriteAheadLog() : file(nullptr), gen(0), fileStart(0), pendingLength(0), pendingCapacity(1 << 16),
+                      writingCapacity(1 << 16), appended(0), syncs(0), stopping(false), failed(false) {
+        pending = new unsigned char[pendingCapacity];
+        writing = new unsigned char[writingCapacity];
+        synced = 0;
+    }
+
+    // Syncs everything appended
+    ~WriteAheadLog() {
+        if(writer.joinable()) {
+            { lock_guard<mutex> lock(walMutex); stopping = true; }
+            work.notify_one();
+            writer.join();
+        }
+        if(file) fclose(file);
+        delete[] pending;
+        delete[] writing;
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Appends after the first `validBytes` of the file (what replay accepted);
+    // fewer than a header's worth starts a new file of `generation`
+    bool open(const char* walPath, unsigned long long generation, long long validBytes) {
+        path = walPath;
+        gen = generation;
+        if(validBytes < WAL_HEADER_BYTES) {
+            file = fopen(walPath, "w+b");       // rotate() reads the tail back
+            if(!file) return false;
+            writeHeader();
+            validBytes = WAL_HEADER_BYTES;
+        } else {
+            file = fopen(walPath, "r+b");
+            if(!file) return false;
+            if(!truncateFile(file, validBytes)) { fclose(file); file = nullptr; return false; }
+            fseek(file, 0, SEEK_END);
+        }
+        appended = validBytes;
+        synced = validBytes;
+        writer = thread(&WriteAheadLog::writerLoop, this);
+        return true;
+    }
+
+    // Returns the position the record ends at, for waitDurable
+    unsigned long long append(WalRecordType type, const unsigned char* payload, int n) {
+        lock_guard<mutex> lock(walMutex);
+        size_t need = pendingLength + WAL_FRAME_BYTES + n;
+        if(need > pendingCapacity) {
+            while(pendingCapacity < need) pendingCapacity *= 2;
+            unsigned char* grown = new unsigned char[pendingCapacity];
+            memcpy(grown, pending, pendingLength);
+            delete[] pending;
+            pending = grown;
+        }
+        unsigned char* p = pending + pendingLength;
+        unsigned char typeByte = (unsigned char)type;
+        putLE(p, (unsigned)n, 4);
+        p[4] = typeByte;
+        memcpy(p + 5, payload, n);
+        putLE(p + 5 + n, walChecksum(payload, n, walChecksum(&typeByte, 1)), 4);
+        bool idle = pendingLength == 0;
+        pendingLength = need;
+        appended += WAL_FRAME_BYTES + n;
+        if(idle) work.notify_one();
+        return appended;
+    }
+
+    unsigned long long end() {
+        lock_guard<mutex> lock(walMutex);
+        return appended;
+    }
+
+    bool durable(unsigned long long position) const { return synced.load(memory_order_acquire) >= position; }
+
+    void waitDurable(unsigned long long position) {
+        if(durable(position)) return;
+        unique_lock<mutex> lock(walMutex);
+        done.wait(lock, [&] { return synced.load(memory_order_relaxed) >= position; });
+    }
+
+    // After a snapshot has made the records before position `from`
+    // redundant: starts a file of the snapshot's generation holding only the
+    // records appended since, and renames it over the old one. Until then a
+    // restart finds the old file and replays it from the snapshot's cut.
+    // Appends wait meanwhile; there are only the few taken while the
+    // snapshot was being written to copy.
+    void rotate(unsigned long long generation, unsigned long long from) {
+        unique_lock<mutex> lock(walMutex);
+        done.wait(lock, [this] { return synced.load(memory_order_relaxed) == appended; });
+        size_t tail = (size_t)(appended - from);
+        unsigned char* kept = new unsigned char[tail > 0 ? tail : 1];
+        fflush(file);
+        bool ok = fseek(file, (long)(from - fileStart), SEEK_SET) == 0 && fread(kept, 1, tail, file) == tail;
+        clearerr(file);
+        string tempPath = path + ".tmp";
+        FILE* fresh = ok ? fopen(tempPath.c_str(), "wb") : nullptr;
+        if(fresh) {
+            FILE* old = file;
+            unsigned long long oldGen = gen;
+            file = fresh;
+            gen = generation;
+            writeHeader();
+            ok = fwrite(kept, 1, tail, fresh) == tail;
+            syncFile(fresh);
+            ok = ok && !ferror(fresh);
+            fclose(fresh);
+            fclose(old);
+            ok = ok && replaceFile(tempPath, path);
+            if(ok) fileStart = from - WAL_HEADER_BYTES;
+            else { gen = oldGen; remove(tempPath.c_str()); }
+            file = fopen(path.c_str(), "r+b");
+        }
+        delete[] kept;
+        if(file) fseek(file, 0, SEEK_END);
+        else {
+            failed = true;
+            cout << Color::RED << "[!] Cannot reopen " << RECOVERY_WAL_FILE << "; changes from now on will not survive a crash." << Color::RESET << endl;
+        }
+        if(file && !ok) cout << Color::RED << "[!] Cannot start a new " << RECOVERY_WAL_FILE << "; it keeps the records the snapshot already has." << Color::RESET << endl;
+    }
+
+    // Where position `p` lies in the current file
+    unsigned long long fileOffset(unsigned long long p) const { return p - fileStart; }
+
+    unsigned long long generation() const { return gen; }
+    long long syncCount() { lock_guard<mutex> lock(walMutex); return syncs; }
+
+    // Calls apply(type, cursor) for each intact record of a file of
+    // `generation`, until apply returns false. A file still of the previous
+    // generation (the snapshot was committed, the rotation was not) is
+    // replayed from `cut`, the snapshot's offset into it. Returns the bytes
+    // to keep, 0 if there is no such file, and sets `start` to where replay
+    // began.
+    template <typename F>
+    static long long replay(const char* path, unsigned long long generation, unsigned long long cut,
+                            long long& start, long long& records, F apply) {
+        records = 0;
+        start = WAL_HEADER_BYTES;
+        FILE* in = fopen(path, "rb");
+        if(!in) return 0;
+        fseek(in, 0, SEEK_END);
+        long long size = ftell(in);
+        fseek(in, 0, SEEK_SET);
+        unsigned char* image = new unsigned char[size > 0 ? size : 1];
+        bool ok = size >= WAL_HEADER_BYTES && fread(image, 1, size, in) == (size_t)size;
+        fclose(in);
+        long long keep = 0;
+        ok = ok && memcmp(image, WAL_MAGIC, 8) == 0;
+        unsigned long long fileGen = ok ? getLE(image + 8, 8) : 0;
+        if(ok && fileGen + 1 == generation && cut >= (unsigned long long)WAL_HEADER_BYTES && cut <= (unsigned long long)size) start = (long long)cut;
+        else ok = ok && fileGen == generation;
+        if(ok) {
+            keep = start;
+            while(size - keep >= WAL_FRAME_BYTES) {
+                const unsigned char* r = image + keep;
+                long long n = (long long)getLE(r, 4);
+                if(n > size - keep - WAL_FRAME_BYTES) break;                 // Torn
+                if(getLE(r + 5 + n, 4) != walChecksum(r + 5, (int)n, walChecksum(r + 4, 1))) break;
+                WalCursor cursor(r + 5, (int)n);
+                if(!apply((WalRecordType)r[4], cursor)) break;
+                keep += WAL_FRAME_BYTES + n;
+                records++;
+            }
+        }
+        delete[] image;
+        return keep;
+    }
+};
+
+// --- ENGINE METRICS (metrics.prom) ---
+// Latency histograms for each phase of the tick and for dataMutex, plus
+// per-tick counts, written every second in the Prometheus text format to
+// metrics.prom for a local scraper or the admin panel (menu option 4).
+const char METRICS_FILE[] = "metrics.prom";
+
+static long long steadyNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Log-linear buckets as in HdrHistogram: values below 32 are exact; above,
+// each power of two is split into 16 buckets, so a value is reported
+// within 1/16 of itself. 976 buckets reach 2^64. Recording is a relaxed
+// increment, so any thread may record; reading is safe at any time.
+class LatencyHistogram {
+    static const int SUB = 16;
+    static const int BUCKETS = 61 * SUB;
+
+    atomic<unsigned long long> counts[BUCKETS];
+    atomic<unsigned long long> total, sum, largest;
+
+    static int bucketOf(unsigned long long v) {
+        if (v < 2 * SUB) return (int)v;
+        int msb = 0;
+        for (int step = 32; step; step /= 2)
+            if (v >> (msb + step)) msb += step;
+        int shift = msb - 4;                    // Leaves v >> shift in [16, 32)
+        return shift * SUB + (int)(v >> shift);
+    }
+
+    // Largest value that lands in bucket b
+    static unsigned long long highestIn(int b) {
+        if (b < 2 * SUB) return b;
+        int shift = b / SUB - 1;
+        return ((unsigned long long)(b % SUB + SUB + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        for (int b = 0; b < BUCKETS; b++) counts[b].store(0, memory_order_relaxed);
+        total = sum = largest = 0;
+    }
+
+    // `times` > 1 stands for the samples a caller timing one in `times` skipped
+    void record(long long value, unsigned long long times = 1) {
+        unsigned long long v = value > 0 ? value : 0;
+        counts[bucketOf(v)].fetch_add(times, memory_order_relaxed);
+        total.fetch_add(times, memory_order_relaxed);
+        sum.fetch_add(v * times, memory_order_relaxed);
+        unsigned long long seen = largest.load(memory_order_relaxed);
+        while (v > seen && !largest.compare_exchange_weak(seen, v, memory_order_relaxed)) {}
+    }
+
+    unsigned long long count() const { return total.load(memory_order_relaxed); }
+    unsigned long long totalValue() const { return sum.load(memory_order_relaxed); }
+    unsigned long long max() const { return largest.load(memory_order_relaxed); }
+
+    // Smallest recorded value with at least `q` of the samples at or below it
+    unsigned long long percentile(double q) const {
+        unsigned long long n = count();
+        if (n == 0) return 0;
+        unsigned long long want = (unsigned long long)(q * n + 0.5), seen = 0;
+        if (want < 1) want = 1;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b].load(memory_order_relaxed);
+            if (seen >= want) return highestIn(b) < max() ? highestIn(b) : max();
+        }
+        return max();
+    }
+};
+
+// dataMutex with its wait and hold times recorded. Acquisitions that did
+// not wait are timed one in LOCK_SAMPLING (as logSystemEvent is), and each
+// sample is recorded LOCK_SAMPLING times over; those that waited are always
+// timed. Everything is recorded while the mutex is held, so nothing races.
+const int LOCK_SAMPLING = 16;
+
+class MeteredMutex {
+    mutex m;
+    // Touched only by the holder
+    long long acquiredAt;
+    unsigned holdWeight;            // Times the hold is recorded, 0 = not timed
+    unsigned unwaited;              // Acquisitions that did not wait
+
+    void acquired() {
+        holdWeight = unwaited++ % LOCK_SAMPLING ? 0 : LOCK_SAMPLING;
+        if (!holdWeight) return;
+        acquiredAt = steadyNs();
+        waitNs.record(0, LOCK_SAMPLING);
+    }
+
+public:
+    LatencyHistogram waitNs, holdNs;
+    atomic<long long> contended;    // Acquisitions that had to wait; written by the holder
+
+    MeteredMutex() : acquiredAt(0), holdWeight(0), unwaited(0) { contended = 0; }
+
+    void lock() {
+        if (m.try_lock()) {
+            acquired();
+            return;
+        }
+        long long start = steadyNs();
+        m.lock();
+        acquiredAt = steadyNs();
+        holdWeight = 1;
+        waitNs.record(acquiredAt - start);
+        contended.store(contended.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    bool try_lock() {
+        if (!m.try_lock()) return false;
+        acquired();
+        return true;
+    }
+
+    void unlock() {
+        if (holdWeight) holdNs.record(steadyNs() - acquiredAt, holdWeight);
+        m.unlock();
+    }
+};
+
+MeteredMutex dataMutex;
+
+enum TickPhase { PHASE_TICK, PHASE_ARRIVALS, PHASE_DISPATCH, PHASE_ADMIN_STATE, PHASE_LOG_EVENT, PHASE_CHECKPOINT, TICK_PHASES };
+const char* const PHASE_NAMES[TICK_PHASES] = {"tick", "arrivals", "dispatch", "admin_state", "log_event", "checkpoint"};
+const int LOG_EVENT_SAMPLING = 16;          // One logSystemEvent call in 16 is timed
+
+struct EngineMetrics {
+    LatencyHistogram phaseNs[TICK_PHASES];
+    LatencyHistogram tickParcels;           // Parcels arriving or dispatched per tick
+    LatencyHistogram tickLagNs;             // How late each live tick started
+    atomic<long long> overruns;             // Ticks that took longer than a tick lasts
+    atomic<long long> budgetNs;             // Wall time per tick; 0 = discrete-event
+
+    EngineMetrics() { overruns = 0; budgetNs = 0; }
+};
+
+// Times a scope into a histogram
+class PhaseTimer {
+    LatencyHistogram& histogram;
+    long long start;
+
+public:
+    PhaseTimer(LatencyHistogram& h) : histogram(h), start(steadyNs()) {}
+    ~PhaseTimer() { histogram.record(steadyNs() - start); }
+    long long elapsed() const { return steadyNs() - start; }
+};
+
+// Prometheus text format. `scale` turns recorded units into the exported
+// ones (ns -> seconds); quantile="1" is the largest value seen.
+void writeSummary(ostream& out, const char* name, const char* labels, const LatencyHistogram& h, double scale) {
+    static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+    string sep = labels[0] ? "," : "";
+    for (double q : QUANTILES)
+        out << name << "{" << labels << sep << "quantile=\"" << q << "\"} " << h.percentile(q) * scale << "\n";
+    out << name << "{" << labels << sep << "quantile=\"1\"} " << h.max() * scale << "\n";
+    out << name << "_sum" << (labels[0] ? "{" + string(labels) + "}" : "") << " " << h.totalValue() * scale << "\n";
+    out << name << "_count" << (labels[0] ? "{" + string(labels) + "}" : "") << " " << h.count() << "\n";
+}
+
+// =========================================================
+// 4. ENGINE CLASS (The Brain)
+// =========================================================
+class Engine : public CustomerDesk {
+    Graph graph;
+    ParcelStore parcels;            // Columnar storage of every parcel
+    ParcelHashTable parcelMap;      // O(1) Lookup for Tracking/Undo
+    LaneQueues laneQueues;          // Pending (Booked) parcels per lane
+    StatusCounters counters;        // Parcels per status, by city/lane/priority
+    TrackingIdGenerator idGenerator;
+    Trip* firstTrip;                // Trips on the road, oldest dispatch first
+    Trip* lastTrip;
+    TimingWheel<Trip> arrivals;     // Same trips, keyed on arrival second
+    DayArena* arenas;               // Today's arena first, then older ones still in use
+    DayArena* spareArenas;          // Released arenas kept for reuse
+
+    // Dispatch is planned per source hub in parallel, then applied in source
+    // order so trips and log lines come out exactly as in a serial run
+    struct PlanStep {               // One log line, plus a trip for DISPATCH
+        int dest;
+        int firstParcel;            // Slice of SourcePlan::parcels
+        int parcelCount;            // 0 unless a vehicle was allocated
+        int routeDist;
+        EventType event;            // EV_FAILURE, EV_DISPATCH or EV_DEFER
+        int vehicleCode;
+        int kg, parcels, relaying;  // Load, or what was left for DEFER
+        int vehicleNo, vehicles;
+        bool reroute;
+    };
+    // Lanes whose route starts with the same road share vehicles as far as
+    // the next hub, where the parcels for elsewhere are queued again
+    struct HopGroup {               // Index = allocator lane
+        int hop;                    // Next hub
+        int legDist;
+        bool isReroute;             // Some lane is detouring round a block
+    };
+    struct SourcePlan {
+        Vector<HopGroup> groups;    // In order of first use
+        Vector<PlanStep> steps;
+        Vector<ParcelHandle> parcels;
+    };
+    struct DispatchWorker {         // Scratch for one pool worker
+        VehicleAllocator allocator;
+        Vector<int> groupOfHop;     // Hub -> index into groups, -1 = none yet
+        Vector<ParcelHandle> batch;
+    };
+    Vector<SourcePlan> sourcePlans; // One per source hub, reused every day
+    WorkStealingPool* dispatchPool; // nullptr: plan on the sim thread
+    Vector<DispatchWorker*> workers;
+
+    DispatchWorker* newDispatchWorker() {
+        DispatchWorker* w = new DispatchWorker();
+        w->groupOfHop.assign(network.hubCount, -1);
+        return w;
+    }
+    long long dispatchRuns;
+    double dispatchSeconds;         // Wall time, all runs
+    double slowestDispatch;
+
+    // Road blocks written by the admin panel to blocks.txt ("src dest days")
+    struct RouteBlock {
+        int u, v;
+        long long liftDay;          // Absolute day on which the block expires
+    };
+    Vector<RouteBlock> activeBlocks;
+    long long blocksFileOffset;     // Bytes of blocks.txt already applied
+    
+    Vector<int> bus300;             // Vehicles left today, per source hub
+    Vector<int> bus600;
+    Vector<int> truck2000;
+
+    int day;
+    int second; 
+    long long totalSeconds;
+    atomic<long long> publishedSeconds;     // totalSeconds, for lock-free readers
+    atomic<unsigned> dispatchPhase;         // Odd while dispatchLogic runs
+    atomic<int> publishedParcels;           // Parcels already in parcelMap
+    long long allocsLastTick;
+    long long tripsDispatched;
+    bool running;
+    bool simIdle;                   // runLoop is parked in waitForWork
+    condition_variable_any workCv;  // Wakes an idle runLoop on a booking or stop
+    bool publishState;              // Publish state.snap every tick
+    bool publishAllCities;          // Next publish rewrites every city row, not just changed ones
+    SimClock clock;
+    AsyncLogger logger;             // notifications.txt and events.bin
+    EngineMetrics metrics;          // Exported to metrics.prom
+    long long tickParcels;          // Parcels arriving or dispatched this tick
+    unsigned logCalls;              // For LOG_EVENT_SAMPLING
+    thread metricsThread;
+    atomic<bool> metricsRunning;
+    mutex metricsMutex;
+    condition_variable metricsCv;
+    SnapshotPublisher snapshot;     // state.snap, read by the admin panel
+
+    // Crash recovery (--durable): see WRITE-AHEAD LOG
+    WriteAheadLog* wal;             // nullptr when not durable
+    string snapPath, walPath;
+    mutex checkpointMutex;          // One checkpoint at a time; taken before dataMutex
+    int checkpointDays;             // Snapshot every N days, 0 = only on exit
+    bool checkpointOnExit;
+    bool replaying;                 // Applying the WAL: no log lines, no new records
+    WalRecord walRecord;            // Payload being built
+    Vector<ParcelHandle> lostThisTick;
+    MappedFile recoveryImage;       // The restored snapshot; columns point into it
+
+    // Snapshot layout: this header, then the parts in save order, each
+    // large array page-aligned, then the magic again as an end marker
+    struct RecoveryHeader {
+        char magic[8];
+        int hubCount;
+        int day, second;
+        long long totalSeconds;
+        long long tripsDispatched;
+        long long blocksFileOffset;
+        unsigned long long walGeneration;   // Records after this state are in that WAL
+        unsigned long long walCut;          // ... or, until it is rotated, after this offset of the one before
+    };
+    struct SavedTrip {
+        int src, dest, distance, parcelCount;
+        int vehicle;                        // vehicleCode()
+        long long startTime;
+    };
+
+    // What a checkpoint copies under dataMutex; the parcels and the hash
+    // table are written after, from their cuts
+    struct CheckpointCut {
+        RecoveryHeader header;
+        int parcelCount;
+        RecoveryWriter small;                   // Lanes, counters, ID sequences, blocks, trips
+        unsigned long long walEnd;              // WAL position of the cut
+    };
+    
+public:
+    // `keepLog` appends to notifications.txt and events.bin instead of
+    // starting them over, for a run that resumes from recovery files
+    Engine(bool keepLog = false) : laneQueues(parcels), counters(parcels), logger("notifications.txt", EVENT_LOG_FILE, keepLog) {
+        day = 1;
+        second = 0;
+        totalSeconds = 0;
+        allocsLastTick = 0;
+        arenas = spareArenas = nullptr;
+        firstTrip = lastTrip = nullptr;
+        blocksFileOffset = 0;
+        running = true;
+        simIdle = false;
+        publishState = true;
+        publishAllCities = true;
+        tripsDispatched = 0;
+        publishedSeconds = 0;
+        dispatchPhase = 0;
+        dispatchPool = nullptr;
+        dispatchRuns = 0;
+        dispatchSeconds = slowestDispatch = 0;
+        sourcePlans.assign(network.hubCount, SourcePlan());
+        workers.push_back(newDispatchWorker());
+        publishedParcels = 0;
+        if(!snapshot.open(SNAPSHOT_FILE))
+            cout << Color::RED << "[!] Cannot map " << SNAPSHOT_FILE << "; the admin panel will not see live state.\n" << Color::RESET;
+        bus300.assign(network.hubCount, 0);
+        bus600.assign(network.hubCount, 0);
+        truck2000.assign(network.hubCount, 0);
+        resetVehicles();
+        wal = nullptr;
+        checkpointDays = 0;
+        checkpointOnExit = true;
+        replaying = false;
+        tickParcels = 0;
+        logCalls = 0;
+        metricsRunning = false;
+    }
+
+    ~Engine() {
+        stopMetricsExport();
+        if(wal) {
+            if(checkpointOnExit) checkpoint();
+            lock_guard<MeteredMutex> lock(dataMutex);
+            delete wal;                 // Syncs what is left
+            wal = nullptr;
+        }
+        delete dispatchPool;
+        for(DispatchWorker* w : workers) delete w;
+    }
+
+    void resetVehicles() {
+        // Element-wise so the daily reset never reallocates
+        for(int i=0; i<network.hubCount; i++) {
+            bus300[i] = network.bus300[i];
+            bus600[i] = network.bus600[i];
+            truck2000[i] = network.truck2000[i];
+        }
+    }
+
+    // An event at the current sim second; fill in the fields its type uses
+    LogEvent event(EventType type, int hub) const { return LogEvent(totalSeconds, type, hub); }
+
+    void logSystemEvent(const LogEvent& e, const char* text = nullptr) {
+        if(replaying) return;           // Already logged by the first run
+        if(logCalls++ % LOG_EVENT_SAMPLING) { logger.log(e, text); return; }
+        PhaseTimer timer(metrics.phaseNs[PHASE_LOG_EVENT]);
+        logger.log(e, text);
+    }
+
+    void setLogFlushInterval(int ms) { logger.setFlushInterval(ms); }
+    const AsyncLogger& eventLog() const { return logger; }
+
+    // Threads that plan dispatch (the sim thread counts as one). Set before
+    // the simulation starts.
+    void setDispatchThreads(int threads) {
+        delete dispatchPool;
+        dispatchPool = threads > 1 ? new WorkStealingPool(threads) : nullptr;
+        while(workers.size() < threads) workers.push_back(newDispatchWorker());
+    }
+
+    int dispatchThreads() const { return dispatchPool ? dispatchPool->size() : 1; }
+
+    void dispatchTiming(long long& runs, double& avgMs, double& maxMs) {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        runs = dispatchRuns;
+        avgMs = dispatchRuns ? dispatchSeconds * 1000 / dispatchRuns : 0;
+        maxMs = slowestDispatch * 1000;
+    }
+
+    // --- Customer Functions (CustomerDesk) ---
+    // No console output here: the panel renders the results, locally or
+    // over the socket
+
+    // Validates and books `count` requests under one dataMutex acquisition;
+    // keys[i] is 0 where rows[i] was refused, with the reason in reasons[i].
+    // Without `wait`, returns false at once if the sim thread holds the lock.
+    bool bookRequests(const ManifestRow* rows, int count, TrackingKey* keys, ManifestReject* reasons, bool wait = true) {
+        unique_lock<MeteredMutex> lock(dataMutex, defer_lock);
+        if(wait) lock.lock();
+        else if(!lock.try_lock()) return false;
+        for(int i = 0; i < count; i++) {
+            keys[i] = 0;
+            if(!validBooking(rows[i], reasons[i])) continue;
+            const ManifestRow& r = rows[i];
+            ParcelHandle h = createParcel(r.src, r.srcOffice, r.dest, r.destOffice, r.weight, r.priority);
+            if(h == NO_PARCEL) reasons[i] = REJECT_STORE_FULL;
+            else keys[i] = parcels.trackingKey[h];
+        }
+        return true;
+    }
+
+    DeskResult book(const ManifestRow& row, TrackingKey& key, ManifestReject& reason) override {
+        bookRequests(&row, 1, &key, &reason);
+        if(key) waitDurable(walPosition());
+        return key ? DESK_OK : DESK_REJECTED;
+    }
+
+    // Never blocks on the sim thread: lock-free hash lookup, then a
+    // per-record seqlock copy. `now` is the last completed tick.
+    DeskResult track(TrackingKey key, TrackingRecord& rec, long long& now) override {
+        ParcelHandle h = parcelMap.search(key);
+        if(h == NO_PARCEL) return DESK_NOT_FOUND;
+        parcels.readRecord(h, rec);
+        now = publishedSeconds.load(memory_order_acquire);
+        return DESK_OK;
+    }
+
+    DeskResult cancel(TrackingKey key, ParcelStatus& status) override {
+        DeskResult r = cancel(key, status, true);
+        if(r == DESK_OK) waitDurable(walPosition());
+        return r;
+    }
+
+    // Lock-free lookup; only the cancellation itself takes dataMutex.
+    // Without `wait`, DESK_BUSY if the sim thread holds it.
+    DeskResult cancel(TrackingKey key, ParcelStatus& status, bool wait) {
+        ParcelHandle h = parcelMap.search(key);
+        if(h == NO_PARCEL) return DESK_NOT_FOUND;
+
+        TrackingRecord rec;
+        parcels.readRecord(h, rec);
+        status = rec.status;
+        if(status != STATUS_BOOKED) return DESK_NOT_CANCELLABLE;
+        unique_lock<MeteredMutex> lock(dataMutex, defer_lock);
+        if(wait) lock.lock();
+        else if(!lock.try_lock()) return DESK_BUSY;
+        status = (ParcelStatus)parcels.status[h];   // May have been dispatched meanwhile
+        if(status != STATUS_BOOKED) return DESK_NOT_CANCELLABLE;
+        cancelParcel(h);
+        status = STATUS_CANCELLED;
+        return DESK_OK;
+    }
+
+    // Durability of customer answers. Without --durable everything is
+    // "durable" at once.
+    bool durable() const { return wal != nullptr; }
+    unsigned long long walPosition() { return wal ? wal->end() : 0; }
+    void waitDurable(unsigned long long position) { if(wal) wal->waitDurable(position); }
+
+    // Booking without console output, for the headless driver
+    bool bookSilently(int sC, int sO, int dC, int dO, int w, int p) {
+        ManifestRow row = {sC, sO, dC, dO, w, p, 0};
+        ManifestReject reason;
+        if(!validBooking(row, reason)) return false;
+        lock_guard<MeteredMutex> lock(dataMutex);
+        return createParcel(sC, sO, dC, dO, w, p) != NO_PARCEL;
+    }
+
+    // Books validated manifest rows under one lock acquisition; returns how
+    // many fit before the store filled up. The batch gets one IMPORT event
+    // rather than a BOOKING line per parcel.
+    int bookBatch(const ManifestRow* rows, int count, const string& source) {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        int booked = 0;
+        for(; booked < count; booked++) {
+            const ManifestRow& r = rows[booked];
+            if(createParcel(r.src, r.srcOffice, r.dest, r.destOffice, r.weight, r.priority, false) == NO_PARCEL) break;
+        }
+        if(booked > 0) {
+            LogEvent e = event(EV_IMPORT, NO_HUB);
+            e.parcels = booked;
+            logSystemEvent(e, source.c_str());
+        }
+        return booked;
+    }
+
+    // Tracking by printed ID, as the panel used to do it
+    bool lookupParcel(const string& id, TrackingRecord& rec, long long& now) {
+        TrackingKey key;
+        return parseTrackingId(id, key) && track(key, rec, now) == DESK_OK;
+    }
+
+    // The previous tracking path, which copied the record under dataMutex;
+    // kept for --bench-tracking to compare against
+    bool lookupParcelLocked(const string& id, TrackingRecord& rec, long long& now) {
+        TrackingKey key;
+        ParcelHandle h = parseTrackingId(id, key) ? parcelMap.search(key) : NO_PARCEL;
+        if(h == NO_PARCEL) return false;
+        lock_guard<MeteredMutex> lock(dataMutex);
+        parcels.readRecord(h, rec);
+        now = totalSeconds;
+        return true;
+    }
+
+    // For --bench-tracking: the ID of an already booked parcel picked by `r`
+    bool sampleTrackingId(unsigned r, string& id) const {
+        int n = publishedParcels.load(memory_order_acquire);
+        if(n == 0) return false;
+        id = formatTrackingId(parcels.trackingKey[r % n]);
+        return true;
+    }
+
+    unsigned currentDispatchPhase() const { return dispatchPhase.load(memory_order_acquire); }
+
+    // --- Background (Silent) ---
+    void runLoop() {
+        while(running) {
+            if(clock.jumps() && !waitForWork()) break;
+            long long next = clock.jumps() ? nextEventTime() : simTime() + 1;
+            clock.waitUntil(next);
+            if(!clock.jumps()) noteTickLag(clock.lateNs(next));
+            advanceTo(next);
+        }
+    }
+
+    // --speed max jumps from event to event without waiting, but with no
+    // parcel booked or moving the only events are empty dispatch waves and
+    // day rollovers. Park until a booking arrives instead of racing through
+    // them. Returns false once stopped.
+    bool waitForWork() {
+        unique_lock<MeteredMutex> lock(dataMutex);
+        simIdle = true;
+        workCv.wait(lock, [this] {
+            return !running || counters.total(STATUS_BOOKED) + counters.total(STATUS_IN_TRANSIT) > 0;
+        });
+        simIdle = false;
+        return running;
+    }
+
+    void setClock(ClockMode mode, double speed) {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        clock = SimClock(mode, speed, totalSeconds);
+        setTickBudget(clock);
+    }
+
+    // For drivers with their own clock (--headless)
+    void setTickBudget(const SimClock& c) { metrics.budgetNs = c.tickNs(); }
+    void noteTickLag(long long ns) { metrics.tickLagNs.record(ns); }
+
+    void writeMetrics(ostream& out) {
+        out << "# HELP swiftex_phase_seconds Wall time of each part of a sim tick (log_event is sampled 1 in " << LOG_EVENT_SAMPLING << ").\n"
+            << "# TYPE swiftex_phase_seconds summary\n";
+        for(int i = 0; i < TICK_PHASES; i++) {
+            string label = string("phase=\"") + PHASE_NAMES[i] + "\"";
+            writeSummary(out, "swiftex_phase_seconds", label.c_str(), metrics.phaseNs[i], 1e-9);
+        }
+        out << "# HELP swiftex_lock_wait_seconds Time spent waiting for the engine lock (uncontended acquisitions are sampled 1 in " << LOCK_SAMPLING << ").\n"
+            << "# TYPE swiftex_lock_wait_seconds summary\n";
+        writeSummary(out, "swiftex_lock_wait_seconds", "lock=\"data\"", dataMutex.waitNs, 1e-9);
+        out << "# HELP swiftex_lock_hold_seconds Time the engine lock is held per acquisition (uncontended ones are sampled 1 in " << LOCK_SAMPLING << ").\n"
+            << "# TYPE swiftex_lock_hold_seconds summary\n";
+        writeSummary(out, "swiftex_lock_hold_seconds", "lock=\"data\"", dataMutex.holdNs, 1e-9);
+        out << "# HELP swiftex_lock_contended_total Acquisitions of the engine lock that had to wait.\n"
+            << "# TYPE swiftex_lock_contended_total counter\n"
+            << "swiftex_lock_contended_total{lock=\"data\"} " << dataMutex.contended.load() << "\n";
+        out << "# HELP swiftex_tick_parcels Parcels arriving or dispatched per tick.\n"
+            << "# TYPE swiftex_tick_parcels summary\n";
+        writeSummary(out, "swiftex_tick_parcels", "", metrics.tickParcels, 1);
+        out << "# HELP swiftex_tick_lag_seconds How late each tick started against the wall clock.\n"
+            << "# TYPE swiftex_tick_lag_seconds summary\n";
+        writeSummary(out, "swiftex_tick_lag_seconds", "", metrics.tickLagNs, 1e-9);
+        out << "# HELP swiftex_tick_budget_seconds Wall time one tick lasts at the current speed (0 = discrete-event).\n"
+            << "# TYPE swiftex_tick_budget_seconds gauge\n"
+            << "swiftex_tick_budget_seconds " << metrics.budgetNs.load() * 1e-9 << "\n";
+        out << "# HELP swiftex_tick_overruns_total Ticks that took longer than their budget.\n"
+            << "# TYPE swiftex_tick_overruns_total counter\n"
+            << "swiftex_tick_overruns_total " << metrics.overruns.load() << "\n";
+        out << "# HELP swiftex_log_events_total Events handed to the logger.\n"
+            << "# TYPE swiftex_log_events_total counter\n"
+            << "swiftex_log_events_total{result=\"written\"} " << logger.eventsWritten() << "\n"
+            << "swiftex_log_events_total{result=\"dropped\"} " << logger.eventsDropped() << "\n"
+            << "swiftex_log_events_total{result=\"truncated\"} " << logger.eventsTruncated() << "\n";
+        out << "# HELP swiftex_sim_time_seconds Simulated seconds since the first day.\n"
+            << "# TYPE swiftex_sim_time_seconds gauge\n"
+            << "swiftex_sim_time_seconds " << publishedSeconds.load(memory_order_acquire) << "\n";   // Not simTime(): no dataMutex here
+    }
+
+    // Rewrites `path` every `intervalMs` from a background thread, through a
+    // temp file so a scraper never sees half a file. 0 turns it off.
+    void exportMetrics(const char* path, int intervalMs) {
+        stopMetricsExport();
+        if(intervalMs <= 0) return;
+        metricsRunning = true;
+        metricsThread = thread([this, path, intervalMs]() {
+            unique_lock<mutex> lock(metricsMutex);
+            bool last = false;
+            while(!last) {
+                last = !metricsRunning;
+                lock.unlock();
+                saveMetrics(path);
+                lock.lock();
+                if(metricsRunning) metricsCv.wait_for(lock, chrono::milliseconds(intervalMs));
+            }
+        });
+    }
+
+    void stopMetricsExport() {
+        if(!metricsThread.joinable()) return;
+        {
+            lock_guard<mutex> lock(metricsMutex);
+            metricsRunning = false;
+        }
+        metricsCv.notify_one();
+        metricsThread.join();           // Writes a final snapshot on the way out
+    }
+
+    bool saveMetrics(const char* path) {
+        ostringstream out;
+        out.precision(9);
+        writeMetrics(out);
+        string text = out.str();
+        string temp = string(path) + ".tmp";
+        FILE* f = fopen(temp.c_str(), "wb");
+        if(!f) return false;
+        bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+        ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+        ok = ok && MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        ok = ok && rename(temp.c_str(), path) == 0;
+#endif
+        if(!ok) remove(temp.c_str());
+        return ok;
+    }
+
+    void metricsSummary(double& tickP99Ms, double& tickMaxMs, long long& overruns, long long& contended) const {
+        tickP99Ms = metrics.phaseNs[PHASE_TICK].percentile(0.99) / 1e6;
+        tickMaxMs = metrics.phaseNs[PHASE_TICK].max() / 1e6;
+        overruns = metrics.overruns.load();
+        contended = dataMutex.contended.load();
+    }
+
+    void setPublishState(bool on) { publishState = on; }
+
+    long long simTime() {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        return totalSeconds;
+    }
+
+    // Next tick on which something is scheduled: an arrival, the dispatch
+    // wave or the day rollover. Bookings come from outside and are not known.
+    long long nextEventTime() {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        long long next = totalSeconds + (SECONDS_PER_DAY - second);
+        if(second < DISPATCH_SECOND) next = totalSeconds + (DISPATCH_SECOND - second);
+        return arrivals.nextDue(next);
+    }
+
+    // Runs the simulation up to `tick`. Callers never jump past the next
+    // event, so seconds in between have nothing to process.
+    void advanceTo(long long tick) {
+        if(runTick(tick)) checkpoint();
+    }
+
+    // advanceTo under dataMutex; true when a checkpoint is due, which is
+    // taken after the lock is released
+    bool runTick(long long tick) {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        if(tick <= totalSeconds) return false;
+        PhaseTimer tickTimer(metrics.phaseNs[PHASE_TICK]);
+        long long allocsBefore = allocStats.systemAllocs;
+        tickParcels = 0;
+        bool newDay = advanceClock(tick);
+
+        syncBlocks();
+        {
+            PhaseTimer timer(metrics.phaseNs[PHASE_ARRIVALS]);
+            completeArrivals();
+        }
+        if(second == DISPATCH_SECOND) {
+            dispatchPhase.fetch_add(1, memory_order_release);
+            PhaseTimer timer(metrics.phaseNs[PHASE_DISPATCH]);
+            dispatchLogic();
+            double took = timer.elapsed() / 1e9;
+            dispatchRuns++;
+            dispatchSeconds += took;
+            if(took > slowestDispatch) slowestDispatch = took;
+            dispatchPhase.fetch_add(1, memory_order_release);
+        }
+        bool checkpointDue = newDay && wal && checkpointDays > 0 && (totalSeconds / SECONDS_PER_DAY) % checkpointDays == 0;
+        allocsLastTick = allocStats.systemAllocs - allocsBefore;
+        if(publishState) {
+            PhaseTimer timer(metrics.phaseNs[PHASE_ADMIN_STATE]);
+            writeAdminState();
+        }
+        metrics.tickParcels.record(tickParcels);
+        long long budget = metrics.budgetNs.load(memory_order_relaxed);
+        if(budget > 0 && tickTimer.elapsed() > budget) metrics.overruns++;
+        return checkpointDue;
+    }
+
+    // Moves the clock to `tick`, rolling the day over at each midnight on
+    // the way. A live tick passes at most one; WAL replay may pass several.
+    bool advanceClock(long long tick) {
+        bool newDay = false;
+        while(second + (tick - totalSeconds) >= SECONDS_PER_DAY) {
+            totalSeconds += SECONDS_PER_DAY - second;
+            second = 0;
+            day++;
+            if(day > 5) day = 1; 
+            releaseIdleArenas();
+            resetVehicles();
+            logSystemEvent(event(EV_NEW_DAY, NO_HUB));
+            expireBlocks();
+            newDay = true;
+        }
+        second += tick - totalSeconds;
+        totalSeconds = tick;
+        publishedSeconds.store(tick, memory_order_release);
+        return newDay;
+    }
+
+    // Parcel counts by status (overall and per priority) plus trips sent,
+    // for the headless summary
+    void collectStats(long long statusCounts[], long long byPriority[][STATUS_COUNT], long long& trips, int& onRoad) {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        for(int st = 0; st < STATUS_COUNT; st++) {
+            statusCounts[st] = counters.total((ParcelStatus)st);
+            for(int p = 0; p < counters.priorityLevels(); p++) byPriority[p][st] = counters.priority(p + 1, (ParcelStatus)st);
+        }
+        trips = tripsDispatched;
+        onRoad = 0;
+        for(Trip* t = firstTrip; t; t = t->nextActive) onRoad++;
+    }
+
+    void publishNow() {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        writeAdminState();
+    }
+
+    // --- Route Blocks ---
+    // Roads are two-way, so a block closes both directions of the edge.
+    void setRoadOpen(int u, int v, bool open) {
+        int rows = graph.updateEdge(u, v, open) + graph.updateEdge(v, u, open);
+        LogEvent e = event(open ? EV_UNBLOCK : EV_BLOCK, u);
+        e.peer = v;
+        e.extra = rows;
+        logSystemEvent(e);
+    }
+
+    void addBlock(int u, int v, int days) {
+        if(u < 0 || u >= network.hubCount || v < 0 || v >= network.hubCount || u == v || days <= 0) return;
+        long long liftDay = totalSeconds / SECONDS_PER_DAY + days;
+        for(RouteBlock& b : activeBlocks) {
+            if((b.u == u && b.v == v) || (b.u == v && b.v == u)) {
+                if(liftDay > b.liftDay) b.liftDay = liftDay;
+                return;
+            }
+        }
+        activeBlocks.push_back({u, v, liftDay});
+        setRoadOpen(u, v, false);
+    }
+
+    void liftAllBlocks() {
+        Vector<RouteBlock> lifted = activeBlocks;
+        activeBlocks.clear();
+        for(const RouteBlock& b : lifted) setRoadOpen(b.u, b.v, true);
+    }
+
+    void expireBlocks() {
+        long long today = totalSeconds / SECONDS_PER_DAY;
+        int kept = 0;
+        for(int i = 0; i < activeBlocks.size(); i++) {
+            RouteBlock b = activeBlocks[i];
+            if(b.liftDay <= today) setRoadOpen(b.u, b.v, true);
+            else activeBlocks[kept++] = b;
+        }
+        while(activeBlocks.size() > kept) activeBlocks.pop_back();
+    }
+
+    // Applies lines appended to blocks.txt since the last tick. A file that
+    // shrank was cleared by the admin ("Clear All Blocks"): every block lifts.
+    void syncBlocks() {
+        struct stat st;
+        long long size = (stat("blocks.txt", &st) == 0) ? (long long)st.st_size : 0;
+        if(size == blocksFileOffset) return;
+        if(size < blocksFileOffset) {
+            liftAllBlocks();
+            blocksFileOffset = 0;
+            if(size == 0) { recordBlocks(); return; }
+        }
+
+        ifstream f("blocks.txt", ios::binary);
+        if(!f.is_open()) { recordBlocks(); return; }
+        f.seekg(blocksFileOffset);
+        string line;
+        while(getline(f, line)) {
+            if(f.eof()) break;              // Partial line: retry next tick
+            blocksFileOffset = f.tellg();
+            int u, v, days;
+            if(sscanf(line.c_str(), "%d %d %d", &u, &v, &days) == 3) addBlock(u, v, days);
+        }
+        recordBlocks();
+    }
+
+    // The whole block list, so replay need not reread blocks.txt
+    void recordBlocks() {
+        if(!wal || replaying) return;
+        beginRecord();
+        walRecord.put(blocksFileOffset, 8);
+        walRecord.put(activeBlocks.size(), 4);
+        for(const RouteBlock& b : activeBlocks) {
+            walRecord.put(b.u, 4);
+            walRecord.put(b.v, 4);
+            walRecord.put(b.liftDay, 8);
+        }
+        appendRecord(WAL_BLOCKS);
+    }
+
+    // Arena for trips dispatched today; older arenas stay alive until their
+    // last trip is delivered, then go back to the spare list.
+    DayArena* arenaForToday() { return arenaForDay(totalSeconds / SECONDS_PER_DAY); }
+
+    // Days are asked for in order (a restore rebuilds the oldest trips first)
+    DayArena* arenaForDay(long long d) {
+        if(arenas && arenas->day == d) return arenas;
+        DayArena* a = spareArenas;
+        if(a) spareArenas = a->next;
+        else a = new DayArena();
+        a->day = d;
+        a->next = arenas;
+        arenas = a;
+        return a;
+    }
+
+    // Bulk-release every arena from a past day whose trips are all delivered
+    void releaseIdleArenas() {
+        long long today = totalSeconds / SECONDS_PER_DAY;
+        DayArena* prev = nullptr;
+        DayArena* a = arenas;
+        while(a) {
+            DayArena* next = a->next;
+            if(a->liveTrips == 0 && a->day != today) {
+                if(prev) prev->next = next;
+                else arenas = next;
+                a->reset();
+                a->next = spareArenas;
+                spareArenas = a;
+            } else {
+                prev = a;
+            }
+            a = next;
+        }
+    }
+
+    // Caller holds dataMutex and has checked the row with validBooking
+    ParcelHandle createParcel(int sC, int sO, int dC, int dO, int w, int p, bool logBooking = true) {
+        if(parcels.count() >= ParcelStore::MAX_PARCELS) return NO_PARCEL;
+        TrackingKey key = idGenerator.next(sC);
+        ParcelHandle h = parcels.add(key, sC, sO, dC, dO, w, p, day);
+        
+        // Add to Hash Table and the lane's dispatch queue
+        parcelMap.insert(key, h);
+        publishedParcels.store(h + 1, memory_order_release);
+        laneQueues.push(h);
+        counters.added(h);
+        if(simIdle) workCv.notify_one();
+        if(logBooking) {
+            LogEvent e = event(EV_BOOKING, sC);
+            e.peer = dC;
+            e.parcel = key;
+            logSystemEvent(e);
+        }
+        if(wal && !replaying) {
+            ManifestRow row = {sC, sO, dC, dO, w, p, 0};
+            beginRecord();
+            walRecord.put(key, 8);
+            encodeBookingRecord(row, walRecord.extend(MANIFEST_RECORD_BYTES));
+            appendRecord(WAL_BOOK);
+        }
+        return h;
+    }
+
+    // Caller holds dataMutex and has checked the parcel is still BOOKED
+    void cancelParcel(ParcelHandle h) {
+        setStatus(h, STATUS_CANCELLED);
+        laneQueues.remove(h);
+        LogEvent e = event(EV_UNDO, parcels.srcCity[h]);
+        e.parcel = parcels.trackingKey[h];
+        logSystemEvent(e);
+        if(wal && !replaying) {
+            beginRecord();
+            walRecord.put(h, 4);
+            appendRecord(WAL_CANCEL);
+        }
+    }
+
+    // Every record starts with the second it happened in
+    void beginRecord() {
+        walRecord.clear();
+        walRecord.put(totalSeconds, 8);
+    }
+
+    void appendRecord(WalRecordType type) { wal->append(type, walRecord.data(), walRecord.size()); }
+
+    // Every status change goes through here to keep the counters exact
+    // and inside a record update, so tracking readers see a consistent copy
+    void setStatus(ParcelHandle h, ParcelStatus to) {
+        parcels.beginUpdate(h);
+        counters.moved(h, (ParcelStatus)parcels.status[h], to);
+        parcels.status[h] = to;
+        parcels.endUpdate(h);
+    }
+
+    // Starts the parcel's next leg; the first one takes it out of BOOKED
+    void markDispatched(ParcelHandle h, int legTo, int legDist) {
+        parcels.beginUpdate(h);
+        parcels.legTo[h] = legTo;
+        parcels.legCount[h]++;
+        parcels.legDistance[h] = legDist;
+        parcels.dispatchTime[h] = totalSeconds;
+        parcels.totalRouteDistance[h] += legDist;
+        if(parcels.status[h] != STATUS_IN_TRANSIT) {
+            counters.moved(h, (ParcelStatus)parcels.status[h], STATUS_IN_TRANSIT);
+            parcels.status[h] = STATUS_IN_TRANSIT;
+        }
+        parcels.endUpdate(h);
+    }
+
+    // The parcel reached a hub short of its destination: it waits in that
+    // hub's queue for the next dispatch wave, pooled with local traffic
+    void relayParcel(ParcelHandle h, int hub) {
+        parcels.beginUpdate(h);
+        parcels.atHub[h] = hub;
+        parcels.legDistance[h] = 0;
+        parcels.endUpdate(h);
+        int fromLane = parcels.lane[h];
+        laneQueues.push(h);
+        counters.changedLane(h, fromLane);
+    }
+
+    void startTrip(Trip* t) {
+        tripsDispatched++;
+        t->prevActive = lastTrip;
+        if(lastTrip) lastTrip->nextActive = t;
+        else firstTrip = t;
+        lastTrip = t;
+        arrivals.schedule(t, t->arrivalTime());
+    }
+
+    // Unlinks a delivered trip and hands its memory back to the arena
+    void releaseTrip(Trip* t) {
+        if(t->prevActive) t->prevActive->nextActive = t->nextActive;
+        else firstTrip = t->nextActive;
+        if(t->nextActive) t->nextActive->prevActive = t->prevActive;
+        else lastTrip = t->prevActive;
+        t->arena->liveTrips--;
+        t->~Trip();
+    }
+
+    // Only the trips arriving this second are touched. Replay passes the
+    // losses the WAL recorded instead of drawing them again.
+    void completeArrivals(const Vector<ParcelHandle>* replayLosses = nullptr) {
+        Trip* t = arrivals.advanceTo(totalSeconds);
+        if(!t) return;
+        lostThisTick.clear();
+        while(t) {
+            Trip* next = t->wheelNext;
+            int relayed = 0;
+            tickParcels += t->parcelCount;
+            for(int i = 0; i < t->parcelCount; i++) {
+                ParcelHandle h = t->parcels[i];
+                if(parcels.destCity[h] != t->dest) {
+                    relayParcel(h, t->dest);
+                    relayed++;
+                    continue;
+                }
+                // Losses are drawn once per parcel, on its last leg
+                bool lost;
+                if(replayLosses) lost = lostThisTick.size() < replayLosses->size() && (*replayLosses)[lostThisTick.size()] == h;
+                else lost = rand() % 1000 < 5;
+                if(lost) { 
+                    lostThisTick.push_back(h);
+                    setStatus(h, STATUS_LOST);
+                    LogEvent e = event(EV_LOST, t->dest);
+                    e.parcel = parcels.trackingKey[h];
+                    logSystemEvent(e);
+                } else {
+                    setStatus(h, STATUS_DELIVERED);
+                }
+            }
+            LogEvent e = event(EV_ARRIVAL, t->dest);
+            e.peer = t->src;
+            e.vehicle = t->vehicle;
+            e.extra = relayed;
+            logSystemEvent(e);
+            releaseTrip(t);
+            t = next;
+        }
+        releaseIdleArenas();
+        if(wal && !replaying) {
+            beginRecord();
+            walRecord.put(lostThisTick.size(), 4);
+            for(ParcelHandle h : lostThisTick) walRecord.put(h, 4);
+            appendRecord(WAL_ARRIVE);
+        }
+    }
+
+    void writeAdminState() {
+        if(!snapshot.isOpen()) return;
+        StateSnapshot* snap = snapshot.beginWrite();
+        SnapshotCounters& c = snap->counters;
+        c.day = day;
+        c.second = second;
+        c.booked = counters.total(STATUS_BOOKED);
+        c.transit = counters.total(STATUS_IN_TRANSIT);
+        c.lost = counters.total(STATUS_LOST);
+        c.delivered = counters.total(STATUS_DELIVERED);
+        c.cancelled = counters.total(STATUS_CANCELLED);
+        c.hubCount = network.hubCount < SNAPSHOT_MAX_HUBS ? network.hubCount : SNAPSHOT_MAX_HUBS;
+        auto publishCity = [&](int hub) {
+            if(hub >= c.hubCount) return;
+            for(int st = 0; st < STATUS_COUNT; st++) snap->cities[hub].counts[st] = counters.city(hub, (ParcelStatus)st);
+        };
+        if(publishAllCities) {
+            for(int hub = 0; hub < c.hubCount; hub++) publishCity(hub);
+            publishAllCities = false;
+        }
+        else for(int hub : counters.changedCities()) publishCity(hub);
+        counters.clearDirtyCities();
+        c.systemAllocsLastTick = allocsLastTick;
+        c.systemAllocsTotal = allocStats.systemAllocs;
+        c.poolLiveObjects = allocStats.poolAllocs - allocStats.poolFrees;
+        c.logWritten = logger.eventsWritten();
+        c.logDropped = logger.eventsDropped();
+        c.logTruncated = logger.eventsTruncated();
+        c.logBacklog = logger.backlog();
+        int rows = 0, onRoad = 0;
+        for(Trip* t = firstTrip; t; t = t->nextActive, onRoad++) {
+            if(rows == SNAPSHOT_MAX_TRIPS) continue;
+            SnapshotTrip& row = snap->trips[rows++];
+            long long traveled = (totalSeconds - t->startTime) / SECONDS_PER_NODE;
+            row.src = t->src;
+            row.dest = t->dest;
+            row.traveledKm = (int)(traveled < t->distance ? traveled : t->distance);
+            row.totalKm = t->distance;
+            strncpy(row.vehicle, vehicleName(t->vehicle), sizeof(row.vehicle) - 1);
+            row.vehicle[sizeof(row.vehicle) - 1] = '\0';
+        }
+        c.tripCount = rows;
+        c.tripsOnRoad = onRoad;
+        snapshot.endWrite();
+    }
+
+    // Pool worker: reads lane queues, parcels and routes, and writes only
+    // this source's plan and fleet counters
+    void planSource(int s, int worker) {
+        SourcePlan& plan = sourcePlans[s];
+        DispatchWorker& w = *workers[worker];
+        VehicleAllocator& allocator = w.allocator;
+        plan.groups.clear();
+        plan.steps.clear();
+        plan.parcels.clear();
+        allocator.reset();
+        for(int lane = laneQueues.firstLaneOf(s); lane != -1; lane = laneQueues.nextLane(lane)) {
+            if(laneQueues.pendingCount(lane) == 0) continue;
+            int d = laneQueues.destOf(lane);
+
+            // Selection walks the buckets in priority order
+            w.batch.clear();
+            int currentBatchWeight = 0;
+            for(int b = 0; b < laneQueues.priorityLevels(); b++) {
+                for(ParcelHandle h = laneQueues.head(lane, b); h != NO_PARCEL; h = parcels.laneNext[h]) {
+                    int priority = parcels.priority[h];
+                    int weight = parcels.weight[h];
+                    bool select = false;
+                    if (day == 5) select = true;
+                    else if (day == 1 || day == 3) {
+                        if (priority == 1) select = true;
+                        else if (currentBatchWeight + weight <= 300) select = true;
+                    }
+                    else if (day == 2 || day == 4) {
+                        if (priority <= 2) select = true;
+                        else if (currentBatchWeight + weight <= 600) select = true;
+                    }
+                    if(select) {
+                        w.batch.push_back(h);
+                        currentBatchWeight += weight;
+                    }
+                }
+            }
+            if(w.batch.empty()) continue;
+
+            int hop = s, hopDist = 5, routeDist = 5;
+            bool isReroute = false;
+            if(s != d) {
+                if(!graph.firstHop(s, d, worker, hop, hopDist, routeDist)) {
+                    PlanStep step = {};
+                    step.dest = d;
+                    step.firstParcel = step.parcelCount = 0;
+                    step.routeDist = -1;
+                    step.event = EV_FAILURE;
+                    plan.steps.push_back(step);
+                    continue;
+                }
+                int directDist = graph.baseWeight(s, d);
+                if(directDist > 0 && routeDist > directDist) isReroute = true;
+            }
+
+            int g = w.groupOfHop[hop];
+            if(g < 0) {
+                g = allocator.addLane();
+                w.groupOfHop[hop] = g;
+                plan.groups.push_back({hop, hopDist, false});
+            }
+            if(isReroute) plan.groups[g].isReroute = true;
+            for(ParcelHandle h : w.batch) allocator.add(g, h, parcels.weight[h], parcels.priority[h]);
+        }
+        for(const HopGroup& group : plan.groups) w.groupOfHop[group.hop] = -1;
+
+        int available[VEHICLE_TYPES] = {bus300[s], bus600[s], truck2000[s]};
+        allocator.pack(available);
+        bus300[s] = available[VEHICLE_BUS300];
+        bus600[s] = available[VEHICLE_BUS600];
+        truck2000[s] = available[VEHICLE_TRUCK];
+        for(ParcelHandle h : allocator.packed) plan.parcels.push_back(h);
+
+        // One log line per vehicle, by next hub
+        for(int g = 0; g < plan.groups.size(); g++) {
+            const HopGroup& group = plan.groups[g];
+            PlanStep step = {};
+            step.dest = group.hop;
+            step.routeDist = group.legDist;
+            int vehicles = allocator.loadCount(g);
+            for(int k = 0; k < vehicles; k++) {
+                const VehicleAllocator::Load& load = allocator.loads[allocator.firstLoad(g) + k];
+                int relaying = 0;
+                for(int i = load.first; i < load.first + load.count; i++) if(parcels.destCity[plan.parcels[i]] != group.hop) relaying++;
+                step.event = EV_DISPATCH;
+                step.firstParcel = load.first;
+                step.parcelCount = load.count;
+                step.vehicleCode = vehicleCode(load.vehicle, load.convoy);
+                step.kg = load.weight;
+                step.parcels = load.count;
+                step.relaying = relaying;
+                step.vehicleNo = k + 1;
+                step.vehicles = vehicles;
+                step.reroute = group.isReroute;
+                plan.steps.push_back(step);
+            }
+            if(allocator.leftoverCount(g) > 0) {
+                step.event = EV_DEFER;
+                step.firstParcel = step.parcelCount = 0;
+                step.kg = allocator.leftoverWeight(g);
+                step.parcels = allocator.leftoverCount(g);
+                plan.steps.push_back(step);
+            }
+        }
+    }
+
+    void dispatchLogic() {
+        graph.refreshRoutes();
+        graph.prepareWorkers(dispatchPool ? dispatchPool->size() : 1);
+        auto plan = [this](int s, int worker) { planSource(s, worker); };
+        if(dispatchPool) dispatchPool->run(network.hubCount, plan);
+        else for(int s = 0; s < network.hubCount; s++) plan(s, 0);
+
+        bool record = wal && !replaying;
+        if(record) {
+            int trips = 0;
+            for(int s = 0; s < network.hubCount; s++)
+                for(const PlanStep& p : sourcePlans[s].steps) if(p.parcelCount > 0) trips++;
+            beginRecord();
+            walRecord.put(trips, 4);
+        }
+        for(int s = 0; s < network.hubCount; s++) {
+            SourcePlan& sp = sourcePlans[s];
+            for(const PlanStep& p : sp.steps) {
+                if(p.parcelCount > 0) {
+                    launchTrip(s, p.dest, p.vehicleCode, p.routeDist, sp.parcels.begin() + p.firstParcel, p.parcelCount);
+                    tickParcels += p.parcelCount;
+                    if(record) {
+                        walRecord.put(s, 4);
+                        walRecord.put(p.dest, 4);
+                        walRecord.put(p.routeDist, 4);
+                        walRecord.put(p.vehicleCode, 4);
+                        walRecord.put(p.parcelCount, 4);
+                        for(int i = p.firstParcel; i < p.firstParcel + p.parcelCount; i++) walRecord.put(sp.parcels[i], 4);
+                    }
+                }
+                LogEvent e = event(p.event, s);
+                e.peer = p.dest;
+                if(p.event == EV_DISPATCH) {
+                    e.vehicle = p.vehicleCode;
+                    e.kg = p.kg;
+                    e.parcels = p.parcels;
+                    e.extra = p.relaying;
+                    e.vehicleNo = p.vehicleNo;
+                    e.vehicles = p.vehicles;
+                    e.reroute = p.reroute;
+                } else if(p.event == EV_DEFER) {
+                    e.kg = p.kg;
+                    e.parcels = p.parcels;
+                }
+                logSystemEvent(e);
+            }
+        }
+        if(record) appendRecord(WAL_DISPATCH);
+    }
+
+    // Loads parcels that are queued at `s` onto a new trip leaving now
+    void launchTrip(int s, int dest, int vehicle, int km, const ParcelHandle* load, int count) {
+        DayArena* arena = arenaForToday();
+        Trip* newTrip = new (arena->allocate(sizeof(Trip))) Trip(s, dest, vehicle, km, totalSeconds);
+        newTrip->arena = arena;
+        newTrip->parcels = (ParcelHandle*)arena->allocate(sizeof(ParcelHandle) * count);
+        arena->liveTrips++;
+        for(int i = 0; i < count; i++) {
+            ParcelHandle h = load[i];
+            laneQueues.remove(h);
+            markDispatched(h, dest, km);
+            newTrip->parcels[newTrip->parcelCount++] = h;
+        }
+        startTrip(newTrip);
+    }
+
+    // --- Crash Recovery (--durable) ---
+    // Restores the snapshot at `snapFile` if there is one, replays the WAL
+    // records written after it, and from then on logs every change to
+    // `walFile`. Call before the sim thread starts. false: the files are
+    // there but unusable (error says why), and the engine must not be used.
+    bool openDurableState(const string& snapFile, const string& walFile, int snapshotEveryDays,
+                          long long& restoredParcels, long long& replayedRecords, string& error) {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        snapPath = snapFile;
+        walPath = walFile;
+        checkpointDays = snapshotEveryDays;
+        replaying = true;
+        unsigned long long generation = 0, cut = 0;
+        struct stat st;
+        bool ok = stat(snapPath.c_str(), &st) != 0 || restoreSnapshot(generation, cut, error);
+        restoredParcels = parcels.count();
+        replayedRecords = 0;
+        long long keep = 0, start = 0;
+        if(ok) keep = WriteAheadLog::replay(walPath.c_str(), generation, cut, start, replayedRecords,
+                                           [this](WalRecordType type, WalCursor& in) { return applyRecord(type, in); });
+        replaying = false;
+        if(!ok) return false;
+        wal = new WriteAheadLog();
+        if(!wal->open(walPath.c_str(), generation, keep)) {
+            delete wal;
+            wal = nullptr;
+            error = "cannot open " + walPath;
+            return false;
+        }
+        // The last checkpoint's rotation never happened: finish it
+        if(keep > 0 && start != WAL_HEADER_BYTES) wal->rotate(generation, start);
+        return true;
+    }
+
+    // Skips the snapshot the destructor takes, so the next start has a WAL
+    // tail to replay (--bench-restart)
+    void setCheckpointOnExit(bool on) { checkpointOnExit = on; }
+
+    void checkpointNow() {
+        if(wal) checkpoint();
+    }
+
+    // Takes the snapshot without holding dataMutex for the write. Under the
+    // lock only the cut is taken (see takeCut); bookings and the sim carry
+    // on while the parcel columns and the hash table are streamed out and
+    // synced, the first change to each of their blocks keeping a copy of
+    // it for the snapshot.
+    void checkpoint() {
+        lock_guard<mutex> one(checkpointMutex);
+        PhaseTimer timer(metrics.phaseNs[PHASE_CHECKPOINT]);
+        CheckpointCut cut;
+        {
+            lock_guard<MeteredMutex> lock(dataMutex);
+            takeCut(cut, wal->generation() + 1);
+        }
+        bool saved = saveSnapshot(cut);
+        {
+            lock_guard<MeteredMutex> lock(dataMutex);
+            parcels.endCut();
+            parcelMap.endCut();
+        }
+        if(!saved) {
+            cout << Color::RED << "[!] Cannot write " << snapPath << "; the WAL keeps growing until a snapshot succeeds." << Color::RESET << endl;
+            return;
+        }
+        wal->rotate(cut.header.walGeneration, cut.walEnd);
+        double ms = timer.elapsed() / 1e6;
+        lock_guard<MeteredMutex> lock(dataMutex);
+        LogEvent e = event(EV_CHECKPOINT, NO_HUB);
+        e.parcels = cut.parcelCount;
+        e.extra = (int)ms;
+        logSystemEvent(e);
+    }
+
+    // Caller holds dataMutex. Copies the header fields and serializes the
+    // small structures into cut.small; starts the parcels' and the hash
+    // table's cuts.
+    void takeCut(CheckpointCut& cut, unsigned long long generation) {
+        RecoveryHeader& h = cut.header;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "SWXCKPT3", 8);
+        h.hubCount = network.hubCount;
+        h.day = day;
+        h.second = second;
+        h.totalSeconds = totalSeconds;
+        h.tripsDispatched = tripsDispatched;
+        h.blocksFileOffset = blocksFileOffset;
+        h.walGeneration = generation;
+        cut.walEnd = wal->end();
+        h.walCut = wal->fileOffset(cut.walEnd);
+        cut.parcelCount = parcels.count();
+        parcels.beginCut();
+        parcelMap.beginCut();
+
+        RecoveryWriter& out = cut.small;
+        out.openMemory();
+        laneQueues.save(out);
+        counters.save(out);
+        idGenerator.save(out);
+        out.vector(activeBlocks);
+        int trips = 0;
+        for(Trip* t = firstTrip; t; t = t->nextActive) trips++;
+        out.value(trips);
+        for(Trip* t = firstTrip; t; t = t->nextActive) {
+            SavedTrip saved;
+            memset(&saved, 0, sizeof(saved));
+            saved.src = t->src;
+            saved.dest = t->dest;
+            saved.distance = t->distance;
+            saved.parcelCount = t->parcelCount;
+            saved.startTime = t->startTime;
+            saved.vehicle = t->vehicle;
+            out.value(saved);
+            out.write(t->parcels, sizeof(ParcelHandle) * t->parcelCount);
+        }
+    }
+
+    // Without dataMutex: parcels past the cut are left out, and the ones
+    // that changed since are written as the cut saw them
+    bool saveSnapshot(const CheckpointCut& cut) {
+        RecoveryWriter out;
+        if(!out.open(snapPath)) return false;
+        out.value(cut.header);
+        parcels.save(out);
+        parcelMap.save(out);
+        out.write(cut.small.bytes(), cut.small.size());
+        out.write(cut.header.magic, 8);
+        return out.commit(snapPath);
+    }
+
+    // Into a fresh engine. The parcel columns and the hash table stay in
+    // the copy-on-write mapping, so only lanes, counters and the trips on
+    // the road are rebuilt. Vehicles are not saved: each hub's fleet is
+    // full again at midnight and a snapshot is never taken between dispatch
+    // and midnight of a day that would dispatch again.
+    bool restoreSnapshot(unsigned long long& generation, unsigned long long& walCut, string& error) {
+        size_t size;
+        void* image = recoveryImage.openPrivate(snapPath.c_str(), size);
+        if(!image) { error = "cannot read " + snapPath; return false; }
+        RecoveryReader in(image, size);
+        RecoveryHeader h;
+        if(!in.value(h) || memcmp(h.magic, "SWXCKPT3", 8) != 0) { error = snapPath + " is not a recovery snapshot"; return false; }
+        if(h.hubCount != network.hubCount) { error = snapPath + " was taken on a network of " + to_string(h.hubCount) + " hubs"; return false; }
+        day = h.day;
+        second = h.second;
+        totalSeconds = h.totalSeconds;
+        publishedSeconds.store(totalSeconds, memory_order_release);
+        blocksFileOffset = h.blocksFileOffset;
+        generation = h.walGeneration;
+        walCut = h.walCut;
+        publishAllCities = true;
+        arrivals = TimingWheel<Trip>(totalSeconds);
+        clock = SimClock(CLOCK_REAL_TIME, 1, totalSeconds);
+
+        bool ok = parcels.restore(in) && parcelMap.restore(in) && laneQueues.restore(in) &&
+                  counters.restore(in) && idGenerator.restore(in) && in.vector(activeBlocks, INT_MAX);
+        for(const RouteBlock& b : activeBlocks) {
+            if(!ok) break;
+            ok = b.u >= 0 && b.u < network.hubCount && b.v >= 0 && b.v < network.hubCount;
+            if(ok) setRoadOpen(b.u, b.v, false);
+        }
+        int trips = 0;
+        ok = ok && in.value(trips);
+        for(int i = 0; ok && i < trips; i++) {
+            SavedTrip saved;
+            ok = in.value(saved) && saved.parcelCount >= 0;
+            const ParcelHandle* load = ok ? (const ParcelHandle*)in.take(sizeof(ParcelHandle) * saved.parcelCount) : nullptr;
+            ok = ok && (load || saved.parcelCount == 0);
+            if(!ok) break;
+            if(saved.vehicle < 0 || saved.vehicle >= VEHICLE_CODES) { ok = false; break; }
+            DayArena* arena = arenaForDay(saved.startTime / SECONDS_PER_DAY);
+            Trip* t = new (arena->allocate(sizeof(Trip))) Trip(saved.src, saved.dest, saved.vehicle, saved.distance, saved.startTime);
+            t->arena = arena;
+            t->parcels = (ParcelHandle*)arena->allocate(sizeof(ParcelHandle) * (saved.parcelCount ? saved.parcelCount : 1));
+            if(saved.parcelCount) memcpy(t->parcels, load, sizeof(ParcelHandle) * saved.parcelCount);
+            t->parcelCount = saved.parcelCount;
+            arena->liveTrips++;
+            startTrip(t);
+        }
+        char* end = in.take(8);
+        if(!ok || !end || memcmp(end, h.magic, 8) != 0) { error = snapPath + " is damaged or truncated"; return false; }
+        tripsDispatched = h.tripsDispatched;
+        publishedParcels.store(parcels.count(), memory_order_release);
+        return true;
+    }
+
+    // One WAL record, replayed exactly as it happened. false stops replay
+    // there (the record does not fit the state, so the log is damaged).
+    bool applyRecord(WalRecordType type, WalCursor& in) {
+        long long time = (long long)in.get(8);
+        if(!in.ok || time < totalSeconds) return false;
+        advanceClock(time);
+        switch(type) {
+        case WAL_BOOK: {
+            TrackingKey key = in.get(8);
+            const unsigned char* body = in.skip(MANIFEST_RECORD_BYTES);
+            if(!in.ok) return false;
+            ManifestRow row;
+            ManifestReject reason;
+            decodeBookingRecord(body, row);
+            if(!validBooking(row, reason)) return false;
+            ParcelHandle h = createParcel(row.src, row.srcOffice, row.dest, row.destOffice, row.weight, row.priority, false);
+            return h != NO_PARCEL && parcels.trackingKey[h] == key;
+        }
+        case WAL_CANCEL: {
+            ParcelHandle h = (ParcelHandle)in.get(4);
+            if(!in.ok || h < 0 || h >= parcels.count() || parcels.status[h] != STATUS_BOOKED) return false;
+            cancelParcel(h);
+            return true;
+        }
+        case WAL_BLOCKS: {
+            long long offset = (long long)in.get(8);
+            int n = (int)in.get(4);
+            if(!in.ok || n < 0) return false;
+            liftAllBlocks();
+            for(int i = 0; i < n; i++) {
+                RouteBlock b;
+                b.u = (int)in.get(4);
+                b.v = (int)in.get(4);
+                b.liftDay = (long long)in.get(8);
+                if(!in.ok || b.u < 0 || b.u >= network.hubCount || b.v < 0 || b.v >= network.hubCount) return false;
+                activeBlocks.push_back(b);
+                setRoadOpen(b.u, b.v, false);
+            }
+            blocksFileOffset = offset;
+            return true;
+        }
+        case WAL_ARRIVE: {
+            int n = (int)in.get(4);
+            if(!in.ok || n < 0) return false;
+            Vector<ParcelHandle> lost;
+            for(int i = 0; i < n; i++) lost.push_back((ParcelHandle)in.get(4));
+            if(!in.ok) return false;
+            lostThisTick.clear();
+            completeArrivals(&lost);
+            return lostThisTick.size() == n;
+        }
+        case WAL_DISPATCH: {
+            int trips = (int)in.get(4);
+            Vector<ParcelHandle> load;
+            for(int i = 0; in.ok && i < trips; i++) {
+                int s = (int)in.get(4), dest = (int)in.get(4), km = (int)in.get(4);
+                int vehicle = (int)in.get(4);
+                int n = (int)in.get(4);
+                if(!in.ok || s < 0 || s >= network.hubCount || dest < 0 || dest >= network.hubCount || n <= 0 ||
+                   vehicle < 0 || vehicle >= VEHICLE_CODES) return false;
+                load.clear();
+                for(int k = 0; k < n; k++) {
+                    ParcelHandle h = (ParcelHandle)in.get(4);
+                    if(h < 0 || h >= parcels.count() || parcels.lane[h] < 0) return false;
+                    load.push_back(h);
+                }
+                if(!in.ok) return false;
+                launchTrip(s, dest, vehicle, km, load.begin(), n);
+            }
+            return in.ok;
+        }
+        }
+        return false;
+    }
+
+    // Hash of everything a restart must bring back, for --bench-restart
+    unsigned long long stateDigest() {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        unsigned long long h = 1469598103934665603ULL;
+        auto mixIn = [&h](unsigned long long v) { h = (h ^ v) * 1099511628211ULL; };
+        TrackingRecord rec;
+        for(ParcelHandle p = 0; p < parcels.count(); p++) {
+            parcels.readRecord(p, rec);
+            mixIn(rec.key); mixIn(rec.status); mixIn(rec.atHub); mixIn(rec.legTo);
+            mixIn(rec.legCount); mixIn(rec.legDistance); mixIn(rec.totalRouteDistance); mixIn(rec.dispatchTime);
+            mixIn(parcels.lane[p]); mixIn(parcels.laneNext[p]);
+        }
+        for(int st = 0; st < STATUS_COUNT; st++) mixIn(counters.total((ParcelStatus)st));
+        for(Trip* t = firstTrip; t; t = t->nextActive) { mixIn(t->src); mixIn(t->dest); mixIn(t->arrivalTime()); mixIn(t->parcelCount); }
+        mixIn(tripsDispatched);
+        mixIn(totalSeconds);
+        mixIn(day);
+        return h;
+    }
+
+    void stop() {
+        lock_guard<MeteredMutex> lock(dataMutex);
+        running = false;
+        workCv.notify_all();
+    }
 };
 
 // =========================================================
@@ -653,15 +5852,1667 @@ void clearScreen() {
     #ifdef _WIN32
         system("cls");
     #else
-        system("clear");
+        cout << "\033[2J\033[H" << flush;    // No shell round trip per screen
     #endif
 }
 
-int main() {
-    srand(time(0));
+// Loads network.txt (writing the built-in 8-city network first if missing)
+bool initNetwork() {
+    struct stat st;
+    if(stat(NETWORK_FILE, &st) != 0) writeDefaultNetwork(NETWORK_FILE);
+    string error;
+    if(!network.load(NETWORK_FILE, NETWORK_CACHE_FILE, error)) {
+        cout << Color::RED << "[!] Failed to load road network: " << error << Color::RESET << endl;
+        return false;
+    }
+    return true;
+}
+
+// --- ROUTING BENCHMARK (--bench-routing) ---
+// Random planar road graphs: hubs scattered over a square, each joined to its
+// nearest neighbours by a road 0-30% longer than the straight line.
+struct BenchGraph {
+    Vector<int> rowStart, adj, weight;
+    Vector<float> x, y;
+
+    RoadGraph view() { return {x.size(), rowStart.begin(), adj.begin(), weight.begin(), x.begin(), y.begin()}; }
+};
+
+static void generateRoadGraph(int n, int neighbours, BenchGraph& g) {
+    const double CELL_KM = 10.0;                    // ~2 hubs per grid cell
+    int side = (int)sqrt(n / 2.0) + 1;
+    g.x.assign(n, 0); g.y.assign(n, 0);
+    Vector<int> cellHead, cellNext;
+    cellHead.assign(side * side, -1);
+    cellNext.assign(n, -1);
+    for (int i = 0; i < n; i++) {
+        g.x[i] = (float)(rand() / (RAND_MAX + 1.0) * side * CELL_KM);
+        g.y[i] = (float)(rand() / (RAND_MAX + 1.0) * side * CELL_KM);
+        int c = (int)(g.y[i] / CELL_KM) * side + (int)(g.x[i] / CELL_KM);
+        cellNext[i] = cellHead[c];
+        cellHead[c] = i;
+    }
+
+    Vector<Vector<int>> links;
+    links.assign(n, Vector<int>());
+    Vector<int> best;
+    Vector<double> bestDist;
+    for (int i = 0; i < n; i++) {
+        best.clear(); bestDist.clear();
+        int cx = (int)(g.x[i] / CELL_KM), cy = (int)(g.y[i] / CELL_KM);
+        for (int yy = cy - 1; yy <= cy + 1; yy++) {
+            for (int xx = cx - 1; xx <= cx + 1; xx++) {
+                if (xx < 0 || yy < 0 || xx >= side || yy >= side) continue;
+                for (int j = cellHead[yy * side + xx]; j != -1; j = cellNext[j]) {
+                    if (j == i) continue;
+                    double dx = g.x[i] - g.x[j], dy = g.y[i] - g.y[j];
+                    double d = sqrt(dx * dx + dy * dy);
+                    // Keep the `neighbours` closest, insertion-sorted
+                    int pos = best.size();
+                    if (pos == neighbours && d >= bestDist[pos - 1]) continue;
+                    if (pos < neighbours) { best.push_back(j); bestDist.push_back(d); }
+                    else pos--;
+                    while (pos > 0 && bestDist[pos - 1] > d) {
+                        best[pos] = best[pos - 1]; bestDist[pos] = bestDist[pos - 1];
+                        pos--;
+                    }
+                    best[pos] = j; bestDist[pos] = d;
+                }
+            }
+        }
+        for (int k = 0; k < best.size(); k++) {
+            int j = best[k];
+            bool known = false;
+            for (int t = 0; t < links[i].size(); t++) if (links[i][t] == j) known = true;
+            if (known) continue;
+            links[i].push_back(j);
+            links[j].push_back(i);
+        }
+    }
+
+    // Two-way roads, the same length in both directions
+    g.rowStart.assign(n + 1, 0);
+    for (int i = 0; i < n; i++) g.rowStart[i + 1] = g.rowStart[i] + links[i].size();
+    g.adj.assign(g.rowStart[n], 0);
+    g.weight.assign(g.rowStart[n], 0);
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < links[i].size(); k++) {
+            int j = links[i][k];
+            int e = g.rowStart[i] + k;
+            g.adj[e] = j;
+            if (j < i) {
+                for (int t = g.rowStart[j]; t < g.rowStart[j + 1]; t++) {
+                    if (g.adj[t] == i) g.weight[e] = g.weight[t];
+                }
+            } else {
+                double dx = g.x[i] - g.x[j], dy = g.y[i] - g.y[j];
+                double km = sqrt(dx * dx + dy * dy) * (1.0 + 0.3 * rand() / (RAND_MAX + 1.0));
+                g.weight[e] = (int)ceil(km) > 0 ? (int)ceil(km) : 1;
+            }
+        }
+    }
+}
+
+struct BenchResult {
+    double avgUs, p99Us;
+    int mismatches;                 // Filled by the caller
+};
+
+// Times `engine` over the first `count` query pairs, recording distances
+static BenchResult timeQueries(RoutingEngine& engine, const Vector<int>& from, const Vector<int>& to,
+                               int count, Vector<int>& distances) {
+    BenchResult r = {0, 0, 0};
+    distances.clear();
+    QueryHeap latencies;                            // Min-heap by nanoseconds, for the p99
+    RoutePath path;
+    long long totalNs = 0;
+    for (int q = 0; q < count; q++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        engine.query(from[q], to[q], path);
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        totalNs += ns;
+        latencies.push(ns, q);
+        distances.push_back(path.distance);
+    }
+    int skip = (int)(count * 0.99);
+    for (int i = 0; i < skip && !latencies.isEmpty(); i++) latencies.pop();
+    r.avgUs = totalNs / 1000.0 / count;
+    r.p99Us = latencies.isEmpty() ? 0 : latencies.top().key / 1000.0;
+    return r;
+}
+
+static int countMismatches(const Vector<int>& a, const Vector<int>& b) {
+    int bad = 0;
+    for (int q = 0; q < a.size() && q < b.size(); q++) if (a[q] != b[q]) bad++;
+    return bad;
+}
+
+static void printBenchRow(const char* name, int queries, const BenchResult& r) {
+    cout << "  " << left << setw(26) << name << right << setw(7) << queries
+         << setw(12) << fixed << setprecision(1) << r.avgUs
+         << setw(12) << r.p99Us;
+    if (r.mismatches) cout << Color::RED << "  " << r.mismatches << " WRONG" << Color::RESET;
+    cout << "\n";
+}
+
+int runRoutingBenchmark() {
+    const int SIZES[] = {1000, 10000, 100000};
+    const int FAST_QUERIES = 1000;
+    srand(12345);                                   // Same graphs every run
+
+    bool allAgree = true;
+    for (int size : SIZES) {
+        BenchGraph g;
+        generateRoadGraph(size, 3, g);
+        RoadGraph view = g.view();
+
+        Vector<int> from, to;
+        for (int q = 0; q < FAST_QUERIES; q++) {
+            from.push_back(rand() % size);
+            to.push_back(rand() % size);
+        }
+        // Full Dijkstra is O(n log n) per query: keep its share to ~2 s
+        int slowQueries = size <= 1000 ? FAST_QUERIES : (size <= 10000 ? 200 : 20);
+
+        ContractionHierarchy chRouter;
+        chRouter.build(view);
+        DijkstraRouter dijkstra(view);
+        BidirectionalAStarRouter astar(view);
+
+        cout << "\n" << Color::YELLOW << size << " hubs, " << g.adj.size() / 2 << " roads" << Color::RESET
+             << "  (CH preprocessing " << fixed << setprecision(2) << chRouter.buildSeconds << " s, "
+             << chRouter.shortcutCount << " shortcuts)\n";
+        cout << "  " << left << setw(26) << "Engine" << right << setw(7) << "Queries"
+             << setw(12) << "Avg (us)" << setw(12) << "p99 (us)" << "\n";
+
+        // Dijkstra is the reference for the pairs it runs; A* and CH run them
+        // all and must also agree with each other on the rest
+        Vector<int> dijkstraDist, astarDist, chDist;
+        BenchResult base = timeQueries(dijkstra, from, to, slowQueries, dijkstraDist);
+        printBenchRow(dijkstra.name(), slowQueries, base);
+
+        BenchResult a = timeQueries(astar, from, to, FAST_QUERIES, astarDist);
+        a.mismatches = countMismatches(dijkstraDist, astarDist);
+        printBenchRow(astar.name(), FAST_QUERIES, a);
+
+        BenchResult c = timeQueries(chRouter, from, to, FAST_QUERIES, chDist);
+        c.mismatches = countMismatches(astarDist, chDist) + countMismatches(dijkstraDist, chDist);
+        printBenchRow(chRouter.name(), FAST_QUERIES, c);
+
+        if (a.mismatches || c.mismatches) allAgree = false;
+    }
+    cout << "\n" << (allAgree ? Color::GREEN : Color::RED)
+         << (allAgree ? "All engines agree on every distance." : "Engines disagree, see WRONG rows.")
+         << Color::RESET << endl;
+    return allAgree ? 0 : 1;
+}
+
+// --- ALLOCATOR BENCHMARK (--bench-allocator) ---
+// Packs generated lanes (1-60 kg parcels, random priority) into a given
+// fleet and reports vehicles used, how full they are and packing throughput.
+struct AllocatorCase {
+    const char* name;
+    int lanes;
+    int parcelsPerLane;
+    int fleet[VEHICLE_TYPES];
+};
+
+int runAllocatorBenchmark() {
+    const AllocatorCase CASES[] = {
+        {"1 lane x 10k, ample fleet", 1, 10000, {100, 100, 200}},
+        {"1 lane x 10k, short fleet", 1, 10000, {10, 10, 20}},
+        {"1 lane x 100k", 1, 100000, {500, 500, 2000}},
+        {"1 lane x 1M", 1, 1000000, {5000, 5000, 20000}},
+        {"500 lanes x 40", 500, 40, {300, 300, 300}},
+    };
+    const int PARCELS_PER_CASE = 2000000;           // Repeat small cases to time ~this many
+    srand(777);
+
+    cout << Color::CYAN << "[BENCH] Vehicle allocator (first-fit decreasing)" << Color::RESET << "\n";
+    cout << "  " << left << setw(28) << "Case" << right << setw(9) << "Parcels" << setw(10) << "Vehicles"
+         << setw(8) << "Fill %" << setw(9) << "Left" << setw(11) << "ms/pack" << setw(13) << "M parcels/s" << "\n";
+
+    for (const AllocatorCase& c : CASES) {
+        int total = c.lanes * c.parcelsPerLane;
+        Vector<int> weight, priority;
+        for (int i = 0; i < total; i++) {
+            weight.push_back(1 + rand() % 60);
+            priority.push_back(1 + rand() % 3);
+        }
+        int reps = max(1, PARCELS_PER_CASE / total);
+
+        VehicleAllocator allocator;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            allocator.reset();
+            for (int l = 0; l < c.lanes; l++) {
+                int lane = allocator.addLane();
+                for (int i = l * c.parcelsPerLane; i < (l + 1) * c.parcelsPerLane; i++) allocator.add(lane, i, weight[i], priority[i]);
+            }
+            int available[VEHICLE_TYPES] = {c.fleet[0], c.fleet[1], c.fleet[2]};
+            allocator.pack(available);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        long long load = 0, capacity = 0;
+        int leftover = 0;
+        for (const VehicleAllocator::Load& l : allocator.loads) {
+            load += l.weight;
+            capacity += l.convoy ? l.weight : VEHICLE_CAPACITY[l.vehicle];
+        }
+        for (int l = 0; l < allocator.laneCount(); l++) leftover += allocator.leftoverCount(l);
+
+        cout << "  " << left << setw(28) << c.name << right << setw(9) << total << setw(10) << allocator.loads.size()
+             << setw(8) << fixed << setprecision(1) << (capacity ? 100.0 * load / capacity : 0) << setw(9) << leftover
+             << setw(11) << setprecision(3) << seconds * 1000 / reps
+             << setw(13) << setprecision(2) << (double)total * reps / seconds / 1e6 << "\n";
+    }
+    return 0;
+}
+
+// --- HEADLESS SIMULATION (--headless) ---
+// Drives the engine from this thread with random bookings spread over each
+// day, no customer panel. In discrete-event mode a month runs in seconds.
+// Runs `days` simulated days with random bookings; returns rejected bookings
+long long simulateDays(Engine& engine, int days, int parcelsPerDay, const SimClock& clock) {
+    int hubs = network.hubCount;
+    int offices = network.officeNames.size();
+
+    // Bookings per second of the current day
+    Vector<int> bookingsAt;
+    auto planDay = [&]() {
+        bookingsAt.assign(SECONDS_PER_DAY, 0);
+        for(int k = 0; k < parcelsPerDay; k++) bookingsAt[rand() % SECONDS_PER_DAY]++;
+    };
+    planDay();
+
+    long long end = (long long)days * SECONDS_PER_DAY;
+    long long now = engine.simTime();
+    long long dayStart = now;
+    long long rejected = 0;
+    while(now < end) {
+        // Bookings land after the events of their second, like panel input
+        int sec = (int)(now - dayStart);
+        for(int k = 0; k < bookingsAt[sec]; k++) {
+            int sc = rand() % hubs;
+            int dc = hubs > 1 ? (sc + 1 + rand() % (hubs - 1)) % hubs : sc;
+            if(!engine.bookSilently(sc, rand() % offices, dc, rand() % offices, 1 + rand() % 60, 1 + rand() % 3)) rejected++;
+        }
+        bookingsAt[sec] = 0;
+
+        long long next = clock.jumps() ? engine.nextEventTime() : now + 1;
+        for(int s = sec + 1; s < SECONDS_PER_DAY && dayStart + s < next; s++) {
+            if(bookingsAt[s]) { next = dayStart + s; break; }
+        }
+        if(next > end) next = end;
+        clock.waitUntil(next);
+        if(!clock.jumps()) engine.noteTickLag(clock.lateNs(next));
+        engine.advanceTo(next);
+        now = next;
+        if(now - dayStart >= SECONDS_PER_DAY) {
+            dayStart += SECONDS_PER_DAY;
+            planDay();
+        }
+    }
+    return rejected;
+}
+
+int runHeadless(Engine& engine, int days, int parcelsPerDay, ClockMode mode, double speed, bool tickStats) {
+    SimClock clock(mode, speed, engine.simTime());
+    engine.setPublishState(false);
+    engine.setTickBudget(clock);
+    cout << Color::CYAN << "[HEADLESS] " << days << " days, " << parcelsPerDay << " parcels/day, "
+         << network.hubCount << " hubs, " << clock.describe() << " clock" << Color::RESET << endl;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long first = engine.simTime();             // Past 0 when resuming (--durable)
+    long long rejected = simulateDays(engine, days, parcelsPerDay, clock);
+    long long end = max(0LL, (long long)days * SECONDS_PER_DAY - first);
+
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    engine.publishNow();
+    long long counts[STATUS_COUNT];
+    long long byPriority[3][STATUS_COUNT];
+    long long trips;
+    int onRoad;
+    engine.collectStats(counts, byPriority, trips, onRoad);
+
+    cout << Color::GREEN << "[HEADLESS] Simulated " << end << " s in " << fixed << setprecision(2) << wall
+         << " s wall time (" << setprecision(0) << (wall > 0 ? end / wall : 0) << " sim-seconds/s)" << Color::RESET << endl;
+    cout << "  " << left << setw(12) << "Status" << right << setw(10) << "All" << setw(10) << "P1" << setw(10) << "P2" << setw(10) << "P3" << "\n";
+    for(int i = 0; i < STATUS_COUNT; i++) {
+        cout << "  " << left << setw(12) << STATUS_NAMES[i] << right << setw(10) << counts[i];
+        for(int p = 0; p < 3; p++) cout << setw(10) << byPriority[p][i];
+        cout << "\n";
+    }
+    cout << "  " << left << setw(12) << "Trips" << right << setw(10) << trips << "  (" << onRoad << " still on the road)\n";
+    long long dispatchRuns;
+    double avgMs, maxMs;
+    engine.dispatchTiming(dispatchRuns, avgMs, maxMs);
+    cout << "  " << left << setw(12) << "Dispatch" << right << setw(10) << dispatchRuns << " runs, avg " << setprecision(2)
+         << avgMs << " ms, max " << maxMs << " ms on " << engine.dispatchThreads() << " thread(s)\n";
+    if(tickStats) {                                 // Wall-clock figures, so only on request (--metrics-ms)
+        double tickP99Ms, tickMaxMs;
+        long long overruns, contended;
+        engine.metricsSummary(tickP99Ms, tickMaxMs, overruns, contended);
+        cout << "  " << left << setw(12) << "Ticks" << right << setw(10) << "" << " p99 " << setprecision(3) << tickP99Ms
+             << " ms, max " << tickMaxMs << " ms, " << overruns << " over budget, " << contended << " contended locks\n";
+    }
+    if(rejected) cout << "  " << left << setw(12) << "Rejected" << right << setw(10) << rejected << "\n";
+    const AsyncLogger& log = engine.eventLog();
+    if(log.eventsDropped()) cout << Color::RED << "  " << log.eventsDropped() << " log events dropped (logger ring full)" << Color::RESET << "\n";
+    return 0;
+}
+
+// --- BULK MANIFEST IMPORT (--import) ---
+// Streams a manifest into the engine IMPORT_BATCH rows at a time, taking
+// dataMutex once per batch, and reports throughput and rejected rows.
+const int IMPORT_BATCH = 4096;
+
+// Returns the number of parcels booked, or -1 if the file could not be read
+long long importManifest(Engine& engine, const char* path) {
+    ManifestReader reader;
+    string error;
+    if(!reader.open(path, error)) {
+        cout << Color::RED << "[!] Import failed: " << error << Color::RESET << endl;
+        return -1;
+    }
+
+    Vector<ManifestRow> batch;
+    batch.assign(IMPORT_BATCH, ManifestRow());
+    string source = path;
+    long long booked = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int n;
+    while((n = reader.next(&batch[0], IMPORT_BATCH)) > 0) {
+        int done = engine.bookBatch(&batch[0], n, source);
+        booked += done;
+        for(int i = done; i < n; i++) reader.reject(batch[i].line, REJECT_STORE_FULL);
+    }
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << Color::GREEN << "[IMPORT] " << path << " (" << (reader.isBinary() ? "binary" : "CSV") << "): booked " << booked
+         << " of " << reader.rows << " rows in " << fixed << setprecision(2) << wall << " s (" << setprecision(0)
+         << (wall > 0 ? reader.rows / wall : 0) << " rows/s, " << setprecision(1)
+         << (wall > 0 ? reader.bytesRead / wall / (1 << 20) : 0) << " MB/s)" << Color::RESET << endl;
+    long long rejected = reader.rejectedRows();
+    if(rejected) {
+        cout << Color::RED << "  " << left << setw(14) << "Rejected" << right << setw(10) << rejected << Color::RESET << "\n";
+        for(int i = 0; i < REJECT_REASONS; i++)
+            if(reader.rejected[i]) cout << "    " << left << setw(12) << REJECT_NAMES[i] << right << setw(10) << reader.rejected[i] << "\n";
+        cout << "  First rejected:";
+        for(int i = 0; i < reader.sampleCount; i++)
+            cout << (i ? ", " : " ") << (reader.isBinary() ? "record " : "line ") << reader.samples[i].line << " (" << REJECT_NAMES[reader.samples[i].reason] << ")";
+        cout << "\n";
+    }
+    return booked;
+}
+
+// --- TRACKING LATENCY BENCHMARK (--bench-tracking) ---
+// Reader threads track random booked parcels while the sim thread runs a
+// heavy discrete-event load. Each lookup is filed under "dispatch" if
+// dispatchLogic ran at any point during it, else "idle". The lock-free path
+// passes if its dispatch p99 stays within a small factor of its idle p99;
+// the old locked copy is run the same way for comparison.
+struct TrackingSamples {
+    Vector<long long> idleNs, dispatchNs;
+};
+
+struct LatencySummary {
+    int count;
+    double p50Us, p99Us, maxUs;
+};
+
+static void trackingReader(Engine* engine, bool locked, unsigned seed, const atomic<bool>* stop, TrackingSamples* out) {
+    const int MAX_SAMPLES = 1 << 20;                // Per bucket, per reader
+    TrackingRecord rec;
+    long long now;
+    string id;
+    unsigned r = seed;
+    while(!stop->load(memory_order_relaxed)) {
+        r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+        if(!engine->sampleTrackingId(r, id)) { this_thread::yield(); continue; }
+        unsigned phase = engine->currentDispatchPhase();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if(locked) engine->lookupParcelLocked(id, rec, now);
+        else engine->lookupParcel(id, rec, now);
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        bool duringDispatch = (phase & 1) || engine->currentDispatchPhase() != phase;
+        Vector<long long>& bucket = duringDispatch ? out->dispatchNs : out->idleNs;
+        if(bucket.size() < MAX_SAMPLES) bucket.push_back(ns);
+    }
+}
+
+static LatencySummary summarizeLatencies(const TrackingSamples* samples, int readers, bool dispatch) {
+    QueryHeap heap;                                 // Min-heap by nanoseconds
+    for(int t = 0; t < readers; t++) {
+        const Vector<long long>& ns = dispatch ? samples[t].dispatchNs : samples[t].idleNs;
+        for(int i = 0; i < ns.size(); i++) heap.push(ns[i], i);
+    }
+    int total = 0;
+    for(int t = 0; t < readers; t++) total += dispatch ? samples[t].dispatchNs.size() : samples[t].idleNs.size();
+
+    // Pop in ascending order, noting the ranks we want
+    long long p50 = 0, p99 = 0, last = 0;
+    for(int n = 1; !heap.isEmpty(); n++) {
+        last = heap.top().key;
+        heap.pop();
+        if(n == (total + 1) / 2) p50 = last;
+        if(n == (int)ceil(total * 0.99)) p99 = last;
+    }
+    return {total, p50 / 1000.0, p99 / 1000.0, last / 1000.0};
+}
+
+static void printLatencyRow(const char* name, const LatencySummary& s) {
+    cout << "  " << left << setw(24) << name << right << setw(10) << s.count
+         << setw(11) << fixed << setprecision(2) << s.p50Us
+         << setw(11) << s.p99Us << setw(12) << s.maxUs << "\n";
+}
+
+// One fresh engine per path so both see the same bookings and dispatches
+static void measureTracking(bool locked, int days, int parcelsPerDay, int readers,
+                            LatencySummary& idle, LatencySummary& dispatch) {
+    srand(4242);
     Engine engine;
+    engine.setPublishState(false);
+    SimClock clock(CLOCK_DISCRETE_EVENT, 1, 0);
+
+    atomic<bool> stop(false);
+    TrackingSamples* samples = new TrackingSamples[readers];
+    Vector<thread*> threads;
+    for(int t = 0; t < readers; t++)
+        threads.push_back(new thread(trackingReader, &engine, locked, 0x9E3779B9u * (t + 1), &stop, &samples[t]));
+    simulateDays(engine, days, parcelsPerDay, clock);
+    stop = true;
+    for(int t = 0; t < readers; t++) { threads[t]->join(); delete threads[t]; }
+
+    idle = summarizeLatencies(samples, readers, false);
+    dispatch = summarizeLatencies(samples, readers, true);
+    delete[] samples;
+}
+
+int runTrackingBenchmark() {
+    const int DAYS = 4;
+    const int PARCELS_PER_DAY = 100000;
+    const int READERS = 2;
+    const double MAX_P99_RATIO = 3.0;               // Dispatch p99 vs idle p99
+    const double P99_FLOOR_US = 5.0;                // Below this, timer noise dominates
+
+    cout << Color::CYAN << "[BENCH] Tracking latency: " << READERS << " readers, " << DAYS << " days x "
+         << PARCELS_PER_DAY << " parcels/day, " << network.hubCount << " hubs, "
+         << thread::hardware_concurrency() << " CPUs" << Color::RESET << "\n";
+    cout << "  " << left << setw(24) << "Path / phase" << right << setw(10) << "Lookups"
+         << setw(11) << "p50 (us)" << setw(11) << "p99 (us)" << setw(12) << "max (us)" << "\n";
+
+    LatencySummary freeIdle, freeDispatch, lockedIdle, lockedDispatch;
+    measureTracking(false, DAYS, PARCELS_PER_DAY, READERS, freeIdle, freeDispatch);
+    printLatencyRow("lock-free / idle", freeIdle);
+    printLatencyRow("lock-free / dispatch", freeDispatch);
+    measureTracking(true, DAYS, PARCELS_PER_DAY, READERS, lockedIdle, lockedDispatch);
+    printLatencyRow("locked    / idle", lockedIdle);
+    printLatencyRow("locked    / dispatch", lockedDispatch);
+
+    bool sampled = freeIdle.count > 0 && freeDispatch.count > 0;
+    bool flat = sampled && freeDispatch.p99Us <= max(freeIdle.p99Us * MAX_P99_RATIO, P99_FLOOR_US);
+    if(!sampled) cout << Color::RED << "[FAIL] No lookups overlapped a dispatch; raise the load." << Color::RESET << endl;
+    else if(flat) cout << Color::GREEN << "[PASS] Lock-free tracking p99 stays flat while dispatch runs." << Color::RESET << endl;
+    else cout << Color::RED << "[FAIL] Lock-free tracking p99 during dispatch exceeds " << MAX_P99_RATIO
+              << "x the idle p99." << Color::RESET << endl;
+    return flat ? 0 : 1;
+}
+
+// --- EVENT LOG QUERY (--query) ---
+// Answers questions from events.bin without the engine, e.g.
+//   --query --where type=CRITICAL --by city,day
+//   --query --where type=DEFER --by lane --sum kg
+//   --query --where city=Lahore,day=3-5 --text
+// "day" counts from the first day of the log (1, 2, ...), unlike the
+// weekday in the text lines. Blocks whose tick range or types cannot match
+// are skipped without decoding, and only the columns the query reads are
+// decoded. Groups are keyed by the ids packed into one u64.
+enum QueryField { Q_CITY, Q_PEER, Q_DAY, Q_TYPE, Q_VEHICLE, QUERY_FIELDS };
+const char* const QUERY_FIELD_NAMES[QUERY_FIELDS] = {"city", "peer", "day", "type", "vehicle"};
+const int QUERY_FIELD_BITS[QUERY_FIELDS] = {17, 17, 20, 4, 4};     // 62 bits with every field
+
+struct EventQuery {
+    string path;
+    unsigned typeMask;
+    Vector<string> cities, peers, vehicles;     // Names or ids; empty = any
+    long long firstDay, lastDay;
+    Vector<int> groupBy;                        // QueryFields, most significant first
+    int sumColumn;                              // COL_KG, COL_PARCELS or -1
+    bool text;
+};
+
+static bool sameName(const string& a, const string& b) {
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); i++) if(tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    return true;
+}
+
+static void splitList(const string& s, char sep, Vector<string>& out) {
+    size_t start = 0;
+    while(start <= s.size()) {
+        size_t end = s.find(sep, start);
+        if(end == string::npos) end = s.size();
+        if(end > start) out.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+static bool parseWhere(const string& where, EventQuery& q, string& error) {
+    Vector<string> terms;
+    splitList(where, ',', terms);
+    for(const string& term : terms) {
+        size_t eq = term.find('=');
+        if(eq == string::npos) { error = "expected field=value in \"" + term + "\""; return false; }
+        string field = term.substr(0, eq);
+        Vector<string> values;
+        splitList(term.substr(eq + 1), '|', values);
+        if(values.empty()) { error = "no value for " + field; return false; }
+        if(field == "type") {
+            q.typeMask = 0;
+            for(const string& v : values) {
+                int t = 0;
+                while(t < EVENT_TYPES && !sameName(v, EVENT_NAMES[t])) t++;
+                if(t == EVENT_TYPES) { error = "unknown event type " + v; return false; }
+                q.typeMask |= 1u << t;
+            }
+        } else if(field == "city") {
+            for(const string& v : values) q.cities.push_back(v);
+        } else if(field == "peer") {
+            for(const string& v : values) q.peers.push_back(v);
+        } else if(field == "vehicle") {
+            for(const string& v : values) q.vehicles.push_back(v);
+        } else if(field == "day") {
+            const string& v = values[0];
+            size_t dash = v.find('-');
+            q.firstDay = atoll(v.c_str());
+            q.lastDay = dash == string::npos ? q.firstDay : atoll(v.c_str() + dash + 1);
+            if(q.firstDay < 1 || q.lastDay < q.firstDay) { error = "bad day range " + v; return false; }
+        } else {
+            error = "unknown field " + field;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ok[id + 1] for each id of `names` the values pick; ok[0] is "no value",
+// named `none`. Empty values pick everything.
+static void resolveNames(const Vector<string>& values, const Vector<string>& names, const char* none, Vector<char>& ok) {
+    ok.assign(names.size() + 1, values.empty() ? 1 : 0);
+    for(const string& v : values) {
+        bool numeric = !v.empty() && v.find_first_not_of("0123456789") == string::npos;
+        if(sameName(v, none)) ok[0] = 1;
+        for(int id = 0; id < names.size(); id++)
+            if(numeric ? atoi(v.c_str()) == id : sameName(v, names[id])) ok[id + 1] = 1;
+    }
+}
+
+// Index of `name` in `names`, added if new; ids usually match the last run's
+static int internName(Vector<string>& names, const string& name, int hint) {
+    if(hint < names.size() && names[hint] == name) return hint;
+    for(int i = 0; i < names.size(); i++) if(names[i] == name) return i;
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+struct QueryGroups {
+    ParcelHashTable index;          // Key -> row
+    Vector<unsigned long long> keys;
+    Vector<long long> events, sums;
+    unsigned long long lastKey;     // Consecutive events mostly share a group
+    int lastRow;
+
+    QueryGroups() : lastKey(~0ULL), lastRow(-1) {}
+
+    void add(unsigned long long key, long long value) {
+        if(key != lastKey) {
+            ParcelHandle row = index.search(key);
+            if(row == NO_PARCEL) {
+                row = keys.size();
+                index.insert(key, row);
+                keys.push_back(key);
+                events.push_back(0);
+                sums.push_back(0);
+            }
+            lastKey = key;
+            lastRow = row;
+        }
+        events[lastRow]++;
+        sums[lastRow] += value;
+    }
+
+    // Row numbers in key order (bottom-up merge sort)
+    void sorted(Vector<int>& order) {
+        int n = keys.size();
+        Vector<int> buffer;
+        order.assign(n, 0);
+        buffer.assign(n, 0);
+        for(int i = 0; i < n; i++) order[i] = i;
+        int* src = order.begin();
+        int* dst = buffer.begin();
+        for(int width = 1; width < n; width *= 2) {
+            for(int lo = 0; lo < n; lo += 2 * width) {
+                int mid = min(lo + width, n), hi = min(lo + 2 * width, n);
+                int i = lo, j = mid, k = lo;
+                while(i < mid && j < hi) dst[k++] = keys[src[j]] < keys[src[i]] ? src[j++] : src[i++];
+                while(i < mid) dst[k++] = src[i++];
+                while(j < hi) dst[k++] = src[j++];
+            }
+            int* t = src; src = dst; dst = t;
+        }
+        if(src != order.begin()) for(int i = 0; i < n; i++) order[i] = src[i];
+    }
+};
+
+static void printQueryUsage() {
+    cout << "Usage: --query [--log FILE] [--where FIELD=A|B,...] [--by FIELD,...] [--sum events|kg|parcels] [--text]\n"
+         << "  --where  type=NAME (BOOKING, DISPATCH, CRITICAL, ...), city=, peer=, vehicle= (name or id),\n"
+         << "           day=A or day=A-B (days of the log, from 1)\n"
+         << "  --by     city, peer, lane (city and peer), day, type, vehicle; without it, one total\n"
+         << "  --text   print the matching events as notifications.txt lines instead\n";
+}
+
+int runQuery(int argc, char** argv) {
+    EventQuery q;
+    q.path = EVENT_LOG_FILE;
+    q.typeMask = (1u << EVENT_TYPES) - 1;
+    q.firstDay = 1;
+    q.lastDay = LLONG_MAX / SECONDS_PER_DAY;
+    q.sumColumn = -1;
+    q.text = false;
+    string error;
+    for(int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--log" && hasValue) q.path = argv[++i];
+        else if(arg == "--where" && hasValue) { if(!parseWhere(argv[++i], q, error)) break; }
+        else if(arg == "--by" && hasValue) {
+            Vector<string> fields;
+            splitList(argv[++i], ',', fields);
+            for(const string& f : fields) {
+                if(f == "lane") { q.groupBy.push_back(Q_CITY); q.groupBy.push_back(Q_PEER); continue; }
+                int k = 0;
+                while(k < QUERY_FIELDS && f != QUERY_FIELD_NAMES[k]) k++;
+                if(k == QUERY_FIELDS) { error = "cannot group by " + f; break; }
+                q.groupBy.push_back(k);
+            }
+            if(!error.empty()) break;
+        }
+        else if(arg == "--sum" && hasValue) {
+            string m = argv[++i];
+            if(m == "kg") q.sumColumn = COL_KG;
+            else if(m == "parcels") q.sumColumn = COL_PARCELS;
+            else if(m != "events") { error = "cannot sum " + m; break; }
+        }
+        else if(arg == "--text") q.text = true;
+        else { error = "unknown or incomplete option " + arg; break; }
+    }
+    for(int a = 0; a < q.groupBy.size() && error.empty(); a++)
+        for(int b = 0; b < a; b++) if(q.groupBy[a] == q.groupBy[b]) error = string("grouped by ") + QUERY_FIELD_NAMES[q.groupBy[a]] + " twice";
+    if(!error.empty()) {
+        cout << Color::RED << "[!] Query: " << error << Color::RESET << "\n";
+        printQueryUsage();
+        return 1;
+    }
+
+    MappedFile file;
+    size_t size = 0;
+    void* image = file.openPrivate(q.path.c_str(), size);
+    EventLogReader reader(image, size);
+    if(!image || !reader.valid()) {
+        cout << Color::RED << "[!] " << q.path << " is missing or not an event log." << Color::RESET << endl;
+        return 1;
+    }
+
+    bool uses[QUERY_FIELDS] = {};
+    for(int f : q.groupBy) uses[f] = true;
+    bool dayFilter = q.firstDay > 1 || q.lastDay < LLONG_MAX / SECONDS_PER_DAY;
+    bool typeFilter = q.typeMask != (1u << EVENT_TYPES) - 1;
+    long long firstTick = (q.firstDay - 1) * SECONDS_PER_DAY, lastTick = q.lastDay * SECONDS_PER_DAY - 1;
+
+    Vector<char> cityOk, peerOk, vehicleOk;
+    Vector<string> hubNames, vehicleNames;      // Across every dictionary in the file
+    Vector<int> hubRemap, vehicleRemap;         // This dictionary's id + 1 -> index + 1 above
+    QueryGroups groups;
+    char* out = q.text ? new char[1 << 16] : nullptr;
+    int outUsed = 0;
+    LogEvent e;
+    long long blocks = 0, skipped = 0, scanned = 0, matched = 0;
+    int dictionary = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    while(reader.next()) {
+        blocks++;
+        if(!(reader.typeMask & q.typeMask) || reader.lastTick < firstTick || reader.firstTick > lastTick) { skipped++; continue; }
+        if(dictionary != reader.dictionaries) {
+            dictionary = reader.dictionaries;
+            const EventDictionary& dict = reader.dictionary;
+            resolveNames(q.cities, dict.hubs, "SYSTEM", cityOk);
+            resolveNames(q.peers, dict.hubs, "SYSTEM", peerOk);
+            resolveNames(q.vehicles, dict.vehicles, "none", vehicleOk);
+            hubRemap.assign(dict.hubs.size() + 1, 0);
+            for(int id = 0; id < dict.hubs.size(); id++) hubRemap[id + 1] = internName(hubNames, dict.hubs[id], id) + 1;
+            vehicleRemap.assign(dict.vehicles.size() + 1, 0);
+            for(int id = 0; id < dict.vehicles.size(); id++) vehicleRemap[id + 1] = internName(vehicleNames, dict.vehicles[id], id) + 1;
+        }
+        bool blockTyped = typeFilter && (reader.typeMask & ~q.typeMask);
+        const long long* tick = dayFilter || uses[Q_DAY] ? reader.column(COL_TICK) : nullptr;
+        const long long* type = blockTyped || uses[Q_TYPE] ? reader.column(COL_TYPE) : nullptr;
+        const long long* city = !q.cities.empty() || uses[Q_CITY] ? reader.column(COL_CITY) : nullptr;
+        const long long* peer = !q.peers.empty() || uses[Q_PEER] ? reader.column(COL_PEER) : nullptr;
+        const long long* vehicle = !q.vehicles.empty() || uses[Q_VEHICLE] ? reader.column(COL_VEHICLE) : nullptr;
+        const long long* sum = q.sumColumn >= 0 ? reader.column(q.sumColumn) : nullptr;
+        if(reader.isDamaged()) break;
+        scanned++;
+
+        for(int i = 0; i < reader.count; i++) {
+            if(blockTyped && !(q.typeMask >> type[i] & 1)) continue;
+            if(dayFilter && (tick[i] < firstTick || tick[i] > lastTick)) continue;
+            if(!q.cities.empty() && !(city[i] + 1 < cityOk.size() && cityOk[city[i] + 1])) continue;
+            if(!q.peers.empty() && !(peer[i] + 1 < peerOk.size() && peerOk[peer[i] + 1])) continue;
+            if(!q.vehicles.empty() && !(vehicle[i] + 1 < vehicleOk.size() && vehicleOk[vehicle[i] + 1])) continue;
+            matched++;
+            if(q.text) {
+                if(!reader.event(i, e)) break;
+                if(outUsed > (1 << 16) - 1024) { cout.write(out, outUsed); outUsed = 0; }
+                outUsed += renderEvent(e, reader.dictionary, out + outUsed, 1024);
+                continue;
+            }
+            unsigned long long key = 0;
+            for(int f : q.groupBy) {
+                long long v = 0;
+                if(f == Q_CITY) v = city[i] + 1 < hubRemap.size() ? hubRemap[city[i] + 1] : 0;
+                else if(f == Q_PEER) v = peer[i] + 1 < hubRemap.size() ? hubRemap[peer[i] + 1] : 0;
+                else if(f == Q_DAY) v = tick[i] / SECONDS_PER_DAY + 1;
+                else if(f == Q_TYPE) v = type[i];
+                else v = vehicle[i] + 1 < vehicleRemap.size() ? vehicleRemap[vehicle[i] + 1] : 0;
+                key = key << QUERY_FIELD_BITS[f] | ((unsigned long long)v & ((1ULL << QUERY_FIELD_BITS[f]) - 1));
+            }
+            groups.add(key, sum ? sum[i] : 0);
+        }
+        if(reader.isDamaged()) break;
+    }
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if(q.text) {
+        cout.write(out, outUsed);
+        delete[] out;
+    }
+    if(reader.isDamaged()) cout << Color::RED << "[!] " << q.path << " is damaged after block " << blocks << "; later events are not counted." << Color::RESET << endl;
+    ostream& stats = q.text ? cerr : cout;
+    if(!q.text) {
+        const char* sumName = q.sumColumn == COL_KG ? "Kg" : "Parcels";
+        cout << "\n ";
+        for(int f : q.groupBy) cout << " " << left << setw(f == Q_DAY || f == Q_TYPE ? 10 : 16) << QUERY_FIELD_NAMES[f];
+        cout << right << setw(12) << "Events";
+        if(q.sumColumn >= 0) cout << setw(14) << sumName;
+        cout << "\n";
+        Vector<int> order;
+        groups.sorted(order);
+        for(int row : order) {
+            cout << " ";
+            int shift = 0;
+            for(int g = q.groupBy.size() - 1; g >= 0; g--) shift += QUERY_FIELD_BITS[q.groupBy[g]];
+            for(int f : q.groupBy) {
+                shift -= QUERY_FIELD_BITS[f];
+                long long v = (long long)(groups.keys[row] >> shift & ((1ULL << QUERY_FIELD_BITS[f]) - 1));
+                string cell;
+                if(f == Q_CITY || f == Q_PEER) cell = v ? hubNames[v - 1] : "SYSTEM";
+                else if(f == Q_VEHICLE) cell = v ? vehicleNames[v - 1] : "-";
+                else if(f == Q_TYPE) cell = v < EVENT_TYPES ? EVENT_NAMES[v] : "?";
+                else cell = to_string(v);
+                cout << " " << left << setw(f == Q_DAY || f == Q_TYPE ? 10 : 16) << cell;
+            }
+            cout << right << setw(12) << groups.events[row];
+            if(q.sumColumn >= 0) cout << setw(14) << groups.sums[row];
+            cout << "\n";
+        }
+    }
+    stats << "\n" << matched << " events matched";
+    if(!q.text) stats << " in " << groups.keys.size() << " groups";
+    stats << ". Read " << fixed << setprecision(1)
+          << size / (double)(1 << 20) << " MB in " << setprecision(1) << wall * 1000 << " ms (" << setprecision(0)
+          << (wall > 0 ? size / wall / (1 << 20) : 0) << " MB/s); " << skipped << " of " << blocks << " blocks skipped by their zone maps.\n";
+    return reader.isDamaged() ? 1 : 0;
+}
+
+// --- CRASH RECOVERY (--durable, --bench-restart) ---
+// --durable keeps recovery.snap and recovery.wal in the working directory:
+// a restart after a crash (or a clean exit, which writes a final snapshot)
+// resumes the simulation where it stopped.
+bool openRecovery(Engine& engine, int snapshotDays) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long restored, replayed;
+    string error;
+    if(!engine.openDurableState(RECOVERY_SNAP_FILE, RECOVERY_WAL_FILE, snapshotDays, restored, replayed, error)) {
+        cout << Color::RED << "[!] Recovery failed: " << error << ". Move the recovery files away to start over." << Color::RESET << endl;
+        return false;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if(restored || replayed)
+        cout << Color::GREEN << "[RECOVERY] Restored " << restored << " parcels from " << RECOVERY_SNAP_FILE << " and replayed "
+             << replayed << " log records in " << fixed << setprecision(1) << ms << " ms; resuming at second "
+             << engine.simTime() << Color::RESET << endl;
+    return true;
+}
+
+// Builds a state of `parcelCount` parcels with trips on the road, snapshots
+// it, runs one more day into the WAL, and then times a restart from those
+// files against the one-second target.
+int runRestartBenchmark(int parcelCount) {
+    const char* SNAP = "bench-recovery.snap";
+    const char* WAL = "bench-recovery.wal";
+    const double TARGET_MS = 1000;
+    int tailPerDay = parcelCount / 100;
+    remove(SNAP);
+    remove(WAL);
+
+    cout << Color::CYAN << "[BENCH] Restart: " << parcelCount << " parcels, " << network.hubCount << " hubs" << Color::RESET << "\n";
+    long long restored, replayed;
+    string error;
+    unsigned long long expected;
+    {
+        Engine engine;
+        engine.setPublishState(false);
+        engine.setCheckpointOnExit(false);              // Leave the WAL tail for the restart
+        if(!engine.openDurableState(SNAP, WAL, 0, restored, replayed, error)) {
+            cout << Color::RED << "[!] " << error << Color::RESET << endl;
+            return 1;
+        }
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        Vector<ManifestRow> batch;
+        batch.assign(IMPORT_BATCH, ManifestRow());
+        int hubs = network.hubCount, offices = network.officeNames.size();
+        for(int booked = 0; booked < parcelCount; ) {
+            int n = min(IMPORT_BATCH, parcelCount - booked);
+            for(int i = 0; i < n; i++) {
+                ManifestRow& r = batch[i];
+                r.src = rand() % hubs;
+                r.dest = hubs > 1 ? (r.src + 1 + rand() % (hubs - 1)) % hubs : r.src;
+                r.srcOffice = rand() % offices;
+                r.destOffice = (r.srcOffice + (r.src == r.dest)) % offices;
+                r.weight = 1 + rand() % 60;
+                r.priority = 1 + rand() % 3;
+            }
+            int done = engine.bookBatch(&batch[0], n, "bench");
+            if(done < n) break;
+            booked += done;
+        }
+        SimClock clock(CLOCK_DISCRETE_EVENT);
+        simulateDays(engine, 2, 0, clock);              // Dispatch waves and arrivals
+        double buildS = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        engine.checkpointNow();
+        double snapMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        struct stat st;
+        long long snapBytes = stat(SNAP, &st) == 0 ? (long long)st.st_size : 0;
+
+        simulateDays(engine, 3, tailPerDay, clock);     // Only in the WAL
+        expected = engine.stateDigest();
+        long long walBytes = stat(WAL, &st) == 0 ? (long long)st.st_size : 0;
+        cout << "  " << left << setw(22) << "Build state" << right << setw(10) << fixed << setprecision(2) << buildS << " s\n";
+        cout << "  " << left << setw(22) << "Snapshot write" << right << setw(10) << setprecision(0) << snapMs << " ms  ("
+             << snapBytes / (1 << 20) << " MB)\n";
+        cout << "  " << left << setw(22) << "WAL tail" << right << setw(10) << walBytes / 1024 << " KB  (1 day, "
+             << tailPerDay << " bookings)\n";
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Engine engine(true);
+    engine.setPublishState(false);
+    engine.setCheckpointOnExit(false);
+    bool ok = engine.openDurableState(SNAP, WAL, 0, restored, replayed, error);
+    double restartMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if(!ok) {
+        cout << Color::RED << "[!] " << error << Color::RESET << endl;
+        return 1;
+    }
+    bool same = engine.stateDigest() == expected;
+    cout << "  " << left << setw(22) << "Restart" << right << setw(10) << setprecision(1) << restartMs << " ms  ("
+         << restored << " parcels mapped, " << replayed << " records replayed)\n";
+    remove(SNAP);
+    remove(WAL);
+    if(!same) cout << Color::RED << "[FAIL] Restored state differs from the state before the restart." << Color::RESET << endl;
+    else if(restartMs > TARGET_MS) cout << Color::RED << "[FAIL] Restart took longer than " << TARGET_MS << " ms." << Color::RESET << endl;
+    else cout << Color::GREEN << "[PASS] Restart restores the exact state in under " << TARGET_MS << " ms." << Color::RESET << endl;
+    return same && restartMs <= TARGET_MS ? 0 : 1;
+}
+
+#ifdef __linux__
+// --- CUSTOMER SOCKET SERVER (--serve) ---
+// One epoll loop on the main thread serves every client of a Unix socket
+// while the sim thread runs. Clients may pipeline: all complete frames in a
+// read are answered in order and written back together, and a run of
+// bookings is booked under one dataMutex acquisition. Tracking never takes
+// the lock. Bookings and cancellations only try it: a client that finds it
+// taken is parked where it stopped and retried every millisecond, so one
+// long dispatch does not stall the other clients. With --durable, answers
+// from a booking or cancellation on are held until the WAL has synced
+// them; the loop waits once per round, so one sync covers every client.
+const int SERVER_IN_BYTES = 16384;          // Longest frame is 6 + 255 bytes
+const int SERVER_OUT_LIMIT = 1 << 20;       // Stop reading a client this far behind
+const int SERVER_BATCH = 256;               // Bookings per lock acquisition
+const int SERVER_MAX_EVENTS = 256;
+
+static volatile sig_atomic_t stopServing = 0;
+static void onStopSignal(int) { stopServing = 1; }
+
+// Thousands of sockets need more than the usual 1024 descriptors
+static void raiseFileLimit() {
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static bool makeSocketAddress(const char* path, sockaddr_un& addr) {
+    if(strlen(path) >= sizeof(addr.sun_path)) return false;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    return true;
+}
+
+class DeskServer {
+    struct Client {
+        int fd;
+        int slot;                   // Index in clients
+        unsigned events;            // Registered epoll interest
+        bool parked;                // Waiting for dataMutex
+        bool held;                  // Answers past outReady wait for the WAL
+        int inLen;
+        unsigned char* out;
+        int outLen, outSent, outCap;
+        int outReady;               // Bytes of out that may be sent
+        unsigned char in[SERVER_IN_BYTES];
+    };
+
+    Engine& engine;
+    string path;
+    int listenFd, epollFd;
+    bool acceptPaused;              // Out of descriptors until a client leaves
+    Vector<Client*> clients;
+    Vector<Client*> parked;
+    Vector<Client*> held;
+    unsigned long long heldUntil;   // WAL position the held answers need
+    ManifestRow rows[SERVER_BATCH];
+    TrackingKey keys[SERVER_BATCH];
+    ManifestReject reasons[SERVER_BATCH];
+
+    long long accepted;
+    long long served[OP_CANCEL + 1];    // [0] = bad requests
+    long long bookingBatches;
+    int peakClients;
+    bool changed;                   // The frames being served wrote to the WAL
+
+    // Appends an answer header and returns where its body goes
+    unsigned char* reply(Client* c, DeskResult result, int bodyLength, unsigned tag) {
+        int need = c->outLen + FRAME_HEADER_BYTES + bodyLength;
+        if(need > c->outCap) {
+            int cap = c->outCap ? c->outCap : 4096;
+            while(cap < need) cap *= 2;
+            unsigned char* grown = new unsigned char[cap];
+            memcpy(grown, c->out, c->outLen);
+            delete[] c->out;
+            c->out = grown;
+            c->outCap = cap;
+        }
+        unsigned char* p = c->out + c->outLen;
+        putFrameHeader(p, result, bodyLength, tag);
+        c->outLen = need;
+        return p + FRAME_HEADER_BYTES;
+    }
+
+    // `count` consecutive booking frames; false if dataMutex was taken
+    bool bookFrames(Client* c, const unsigned char* f, int count) {
+        const int FRAME = FRAME_HEADER_BYTES + MANIFEST_RECORD_BYTES;
+        for(int i = 0; i < count; i++) decodeBookingRecord(f + i * FRAME + FRAME_HEADER_BYTES, rows[i]);
+        if(!engine.bookRequests(rows, count, keys, reasons, false)) return false;
+        for(int i = 0; i < count; i++) {
+            unsigned tag = (unsigned)getLE(f + i * FRAME + 2, 4);
+            if(keys[i]) { putLE(reply(c, DESK_OK, KEY_BODY_BYTES, tag), keys[i], KEY_BODY_BYTES); changed = true; }
+            else reply(c, DESK_REJECTED, 1, tag)[0] = (unsigned char)reasons[i];
+        }
+        served[OP_BOOK] += count;
+        bookingBatches++;
+        return true;
+    }
+
+    // Any frame but a well-formed booking; false if dataMutex was taken
+    bool answer(Client* c, const unsigned char* f) {
+        int op = f[0];
+        unsigned tag = (unsigned)getLE(f + 2, 4);
+        if((op != OP_TRACK && op != OP_CANCEL) || f[1] != KEY_BODY_BYTES) {
+            reply(c, DESK_BAD_REQUEST, 0, tag);
+            served[0]++;
+            return true;
+        }
+        TrackingKey key = getLE(f + FRAME_HEADER_BYTES, KEY_BODY_BYTES);
+        if(op == OP_TRACK) {
+            TrackingRecord rec;
+            long long now;
+            if(engine.track(key, rec, now) == DESK_OK) encodeTracking(rec, now, reply(c, DESK_OK, TRACK_BODY_BYTES, tag));
+            else reply(c, DESK_NOT_FOUND, 0, tag);
+        } else {
+            ParcelStatus status;
+            DeskResult r = engine.cancel(key, status, false);
+            if(r == DESK_BUSY) return false;
+            if(r == DESK_OK) changed = true;
+            if(r == DESK_NOT_FOUND) reply(c, r, 0, tag);
+            else reply(c, r, 1, tag)[0] = (unsigned char)status;
+        }
+        served[op]++;
+        return true;
+    }
+
+    // Answers complete frames in order until the input runs out, the client
+    // is SERVER_OUT_LIMIT behind, or dataMutex is taken (then it is parked)
+    void serve(Client* c) {
+        int pos = 0, batchStart = 0, batched = 0;
+        bool busy = false;
+        changed = false;
+        while(true) {
+            int left = c->inLen - pos;
+            bool complete = left >= FRAME_HEADER_BYTES && left >= FRAME_HEADER_BYTES + c->in[pos + 1];
+            bool room = c->outLen - c->outSent < SERVER_OUT_LIMIT;
+            bool booking = complete && c->in[pos] == OP_BOOK && c->in[pos + 1] == MANIFEST_RECORD_BYTES;
+            if(batched && (!booking || !room || batched == SERVER_BATCH)) {
+                if(!bookFrames(c, c->in + batchStart, batched)) { pos = batchStart; busy = true; break; }
+                batched = 0;
+            }
+            if(!complete || !room) break;
+            if(booking) {
+                if(!batched) batchStart = pos;
+                batched++;
+            } else if(!answer(c, c->in + pos)) { busy = true; break; }
+            pos += FRAME_HEADER_BYTES + c->in[pos + 1];
+        }
+        c->parked = busy;
+        if(busy) parked.push_back(c);
+        memmove(c->in, c->in + pos, c->inLen - pos);
+        c->inLen -= pos;
+        if(engine.durable() && (changed || c->held)) hold(c);
+        else c->outReady = c->outLen;
+    }
+
+    void hold(Client* c) {
+        if(!c->held) held.push_back(c);
+        c->held = true;
+        heldUntil = engine.walPosition();
+    }
+
+    // Every held answer so far is durable after one wait
+    void releaseHeld() {
+        if(held.empty()) return;
+        engine.waitDurable(heldUntil);
+        Vector<Client*> ready = held;
+        held.clear();
+        for(Client* c : ready) {
+            c->held = false;
+            c->outReady = c->outLen;
+        }
+        for(int i = 0; i < ready.size(); i++) {
+            Client* c = ready[i];
+            if(c->parked) { if(!flush(c)) drop(c); else watch(c); }      // Serving resumes from the retry pass
+            else pump(c);
+        }
+    }
+
+    bool flush(Client* c) {
+        while(c->outSent < c->outReady) {
+            ssize_t sent = send(c->fd, c->out + c->outSent, c->outReady - c->outSent, MSG_NOSIGNAL);
+            if(sent < 0 && errno == EINTR) continue;
+            if(sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+            c->outSent += (int)sent;
+        }
+        if(c->outSent == c->outLen) c->outLen = c->outSent = c->outReady = 0;
+        return true;
+    }
+
+    bool hasFrame(const Client* c) const {
+        return c->inLen >= FRAME_HEADER_BYTES && c->inLen >= FRAME_HEADER_BYTES + c->in[1];
+    }
+
+    // Serves and writes until nothing more can be done without new input or
+    // socket space
+    void pump(Client* c) {
+        do {
+            serve(c);
+            if(!flush(c)) { drop(c); return; }
+        } while(!c->parked && c->outLen == 0 && hasFrame(c));
+        watch(c);
+    }
+
+    void watch(Client* c) {
+        unsigned want = 0;
+        if(!c->parked && c->outLen - c->outSent < SERVER_OUT_LIMIT && c->inLen < SERVER_IN_BYTES) want |= EPOLLIN;
+        if(c->outReady > c->outSent) want |= EPOLLOUT;
+        if(want != c->events) {
+            epoll_event ev;
+            ev.events = want;
+            ev.data.ptr = c;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, c->fd, &ev);
+            c->events = want;
+        }
+    }
+
+    void onEvent(Client* c, unsigned events) {
+        if(events & EPOLLERR) { drop(c); return; }
+        if((events & EPOLLIN) && c->inLen < SERVER_IN_BYTES) {
+            ssize_t got = recv(c->fd, c->in + c->inLen, SERVER_IN_BYTES - c->inLen, 0);
+            if(got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) { drop(c); return; }
+            if(got > 0) c->inLen += (int)got;
+        } else if(events & EPOLLHUP) { drop(c); return; }
+        if(!c->parked) pump(c);
+        else if(!flush(c)) drop(c);             // Serving resumes from the retry pass
+        else watch(c);
+    }
+
+    void acceptClients() {
+        while(true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if(fd < 0) {
+                if(errno == EMFILE || errno == ENFILE) {
+                    cout << Color::RED << "[!] Out of file descriptors at " << clients.size() << " clients; new connections wait." << Color::RESET << endl;
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+                    acceptPaused = true;
+                }
+                return;
+            }
+            Client* c = new Client();
+            c->fd = fd;
+            c->slot = clients.size();
+            c->events = EPOLLIN;
+            c->parked = c->held = false;
+            c->inLen = 0;
+            c->out = nullptr;
+            c->outLen = c->outSent = c->outCap = c->outReady = 0;
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = c;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            clients.push_back(c);
+            accepted++;
+            if(clients.size() > peakClients) peakClients = clients.size();
+        }
+    }
+
+    void drop(Client* c) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+        close(c->fd);
+        for(int i = 0; i < parked.size(); i++) {
+            if(parked[i] == c) { parked[i] = parked[parked.size() - 1]; parked.pop_back(); break; }
+        }
+        for(int i = 0; i < held.size(); i++) {
+            if(held[i] == c) { held[i] = held[held.size() - 1]; held.pop_back(); break; }
+        }
+        Client* last = clients[clients.size() - 1];
+        clients[c->slot] = last;
+        last->slot = c->slot;
+        clients.pop_back();
+        delete[] c->out;
+        delete c;
+        if(acceptPaused) {
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = nullptr;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+            acceptPaused = false;
+        }
+    }
+
+public:
+    DeskServer(Engine& e) : engine(e), listenFd(-1), epollFd(-1), acceptPaused(false), heldUntil(0),
+                            accepted(0), bookingBatches(0), peakClients(0) {
+        for(int i = 0; i <= OP_CANCEL; i++) served[i] = 0;
+    }
+
+    ~DeskServer() {
+        while(clients.size()) drop(clients[clients.size() - 1]);
+        if(listenFd >= 0) { close(listenFd); unlink(path.c_str()); }
+        if(epollFd >= 0) close(epollFd);
+    }
+
+    DeskServer(const DeskServer&) = delete;
+    DeskServer& operator=(const DeskServer&) = delete;
+
+    bool start(const char* socketPath, string& error) {
+        sockaddr_un addr;
+        if(!makeSocketAddress(socketPath, addr)) { error = "socket path too long: " + string(socketPath); return false; }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool taken = probe >= 0 && connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+        if(probe >= 0) close(probe);
+        if(taken) { error = "a server is already listening on " + string(socketPath); return false; }
+        unlink(socketPath);                             // Left over from a run that was killed
+
+        raiseFileLimit();
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+            error = "cannot listen on " + string(socketPath) + ": " + strerror(errno);
+            if(listenFd >= 0) close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        path = socketPath;
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;                          // nullptr = the listening socket
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+        return true;
+    }
+
+    // Until SIGINT or SIGTERM
+    void run() {
+        epoll_event events[SERVER_MAX_EVENTS];
+        Vector<Client*> retry;
+        while(!stopServing) {
+            int n = epoll_wait(epollFd, events, SERVER_MAX_EVENTS, held.size() ? 0 : parked.size() ? 1 : 200);
+            for(int i = 0; i < n; i++) {
+                Client* c = (Client*)events[i].data.ptr;
+                if(c) onEvent(c, events[i].events);
+                else acceptClients();
+            }
+            retry.clear();
+            for(int i = 0; i < parked.size(); i++) retry.push_back(parked[i]);
+            parked.clear();
+            for(int i = 0; i < retry.size(); i++) pump(retry[i]);
+            releaseHeld();
+        }
+    }
+
+    void printStats() const {
+        cout << Color::GREEN << "[SERVER] " << served[OP_BOOK] << " bookings (" << bookingBatches << " lock acquisitions), "
+             << served[OP_TRACK] << " tracking, " << served[OP_CANCEL] << " cancellations, " << served[0] << " bad requests; "
+             << accepted << " clients, " << peakClients << " at once" << Color::RESET << endl;
+    }
+};
+
+int runServer(Engine& engine, const char* socketPath) {
+    DeskServer server(engine);
+    string error;
+    if(!server.start(socketPath, error)) {
+        cout << Color::RED << "[!] " << error << Color::RESET << endl;
+        return 1;
+    }
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    signal(SIGPIPE, SIG_IGN);
     thread simThread(&Engine::runLoop, &engine);
+    cout << Color::CYAN << "[SERVER] Listening on " << socketPath << " (" << network.hubCount << " hubs). Ctrl-C to stop." << Color::RESET << endl;
+    server.run();
+    engine.stop();
+    simThread.join();
+    server.printStats();
+    return 0;
+}
+
+// --- REMOTE DESK (--connect) ---
+// The panel's side of the socket: one request at a time, answered before
+// the next prompt. Any socket error or protocol mismatch closes it for good.
+class RemoteDesk : public CustomerDesk {
+    int fd;
+    unsigned nextTag;
+
+    bool sendAll(const unsigned char* p, int n) {
+        while(n > 0) {
+            ssize_t sent = send(fd, p, n, MSG_NOSIGNAL);
+            if(sent < 0 && errno == EINTR) continue;
+            if(sent <= 0) return false;
+            p += sent;
+            n -= (int)sent;
+        }
+        return true;
+    }
+
+    bool recvAll(unsigned char* p, int n) {
+        while(n > 0) {
+            ssize_t got = recv(fd, p, n, 0);
+            if(got < 0 && errno == EINTR) continue;
+            if(got <= 0) return false;
+            p += got;
+            n -= (int)got;
+        }
+        return true;
+    }
+
+    // Sends one request and reads its answer; `body` holds up to 255 bytes
+    DeskResult call(int op, const unsigned char* request, int requestLength, unsigned char* body, int& bodyLength) {
+        if(fd < 0) return DESK_UNREACHABLE;
+        unsigned char frame[FRAME_HEADER_BYTES + 255];
+        unsigned tag = nextTag++;
+        putFrameHeader(frame, op, requestLength, tag);
+        memcpy(frame + FRAME_HEADER_BYTES, request, requestLength);
+        unsigned char header[FRAME_HEADER_BYTES];
+        if(!sendAll(frame, FRAME_HEADER_BYTES + requestLength) || !recvAll(header, FRAME_HEADER_BYTES) ||
+           getLE(header + 2, 4) != tag || !recvAll(body, header[1])) {
+            close(fd);
+            fd = -1;
+            return DESK_UNREACHABLE;
+        }
+        bodyLength = header[1];
+        return (DeskResult)header[0];
+    }
+
+public:
+    RemoteDesk() : fd(-1), nextTag(1) {}
+    ~RemoteDesk() { if(fd >= 0) close(fd); }
+
+    RemoteDesk(const RemoteDesk&) = delete;
+    RemoteDesk& operator=(const RemoteDesk&) = delete;
+
+    bool open(const char* socketPath, string& error) {
+        sockaddr_un addr;
+        if(!makeSocketAddress(socketPath, addr)) { error = "socket path too long: " + string(socketPath); return false; }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            error = "cannot connect to " + string(socketPath) + ": " + strerror(errno);
+            if(fd >= 0) close(fd);
+            fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    DeskResult book(const ManifestRow& row, TrackingKey& key, ManifestReject& reason) override {
+        unsigned char request[MANIFEST_RECORD_BYTES], body[255];
+        int length;
+        encodeBookingRecord(row, request);
+        DeskResult r = call(OP_BOOK, request, MANIFEST_RECORD_BYTES, body, length);
+        if(r == DESK_OK && length == KEY_BODY_BYTES) key = getLE(body, KEY_BODY_BYTES);
+        else if(r == DESK_REJECTED && length == 1) reason = (ManifestReject)body[0];
+        else if(r != DESK_UNREACHABLE) r = DESK_BAD_REQUEST;
+        return r;
+    }
+
+    DeskResult track(TrackingKey key, TrackingRecord& rec, long long& now) override {
+        unsigned char request[KEY_BODY_BYTES], body[255];
+        int length;
+        putLE(request, key, KEY_BODY_BYTES);
+        DeskResult r = call(OP_TRACK, request, KEY_BODY_BYTES, body, length);
+        if(r == DESK_OK && length == TRACK_BODY_BYTES) decodeTracking(body, rec, now);
+        else if(r == DESK_OK) r = DESK_BAD_REQUEST;
+        return r;
+    }
+
+    DeskResult cancel(TrackingKey key, ParcelStatus& status) override {
+        unsigned char request[KEY_BODY_BYTES], body[255];
+        int length;
+        putLE(request, key, KEY_BODY_BYTES);
+        DeskResult r = call(OP_CANCEL, request, KEY_BODY_BYTES, body, length);
+        if((r == DESK_OK || r == DESK_NOT_CANCELLABLE) && length == 1) status = (ParcelStatus)body[0];
+        else if(r == DESK_OK || r == DESK_NOT_CANCELLABLE) r = DESK_BAD_REQUEST;
+        return r;
+    }
+};
+
+// --- LOAD GENERATOR (--loadgen) ---
+// Opens `clients` connections to a --serve process and keeps `pipeline`
+// requests in flight on each: 30% bookings, 60% tracking and 10%
+// cancellations of parcels the same client booked. Latency runs from the
+// write of a request to the read of its answer.
+const int LOADGEN_MAX_PIPELINE = 64;
+const int LOADGEN_KEYS = 64;                // Recent bookings a client reuses
+
+struct LoadClient {
+    int fd;
+    unsigned rng;
+    int inFlight;
+    int oldest;                             // Ring index of the oldest request in flight
+    unsigned nextTag;
+    long long sentAt[LOADGEN_MAX_PIPELINE];
+    unsigned char opAt[LOADGEN_MAX_PIPELINE];
+    TrackingKey keys[LOADGEN_KEYS];
+    int keyCount;
+    int inLen;
+    unsigned char in[LOADGEN_MAX_PIPELINE * (FRAME_HEADER_BYTES + TRACK_BODY_BYTES)];
+
+    unsigned random() {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        return rng;
+    }
+};
+
+// Tops the client up to `pipeline` requests in flight with one write
+static bool issueRequests(LoadClient& c, int pipeline, long long& issued, long long total) {
+    unsigned char frames[LOADGEN_MAX_PIPELINE * (FRAME_HEADER_BYTES + MANIFEST_RECORD_BYTES)];
+    int length = 0;
+    long long now = steadyNs();
+    int offices = network.officeNames.size();
+    while(c.inFlight < pipeline && issued < total) {
+        unsigned r = c.random();
+        int op = c.keyCount == 0 || r % 10 < 3 ? OP_BOOK : r % 10 < 9 ? OP_TRACK : OP_CANCEL;
+        unsigned char* f = frames + length;
+        if(op == OP_BOOK) {
+            ManifestRow row;
+            row.src = c.random() % network.hubCount;
+            row.dest = c.random() % network.hubCount;
+            row.srcOffice = c.random() % offices;
+            row.destOffice = c.random() % offices;
+            if(row.src == row.dest && row.srcOffice == row.destOffice) row.dest = (row.dest + 1) % network.hubCount;
+            row.weight = 1 + c.random() % 60;
+            row.priority = 1 + c.random() % 3;
+            putFrameHeader(f, OP_BOOK, MANIFEST_RECORD_BYTES, c.nextTag);
+            encodeBookingRecord(row, f + FRAME_HEADER_BYTES);
+            length += FRAME_HEADER_BYTES + MANIFEST_RECORD_BYTES;
+        } else {
+            putFrameHeader(f, op, KEY_BODY_BYTES, c.nextTag);
+            putLE(f + FRAME_HEADER_BYTES, c.keys[c.random() % c.keyCount], KEY_BODY_BYTES);
+            length += FRAME_HEADER_BYTES + KEY_BODY_BYTES;
+        }
+        int slot = (c.oldest + c.inFlight) % LOADGEN_MAX_PIPELINE;
+        c.sentAt[slot] = now;
+        c.opAt[slot] = (unsigned char)op;
+        c.nextTag++;
+        c.inFlight++;
+        issued++;
+    }
+    // Never more than `pipeline` small frames outstanding, so a blocking
+    // send always fits in the socket buffer
+    for(int sent = 0; sent < length; ) {
+        ssize_t n = send(c.fd, frames + sent, length - sent, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        sent += (int)n;
+    }
+    return true;
+}
+
+int runLoadGenerator(const char* socketPath, int clientCount, long long total, int pipeline) {
+    if(pipeline > LOADGEN_MAX_PIPELINE) pipeline = LOADGEN_MAX_PIPELINE;
+    sockaddr_un addr;
+    if(!makeSocketAddress(socketPath, addr)) {
+        cout << Color::RED << "[!] Socket path too long: " << socketPath << Color::RESET << endl;
+        return 1;
+    }
+    raiseFileLimit();
+    signal(SIGPIPE, SIG_IGN);
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    LoadClient* clients = new LoadClient[clientCount];
+    int connected = 0;
+    for(; connected < clientCount; connected++) {
+        LoadClient& c = clients[connected];
+        c.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(c.fd < 0 || connect(c.fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            cout << Color::RED << "[!] Client " << connected << " cannot connect to " << socketPath << ": " << strerror(errno) << Color::RESET << endl;
+            if(c.fd >= 0) close(c.fd);
+            break;
+        }
+        c.rng = 2463534242u + connected * 2654435761u;
+        c.inFlight = c.oldest = c.keyCount = c.inLen = 0;
+        c.nextTag = 1;
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &c;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    long long issued = 0, answered = 0;
+    long long results[OP_CANCEL + 1][DESK_BUSY + 1] = {};
+    Vector<long long> latencyNs;
+    bool failed = connected < clientCount;
+    cout << Color::CYAN << "[LOADGEN] " << connected << " clients x " << pipeline << " in flight, " << total << " requests to "
+         << socketPath << Color::RESET << endl;
+    long long start = steadyNs();
+    for(int i = 0; i < connected && !failed; i++) failed = !issueRequests(clients[i], pipeline, issued, total);
+
+    epoll_event events[256];
+    while(!failed && answered < issued) {
+        int n = epoll_wait(epollFd, events, 256, 5000);
+        if(n == 0) {
+            cout << Color::RED << "[!] No answer from the server for 5 s." << Color::RESET << endl;
+            failed = true;
+        }
+        for(int i = 0; i < n && !failed; i++) {
+            LoadClient& c = *(LoadClient*)events[i].data.ptr;
+            ssize_t got = recv(c.fd, c.in + c.inLen, sizeof(c.in) - c.inLen, 0);
+            if(got <= 0) {
+                if(got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+                cout << Color::RED << "[!] The server closed a connection." << Color::RESET << endl;
+                failed = true;
+                break;
+            }
+            c.inLen += (int)got;
+            long long now = steadyNs();
+            int pos = 0;
+            while(c.inLen - pos >= FRAME_HEADER_BYTES && c.inLen - pos >= FRAME_HEADER_BYTES + c.in[pos + 1]) {
+                const unsigned char* f = c.in + pos;
+                int op = c.opAt[c.oldest];
+                int result = f[0] <= DESK_BUSY ? (int)f[0] : (int)DESK_BAD_REQUEST;
+                if(c.inFlight == 0 || getLE(f + 2, 4) != c.nextTag - c.inFlight) {
+                    cout << Color::RED << "[!] Answer out of order." << Color::RESET << endl;
+                    failed = true;
+                    break;
+                }
+                if(op == OP_BOOK && result == DESK_OK && f[1] == KEY_BODY_BYTES) {
+                    TrackingKey key = getLE(f + FRAME_HEADER_BYTES, KEY_BODY_BYTES);
+                    if(c.keyCount < LOADGEN_KEYS) c.keys[c.keyCount++] = key;
+                    else c.keys[c.random() % LOADGEN_KEYS] = key;
+                }
+                results[op][result]++;
+                latencyNs.push_back(now - c.sentAt[c.oldest]);
+                c.oldest = (c.oldest + 1) % LOADGEN_MAX_PIPELINE;
+                c.inFlight--;
+                answered++;
+                pos += FRAME_HEADER_BYTES + f[1];
+            }
+            memmove(c.in, c.in + pos, c.inLen - pos);
+            c.inLen -= pos;
+            if(!failed && !issueRequests(c, pipeline, issued, total)) failed = true;
+        }
+    }
+    double wall = (steadyNs() - start) / 1e9;
+
+    for(int i = 0; i < connected; i++) close(clients[i].fd);
+    delete[] clients;
+    close(epollFd);
+
+    cout << Color::GREEN << "[LOADGEN] " << answered << " answers in " << fixed << setprecision(2) << wall << " s ("
+         << setprecision(0) << (wall > 0 ? answered / wall : 0) << " requests/s)" << Color::RESET << "\n";
+    const char* opNames[OP_CANCEL + 1] = {"", "Book", "Track", "Cancel"};
+    cout << "  " << left << setw(8) << "Op" << right << setw(10) << "OK" << setw(11) << "Not found" << setw(10) << "Refused" << setw(10) << "Other" << "\n";
+    for(int op = OP_BOOK; op <= OP_CANCEL; op++) {
+        long long* r = results[op];
+        cout << "  " << left << setw(8) << opNames[op] << right << setw(10) << r[DESK_OK] << setw(11) << r[DESK_NOT_FOUND]
+             << setw(10) << r[DESK_REJECTED] + r[DESK_NOT_CANCELLABLE] << setw(10) << r[DESK_BAD_REQUEST] + r[DESK_UNREACHABLE] + r[DESK_BUSY] << "\n";
+    }
+
+    // Percentiles by popping a min-heap, as the tracking benchmark does
+    QueryHeap heap;
+    for(int i = 0; i < latencyNs.size(); i++) heap.push(latencyNs[i], i);
+    long long p50 = 0, p99 = 0, last = 0;
+    int count = latencyNs.size();
+    for(int n = 1; !heap.isEmpty(); n++) {
+        last = heap.top().key;
+        heap.pop();
+        if(n == (count + 1) / 2) p50 = last;
+        if(n == (int)ceil(count * 0.99)) p99 = last;
+    }
+    cout << "  Latency p50 " << setprecision(1) << p50 / 1000.0 << " us, p99 " << p99 / 1000.0 << " us, max " << last / 1000.0 << " us\n";
+    return failed ? 1 : 0;
+}
+#endif
+
+// --- CUSTOMER PANEL ---
+// The terminal front end, one client of a CustomerDesk: the engine in this
+// process, or a RemoteDesk talking to a --serve process.
+void printTracking(const TrackingRecord& rec, long long now) {
+    string pid = formatTrackingId(rec.key);
+    int srcCity = rec.srcCity, srcOffice = rec.srcOffice;
+    int destCity = rec.destCity, destOffice = rec.destOffice;
+    int legDist = rec.legDistance;
+    int earlierLegsKm = rec.totalRouteDistance - rec.legDistance;
+    ParcelStatus status = rec.status;
+    long long elapsed = now - rec.dispatchTime;
+
+    cout << Color::CYAN << "\n+------------------------------------------------+\n";
+    cout << "|               TRACKING DETAILS                 |\n";
+    cout << "+------------------------------------------------+\n" << Color::RESET;
+    cout << " ID:       " << Color::BOLD << pid << Color::RESET << "\n";
+    cout << " From:     " << network.hubNames[srcCity] << " (" << network.officeNames[srcOffice] << ")\n";
+    cout << " To:       " << network.hubNames[destCity] << " (" << network.officeNames[destOffice] << ")\n";
+    
+    string sColor = Color::YELLOW;
+    if(status == STATUS_DELIVERED) sColor = Color::GREEN;
+    if(status == STATUS_LOST) sColor = Color::RED;
+    if(status == STATUS_CANCELLED) sColor = Color::RED;
+
+    cout << " Status:   " << sColor << Color::BOLD << STATUS_NAMES[status] << Color::RESET << "\n";
     
+    if(status == STATUS_IN_TRANSIT && legDist == 0) {
+        cout << " Leg:      " << rec.legCount << " done, waiting at " << network.hubNames[rec.atHub] << " for the next vehicle\n";
+        cout << " Traveled: " << earlierLegsKm << " km\n";
+    }
+    else if(status == STATUS_IN_TRANSIT) {
+        double traveledKm = elapsed / (double)SECONDS_PER_NODE;
+        if (traveledKm > legDist) traveledKm = legDist;
+        
+        cout << " Leg:      " << rec.legCount << " (" << network.hubNames[rec.atHub] << " -> " << network.hubNames[rec.legTo] << ")\n";
+        cout << " Progress: " << Color::CYAN;
+        int barWidth = 20;
+        float progress = (float)traveledKm / (float)legDist;
+        int pos = barWidth * progress;
+        cout << "[";
+        for (int i = 0; i < barWidth; ++i) {
+            if (i < pos) cout << "=";
+            else if (i == pos) cout << ">";
+            else cout << " ";
+        }
+        cout << "] " << int(progress * 100.0) << "%\n" << Color::RESET;
+        
+        cout << fixed << setprecision(1);
+        cout << " Traveled: " << earlierLegsKm + traveledKm << " km\n";
+        cout << " Leg left: " << (legDist - traveledKm) << " km\n";
+    }
+    cout << Color::CYAN << "+------------------------------------------------+\n" << Color::RESET;
+}
+
+void printLostConnection() {
+    cout << Color::RED << "\n[!] ERROR: Lost the connection to the engine.\n" << Color::RESET;
+}
+
+void printBooking(DeskResult result, TrackingKey key, ManifestReject reason) {
+    if(result == DESK_OK) {
+        cout << Color::GREEN << "\n[SUCCESS] Parcel Booked Successfully! Tracking ID: " << Color::BOLD << formatTrackingId(key) << Color::RESET << endl;
+        return;
+    }
+    if(result != DESK_REJECTED) { printLostConnection(); return; }
+    switch(reason) {
+        case REJECT_HUB: cout << Color::RED << "Invalid City ID Selected.\n" << Color::RESET; break;
+        case REJECT_OFFICE: cout << Color::RED << "Invalid Office Selected.\n" << Color::RESET; break;
+        case REJECT_WEIGHT: cout << Color::RED << "Invalid Weight.\n" << Color::RESET; break;
+        case REJECT_PRIORITY: cout << Color::RED << "Invalid Priority Selected.\n" << Color::RESET; break;
+        case REJECT_SAME_OFFICE: cout << Color::RED << "\n[!] ERROR: Source and Destination cannot be the same office.\n" << Color::RESET; break;
+        default: cout << Color::RED << "\n[!] ERROR: Parcel store is full (" << ParcelStore::MAX_PARCELS << " parcels).\n" << Color::RESET; break;
+    }
+}
+
+// `engine` is null for a remote panel, which cannot import manifests
+void runPanel(CustomerDesk& desk, Engine* engine) {
     int choice;
     while(true) {
         clearScreen();
@@ -671,11 +7522,13 @@ int main() {
         cout << Color::CYAN << " 1." << Color::RESET << " Book a New Parcel\n";
         cout << Color::CYAN << " 2." << Color::RESET << " Track Your Parcel\n";
         cout << Color::CYAN << " 3." << Color::RESET << " Cancel (Undo) Booking\n";
+        if(engine) cout << Color::CYAN << " 4." << Color::RESET << " Bulk Import Manifest\n";
         cout << Color::RED << " 0." << Color::RESET << " Exit Application\n";
         cout << Color::BLUE << "===========================================\n" << Color::RESET;
         cout << " Select Option: ";
         
         if(!(cin >> choice)) {
+            if(cin.eof()) break;
             cin.clear(); cin.ignore(100, '\n');
             continue;
         }
@@ -683,24 +7536,29 @@ int main() {
         if(choice == 0) break;
 
         if(choice == 1) {
-            int sc, so, dc, doo, w, p;
+            ManifestRow row;
             cout << "\n" << Color::YELLOW << "--- NEW BOOKING WIZARD ---" << Color::RESET << "\n";
             cout << "Available Cities:\n";
-            for(int i=0; i<MAX_CITIES; i++) {
-                cout << " " << Color::CYAN << i << "." << Color::RESET << " " << left << setw(12) << CITIES[i];
+            const int LIST_LIMIT = 40;
+            for(int i=0; i<network.hubCount && i<LIST_LIMIT; i++) {
+                cout << " " << Color::CYAN << i << "." << Color::RESET << " " << left << setw(12) << network.hubNames[i];
                 if((i+1)%2==0) cout << endl;
             }
+            if(network.hubCount > LIST_LIMIT) cout << " ... " << network.hubCount << " hubs in total\n";
             cout << "--------------------------\n";
 
-            cout << " Source City ID: "; cin >> sc;
-            cout << " Source Office (0=Hub, 1-5=Off): "; cin >> so;
-            cout << " Dest City ID:   "; cin >> dc;
-            cout << " Dest Office (0=Hub, 1-5=Off):   "; cin >> doo;
-            cout << " Weight (kg):    "; cin >> w;
-            cout << " Priority (1=Overnight, 2=2Day, 3=Normal): "; cin >> p;
-            
-            if(sc>=0 && sc<8 && dc>=0 && dc<8) engine.bookParcel(sc, so, dc, doo, w, p);
-            else cout << Color::RED << "Invalid City ID Selected.\n" << Color::RESET;
+            int lastOffice = network.officeNames.size() - 1;
+            cout << " Source City ID: "; cin >> row.src;
+            cout << " Source Office (0=Hub, 1-" << lastOffice << "=Off): "; cin >> row.srcOffice;
+            cout << " Dest City ID:   "; cin >> row.dest;
+            cout << " Dest Office (0=Hub, 1-" << lastOffice << "=Off):   "; cin >> row.destOffice;
+            cout << " Weight (kg):    "; cin >> row.weight;
+            cout << " Priority (1=Overnight, 2=2Day, 3=Normal): "; cin >> row.priority;
+
+            TrackingKey key = 0;
+            ManifestReject reason = REJECT_SYNTAX;
+            DeskResult result = desk.book(row, key, reason);
+            printBooking(result, key, reason);
             
             cout << "\nPress Enter to return..."; cin.ignore(); cin.get();
         }
@@ -710,20 +7568,155 @@ int main() {
             do {
                 cout << "\n" << Color::YELLOW << "--- PARCEL TRACKING ---" << Color::RESET << "\n";
                 cout << " Enter Tracking ID: "; cin >> id;
-                engine.trackParcel(id);
+                TrackingKey key;
+                TrackingRecord rec;
+                long long now;
+                DeskResult result = parseTrackingId(id, key) ? desk.track(key, rec, now) : DESK_NOT_FOUND;
+                if(result == DESK_OK) printTracking(rec, now);
+                else if(result == DESK_UNREACHABLE) printLostConnection();
+                else cout << Color::RED << "[!] ID Not Found.\n" << Color::RESET;
                 cout << "\n [R] Refresh | [0] Back to Menu: ";
                 cin >> sub;
-            } while(sub == 'r' || sub == 'R');
+            } while(cin && (sub == 'r' || sub == 'R'));
         }
         else if(choice == 3) {
             string id;
             cout << "\n" << Color::YELLOW << "--- CANCEL BOOKING ---" << Color::RESET << "\n";
             cout << " Enter Tracking ID: "; cin >> id;
-            engine.undoParcel(id);
+            TrackingKey key;
+            ParcelStatus status = STATUS_BOOKED;
+            DeskResult result = parseTrackingId(id, key) ? desk.cancel(key, status) : DESK_NOT_FOUND;
+            if(result == DESK_OK) cout << Color::GREEN << "[SUCCESS] Parcel " << formatTrackingId(key) << " has been cancelled.\n" << Color::RESET;
+            else if(result == DESK_NOT_CANCELLABLE) cout << Color::RED << "[ERROR] Cannot Undo. Parcel is already " << STATUS_NAMES[status] << ".\n" << Color::RESET;
+            else if(result == DESK_UNREACHABLE) printLostConnection();
+            else cout << Color::RED << "[ERROR] Parcel ID not found in system.\n" << Color::RESET;
             cout << "\nPress Enter to return..."; cin.ignore(); cin.get();
         }
+        else if(choice == 4 && engine) {
+            string path;
+            cout << "\n" << Color::YELLOW << "--- BULK IMPORT ---" << Color::RESET << "\n";
+            cout << " Manifest file (CSV or binary): "; cin.ignore(); getline(cin, path);
+            importManifest(*engine, path.c_str());
+            cout << "\nPress Enter to return..."; cin.get();
+        }
+    }
+}
+
+// --speed realtime | <N> (N simulated seconds per wall second) | max
+bool parseSpeed(const char* arg, ClockMode& mode, double& speed) {
+    if(strcmp(arg, "max") == 0) { mode = CLOCK_DISCRETE_EVENT; return true; }
+    if(strcmp(arg, "realtime") == 0) { mode = CLOCK_REAL_TIME; speed = 1; return true; }
+    char* endPtr;
+    speed = strtod(arg, &endPtr);
+    if(*endPtr != '\0' || speed <= 0) return false;
+    mode = speed == 1 ? CLOCK_REAL_TIME : CLOCK_ACCELERATED;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool headless = false;
+    bool speedGiven = false, metricsGiven = false;
+    ClockMode mode = CLOCK_REAL_TIME;
+    double speed = 1;
+    int days = 30;
+    int parcelsPerDay = 500;
+    int logFlushMs = 200;
+    int dispatchThreads = max(1, (int)thread::hardware_concurrency());
+    unsigned seed = (unsigned)time(0);
+    const char* importPath = nullptr;
+    bool serve = false, connectPanel = false, loadgen = false;
+    const char* socketPath = DESK_SOCKET_FILE;
+    int loadClients = 1000, loadPipeline = 16;
+    long long loadRequests = 1000000;
+    bool durable = false;
+    int snapshotDays = 1;
+    int metricsMs = 1000;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--query") return runQuery(argc - i - 1, argv + i + 1);
+        else if(arg == "--bench-routing") return runRoutingBenchmark();
+        else if(arg == "--bench-allocator") return runAllocatorBenchmark();
+        else if(arg == "--bench-tracking") { if(!initNetwork()) return 1; return runTrackingBenchmark(); }
+        else if(arg == "--bench-restart") {
+            int parcelCount = hasValue && atoi(argv[i + 1]) > 0 ? atoi(argv[i + 1]) : 10000000;
+            if(!initNetwork()) return 1;
+            srand(seed);
+            return runRestartBenchmark(parcelCount);
+        }
+        else if(arg == "--durable") durable = true;
+        else if(arg == "--snapshot-days" && hasValue && atoi(argv[i + 1]) >= 0) snapshotDays = atoi(argv[++i]);
+        else if(arg == "--headless") headless = true;
+        else if(arg == "--speed" && hasValue && parseSpeed(argv[i + 1], mode, speed)) { speedGiven = true; i++; }
+        else if(arg == "--days" && hasValue && atoi(argv[i + 1]) > 0) days = atoi(argv[++i]);
+        else if(arg == "--parcels-per-day" && hasValue && atoi(argv[i + 1]) >= 0) parcelsPerDay = atoi(argv[++i]);
+        else if(arg == "--seed" && hasValue) seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--log-flush-ms" && hasValue && atoi(argv[i + 1]) > 0) logFlushMs = atoi(argv[++i]);
+        else if(arg == "--metrics-ms" && hasValue && atoi(argv[i + 1]) >= 0) { metricsMs = atoi(argv[++i]); metricsGiven = true; }
+        else if(arg == "--dispatch-threads" && hasValue && atoi(argv[i + 1]) > 0) dispatchThreads = atoi(argv[++i]);
+        else if(arg == "--import" && hasValue) importPath = argv[++i];
+        else if(arg == "--serve") serve = true;
+        else if(arg == "--connect") connectPanel = true;
+        else if(arg == "--loadgen") loadgen = true;
+        else if(arg == "--socket" && hasValue) socketPath = argv[++i];
+        else if(arg == "--clients" && hasValue && atoi(argv[i + 1]) > 0) loadClients = atoi(argv[++i]);
+        else if(arg == "--requests" && hasValue && atoll(argv[i + 1]) > 0) loadRequests = atoll(argv[++i]);
+        else if(arg == "--pipeline" && hasValue && atoi(argv[i + 1]) > 0) loadPipeline = atoi(argv[++i]);
+        else {
+            cout << Color::RED << "[!] Unknown or invalid option: " << arg << Color::RESET << "\n"
+                 << "Usage: " << argv[0] << " [--speed realtime|N|max] [--log-flush-ms N] [--metrics-ms N] [--dispatch-threads N] [--import FILE] [--durable [--snapshot-days N]]\n"
+                 << "       " << argv[0] << " --headless [--days N] [--parcels-per-day N] [--speed realtime|N|max] [--seed N] [--metrics-ms N] [--dispatch-threads N] [--import FILE] [--durable]\n"
+                 << "       " << argv[0] << " --serve [--socket PATH] [--speed realtime|N|max] [--metrics-ms N] [--dispatch-threads N] [--import FILE] [--durable]\n"
+                 << "       " << argv[0] << " --connect [--socket PATH]\n"
+                 << "       " << argv[0] << " --loadgen [--socket PATH] [--clients N] [--requests N] [--pipeline N]\n"
+                 << "       " << argv[0] << " --query [--log FILE] [--where FIELD=A|B,...] [--by FIELD,...] [--sum events|kg|parcels] [--text]\n"
+                 << "       " << argv[0] << " --bench-routing\n"
+                 << "       " << argv[0] << " --bench-allocator\n"
+                 << "       " << argv[0] << " --bench-tracking\n"
+                 << "       " << argv[0] << " --bench-restart [PARCELS]\n";
+            return 1;
+        }
+    }
+
+#ifdef __linux__
+    if(loadgen) return initNetwork() ? runLoadGenerator(socketPath, loadClients, loadRequests, loadPipeline) : 1;
+    if(connectPanel) {
+        if(!initNetwork()) return 1;
+        RemoteDesk desk;
+        string error;
+        if(!desk.open(socketPath, error)) {
+            cout << Color::RED << "[!] " << error << Color::RESET << endl;
+            return 1;
+        }
+        runPanel(desk, nullptr);
+        return 0;
+    }
+#else
+    if(serve || connectPanel || loadgen) {
+        cout << Color::RED << "[!] --serve, --connect and --loadgen need Linux (epoll and Unix sockets)." << Color::RESET << endl;
+        return 1;
     }
+#endif
 
+    srand(seed);
+    if(!initNetwork()) return 1;
+    struct stat st;
+    bool resuming = durable && (stat(RECOVERY_SNAP_FILE, &st) == 0 || stat(RECOVERY_WAL_FILE, &st) == 0);
+    Engine engine(resuming);
+    engine.setLogFlushInterval(logFlushMs);
+    engine.setDispatchThreads(dispatchThreads);
+    engine.exportMetrics(METRICS_FILE, metricsMs);
+    if(durable && !openRecovery(engine, snapshotDays)) return 1;
+    if(importPath && importManifest(engine, importPath) < 0) return 1;
+    if(headless) return runHeadless(engine, days, parcelsPerDay, speedGiven ? mode : CLOCK_DISCRETE_EVENT, speed, metricsGiven && metricsMs > 0);
+
+    engine.setClock(mode, speed);
+#ifdef __linux__
+    if(serve) return runServer(engine, socketPath);
+#endif
+    if(importPath) { cout << "\nPress Enter to open the customer panel..."; cin.get(); }
+    thread simThread(&Engine::runLoop, &engine);
+    runPanel(engine, &engine);
     engine.stop();
     simThread.join();
     return 0;